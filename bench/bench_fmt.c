@@ -0,0 +1,86 @@
+/**
+ * @file bench_fmt.c
+ * @brief 内部格式化函数与glibc snprintf的性能对比
+ *
+ * 用法: bench_fmt [循环次数]
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "fmt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BUF_LEN	1024
+
+static char buf[BUF_LEN];
+static volatile int sink;		//防止被编译器优化掉
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, int loops, double libc, double internal)
+{
+    printf("%-12s snprintf %8.1f ns/op    fmt %8.1f ns/op    x%.2f\n", name,
+           libc * 1e9 / loops, internal * 1e9 / loops, libc / internal);
+}
+
+int main(int argc, char *argv[])
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 1000000;
+    int i;
+    double t0, t1, t2;
+    fmt_buf b;
+
+    if(loops <= 0) {
+        loops = 1000000;
+    }
+
+#define BENCH(name, ...) \
+    do { \
+        t0 = now(); \
+        for(i = 0; i < loops; i++) { \
+            sink += snprintf(buf, BUF_LEN, __VA_ARGS__); \
+        } \
+        t1 = now(); \
+        for(i = 0; i < loops; i++) { \
+            fmt_init(&b, buf, BUF_LEN); \
+            fmt_format(&b, __VA_ARGS__); \
+            sink += fmt_end(&b); \
+        } \
+        t2 = now(); \
+        report(name, loops, t1 - t0, t2 - t1); \
+    } while(0)
+
+    BENCH("int", "request %d done in %u us, status=%d", i, 1234u + i, 200);
+    BENCH("long/hex", "fd=%ld addr=%#lx mask=%08x", (long)i * 100003, (unsigned long)i * 4096, i);
+    BENCH("string", "user %s login from %-15s|%.3s", "alice", "10.0.0.1", "abcdef");
+    BENCH("float", "latency %.3f ms, ratio %6.2f%%", i * 0.001 + 0.5, 99.5);
+    BENCH("pointer", "object %p freed", (void *)(uintptr_t)(i + 0x1000));
+    BENCH("mixed", "[%s] id=%d size=%zu t=%.6f ptr=%p", "worker", i, (size_t)i * 8, 1.0 / (i + 1), (void *)buf);
+
+    t0 = now();
+
+    for(i = 0; i < loops; i++) {
+        sink += snprintf(buf, BUF_LEN, "%.17g", 1.0 / (i + 3));
+    }
+
+    t1 = now();
+
+    for(i = 0; i < loops; i++) {
+        fmt_init(&b, buf, BUF_LEN);
+        fmt_double(&b, 1.0 / (i + 3), 0);
+        sink += fmt_end(&b);
+    }
+
+    t2 = now();
+    report("shortest", loops, t1 - t0, t2 - t1);
+    return 0;
+}
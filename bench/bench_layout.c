@@ -0,0 +1,102 @@
+/**
+ * @file bench_layout.c
+ * @brief 内置文本格式与格式模板的渲染性能对比
+ *
+ * 先把日志放入足够大的队列，再启动调度线程并计时，到自定义设备收到所有日志为止，
+ * 得到调度线程处理每条日志的时间(渲染是其中的主要部分)
+ *
+ * 用法: bench_layout [条数]
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile long received;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int count_batch(void *ctx, const log_line *lines, int num)
+{
+    received += num;
+    return num;
+}
+
+static const log_sink_ops count_ops = {"count", NULL, count_batch, NULL, NULL, NULL};
+
+/**
+ * @brief	run	pattern为NULL时使用内置的文本格式
+ *
+ * @return	每条日志的纳秒数，失败返回-1
+ */
+static double run(const char *pattern, int records)
+{
+    log_t *lg = log_create();
+    char category[CATEGORY_LEN] = "bench";
+    double t0, t1;
+    int i, id;
+
+    if(lg == NULL || log_init(lg) != LOG_TRUE || (id = log_add_sink(lg, &count_ops, NULL, LOG_FORMAT_TEXT, LOG_ESCAPE_RAW)) < 0
+            || log_set_lane(lg, INFO, records, LOG_OVERFLOW_DROP) != LOG_TRUE
+            || (pattern != NULL && log_set_pattern(lg, LOG_ROUTE(id), pattern) != LOG_TRUE)) {
+        log_destroy(lg);
+        return -1;
+    }
+
+    received = 0;
+
+    for(i = 0; i < records; i++) {
+        log_write(lg, LOG_ROUTE(id), INFO, category, "request %d done, status=%d", i, 200);
+    }
+
+    t0 = now();
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+
+    while(received < records) {
+        usleep(100);
+    }
+
+    t1 = now();
+    log_destroy(lg);
+    return (t1 - t0) * 1e9 / records;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *patterns[] = {
+        "[%d][%-5p][%c] - %m",		//和内置文本格式的输出相同
+        "%d{ISO8601} %-5p [%c] %t %m%n",
+        "%d{UNIX} %p %m",
+    };
+    int records = argc > 1 ? atoi(argv[1]) : 200000;
+    double base, t;
+    unsigned int i;
+
+    if(records <= 0) {
+        records = 200000;
+    }
+
+    if((base = run(NULL, records)) < 0) {
+        fprintf(stderr, "create log failed\n");
+        return 1;
+    }
+
+    printf("%-36s %8.1f ns/record\n", "text (fixed)", base);
+
+    for(i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        t = run(patterns[i], records);
+        printf("%-36s %8.1f ns/record    x%.2f\n", patterns[i], t, base / t);
+    }
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#define CONFIG_LINE_LEN		1024
+
+enum config_section_s {SECTION_GLOBAL = -1, SECTION_CONSOLE = 0, SECTION_FILE, SECTION_SOCKET};
+
+static const char *level_names[] = {"fatal", "error", "info", "debug"};
+static const char *clock_names[] = {"realtime", "coarse", "monotonic_raw", "tsc"};
+static const char *format_names[] = {"text", "json", "logfmt", "binary"};
+static const char *escape_names[] = {"raw", "sanitize", "json"};
+static const char *section_names[] = {"console", "file", "socket"};
+
+static char *trim(char *s)
+{
+    char *end;
+
+    while(isspace((unsigned char)*s)) {
+        ++s;
+    }
+
+    end = s + strlen(s);
+
+    while(end > s && isspace((unsigned char)end[-1])) {
+        --end;
+    }
+
+    *end = '\0';
+    return s;
+}
+
+/**
+ * @brief	lookup	在名字表中查找(不区分大小写)
+ *
+ * @return	下标，没有找到返回-1
+ */
+static int lookup(const char **names, int num, const char *value)
+{
+    int i;
+
+    for(i = 0; i < num; i++) {
+        if(strcasecmp(names[i], value) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static int copy_value(char *dst, int size, const char *value)
+{
+    if((int)strlen(value) >= size) {
+        return -1;
+    }
+
+    strcpy(dst, value);
+    return 0;
+}
+
+/**
+ * @brief	parse_address	解析tcp://ip:port或者udp://ip:port(ip可以用[]包围(IPv6))，unix:///path或者seqpacket:///path
+ */
+static int parse_address(log_config *config, const char *value)
+{
+    const char *host, *port;
+    int len;
+
+    config->sock_set = 1;
+    config->sock_unix = 0;
+
+    if(*value == '\0') {
+        config->sock_host[0] = '\0';
+        return 0;
+    }
+
+    if(strncasecmp(value, "unix://", 7) == 0) {
+        config->sock_unix = SOCK_STREAM;
+        return value[7] == '\0' ? -1 : copy_value(config->sock_path, CONFIG_PATH_LEN, value + 7);
+    }
+
+    if(strncasecmp(value, "seqpacket://", 12) == 0) {
+        config->sock_unix = SOCK_SEQPACKET;
+        return value[12] == '\0' ? -1 : copy_value(config->sock_path, CONFIG_PATH_LEN, value + 12);
+    }
+
+    if(strncasecmp(value, "tcp://", 6) == 0) {
+        config->sock_type = TCP;
+    } else if(strncasecmp(value, "udp://", 6) == 0) {
+        config->sock_type = UDP;
+    } else {
+        return -1;
+    }
+
+    host = value + 6;
+
+    if(*host == '[') {
+        port = strchr(++host, ']');
+
+        if(port == NULL || port[1] != ':') {
+            return -1;
+        }
+
+        len = port - host;
+        port += 2;
+    } else {
+        port = strrchr(host, ':');
+
+        if(port == NULL) {
+            return -1;
+        }
+
+        len = port - host;
+        ++port;
+    }
+
+    if(len <= 0 || len >= CONFIG_HOST_LEN || *port == '\0' || copy_value(config->sock_port, CONFIG_PORT_LEN, port) != 0) {
+        return -1;
+    }
+
+    memcpy(config->sock_host, host, len);
+    config->sock_host[len] = '\0';
+    return 0;
+}
+
+/**
+ * @brief	parse_count	解析非负整数
+ *
+ * @return	失败返回-1
+ */
+static int parse_count(const char *value)
+{
+    char *end;
+    long v = strtol(value, &end, 10);
+
+    if(*value == '\0' || *end != '\0' || v < 0 || v > 0x7fffffff) {
+        return -1;
+    }
+
+    return (int)v;
+}
+
+static int parse_item(log_config *config, int section, const char *key, const char *value)
+{
+    int v;
+
+    if(strcasecmp(key, "format") == 0 && section != SECTION_GLOBAL) {
+        v = lookup(format_names, 4, value);
+        config->format[section] = v;
+        return v;
+    }
+
+    if(strcasecmp(key, "pattern") == 0 && section != SECTION_GLOBAL) {	//模板在log_reload中编译
+        config->format[section] = LOG_FORMAT_PATTERN;
+        return copy_value(config->pattern[section], CONFIG_PATTERN_LEN, value);
+    }
+
+    if(strcasecmp(key, "escape") == 0 && section != SECTION_GLOBAL) {
+        v = lookup(escape_names, 3, value);
+        config->escape[section] = v;
+        return v;
+    }
+
+    switch(section) {
+        case SECTION_GLOBAL:
+
+            if(strcasecmp(key, "level") == 0) {
+                return config->level = lookup(level_names, 4, value);
+            }
+
+            if(strcasecmp(key, "enable") == 0) {
+                if(strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+                    return config->enable = 1;
+                }
+
+                return config->enable = (strcasecmp(value, "false") == 0 || strcmp(value, "0") == 0) ? 0 : -1;
+            }
+
+            if(strcasecmp(key, "clock") == 0) {
+                return config->clock = lookup(clock_names, 4, value);
+            }
+
+            if(strcasecmp(key, "time_digits") == 0) {
+                v = parse_count(value);
+                return config->time_digits = v <= 9 ? v : -1;
+            }
+
+            if(strcasecmp(key, "shed_high") == 0) {
+                v = parse_count(value);
+                return config->shed_high = v <= 100 ? v : -1;
+            }
+
+            if(strcasecmp(key, "shed_low") == 0) {
+                v = parse_count(value);
+                return config->shed_low = v <= 100 ? v : -1;
+            }
+
+            break;
+        case SECTION_FILE:
+
+            if(strcasecmp(key, "path") == 0) {
+                config->file_set = 1;
+                return copy_value(config->file, CONFIG_PATH_LEN, value);
+            }
+
+            if(strcasecmp(key, "debug_path") == 0) {
+                config->debug_set = 1;
+                return copy_value(config->debug_file, CONFIG_PATH_LEN, value);
+            }
+
+            if(strcasecmp(key, "index_records") == 0) {
+                return config->index_records = parse_count(value);
+            }
+
+            if(strcasecmp(key, "index_kb") == 0) {
+                return config->index_kb = parse_count(value);
+            }
+
+            break;
+        case SECTION_SOCKET:
+
+            if(strcasecmp(key, "address") == 0) {
+                return parse_address(config, value);
+            }
+
+            break;
+        default:
+            break;
+    }
+
+    return -1;
+}
+
+int config_parse(const char *path, log_config *config)
+{
+    char line[CONFIG_LINE_LEN], *p, *key, *value, *end;
+    int i, no = 0, section = SECTION_GLOBAL, ret = 0;
+    FILE *fp;
+
+    if(path == NULL || config == NULL) {
+        return -1;
+    }
+
+    if((fp = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "open config %s failed\n", path);
+        return -1;
+    }
+
+    memset(config, 0, sizeof(log_config));
+    config->level = -1;
+    config->enable = -1;
+    config->clock = -1;
+    config->time_digits = -1;
+    config->shed_high = -1;
+    config->shed_low = -1;
+    config->index_records = -1;
+    config->index_kb = -1;
+
+    for(i = 0; i < CONFIG_SINK_NUM; i++) {
+        config->format[i] = -1;
+        config->escape[i] = -1;
+    }
+
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        ++no;
+        p = trim(line);
+
+        if(*p == '\0' || *p == '#' || *p == ';') {
+            continue;
+        }
+
+        if(*p == '[') {
+            if((end = strchr(p, ']')) == NULL) {
+                fprintf(stderr, "%s:%d: bad section\n", path, no);
+                ret = -1;
+                continue;
+            }
+
+            *end = '\0';
+
+            if((section = lookup(section_names, CONFIG_SINK_NUM, trim(p + 1))) < 0) {
+                fprintf(stderr, "%s:%d: unknown section [%s]\n", path, no, trim(p + 1));
+                section = SECTION_GLOBAL - 1;		//之后的配置项都报错
+                ret = -1;
+            }
+
+            continue;
+        }
+
+        if((value = strchr(p, '=')) == NULL) {
+            fprintf(stderr, "%s:%d: expect key = value\n", path, no);
+            ret = -1;
+            continue;
+        }
+
+        *value++ = '\0';
+        key = trim(p);
+        value = trim(value);
+
+        if(section < SECTION_GLOBAL || parse_item(config, section, key, value) < 0) {
+            fprintf(stderr, "%s:%d: bad item %s = %s\n", path, no, key, value);
+            ret = -1;
+        }
+    }
+
+    fclose(fp);
+    return ret;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file config.h
+ * @brief 日志配置文件的解析
+ *
+ * 1.ini格式，#或者;开头的行是注释，section为console，file，socket，section之前的是全局配置\n
+ * 2.全局配置:level = fatal|error|info|debug，enable = true|false，clock = realtime|coarse|monotonic_raw|tsc，time_digits = 0到9，shed_high = 0到100，shed_low = 0到100(小于shed_high)\n
+ * 3.console:format，escape；file:path，debug_path，format，escape，index_records，index_kb；socket:address，format，escape\n
+ * 4.format = text|json|logfmt|binary，escape = raw|sanitize|json；每个section都可以设置pattern = 格式模板(见layout.h)，同时把格式设为模板\n
+ * 5.address = tcp://ip:port，udp://ip:port，unix:///path(流式)或者seqpacket:///path，unix的路径以@开头表示抽象命名空间\n
+ * 6.没有出现的配置项保持原来的值，path和address的值为空表示关闭对应的设备\n
+ * 7.有任何错误时整个文件都不生效，错误信息带行号输出到stderr\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+#include "log.h"
+
+#define CONFIG_PATH_LEN		256
+#define CONFIG_HOST_LEN		64
+#define CONFIG_PORT_LEN		16
+#define CONFIG_PATTERN_LEN	257		//LAYOUT_PATTERN_LEN加上'\0'
+#define CONFIG_SINK_NUM		3		//console，file，socket，和log.c中的设备顺序一致
+
+typedef struct log_config_s {
+    int level;							//-1表示没有配置
+    int enable;
+    int clock;							//log_clock，-1表示没有配置
+    int time_digits;
+    int shed_high;						//负载削减的水位，-1表示没有配置
+    int shed_low;
+    int file_set;						//是否配置了path
+    char file[CONFIG_PATH_LEN];
+    int debug_set;
+    char debug_file[CONFIG_PATH_LEN];
+    int index_records;					//时间索引的间隔，-1表示没有配置
+    int index_kb;
+    int sock_set;
+    sock_type sock_type;
+    char sock_host[CONFIG_HOST_LEN];	//为空表示关闭socket
+    char sock_port[CONFIG_PORT_LEN];
+    int sock_unix;						//0表示ip地址，否则是unix socket的类型(SOCK_STREAM或者SOCK_SEQPACKET)
+    char sock_path[CONFIG_PATH_LEN];
+    int format[CONFIG_SINK_NUM];
+    int escape[CONFIG_SINK_NUM];
+    char pattern[CONFIG_SINK_NUM][CONFIG_PATTERN_LEN];	//format为LOG_FORMAT_PATTERN时使用
+} log_config;
+
+/**
+ * @brief	config_parse	解析配置文件
+ *
+ * @param	path		配置文件路径
+ * @param	config		解析结果
+ *
+ * @return	成功返回0，失败返回-1
+ */
+int config_parse(const char *path, log_config *config);
+
+#endif /* __CONFIG_H__ */
@@ -0,0 +1,231 @@
+#include "escape.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ESCAPE_X86
+#include <immintrin.h>
+#endif
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/**
+ * json转义表，0表示不需要转义，'u'表示使用\u00XX的形式
+ */
+static const char json_escape[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+};
+
+static inline int need_escape(unsigned char c, escape_class cls)
+{
+    switch(cls) {
+        case ESCAPE_JSON:
+            return c < 0x20 || c == '"' || c == '\\';
+        case ESCAPE_LOGFMT:
+            return c <= 0x20 || c == '"' || c == '=' || c == '\\';
+        case ESCAPE_CTRL:
+        default:
+            return c < 0x20 || c == 0x7f;
+    }
+}
+
+static int find_scalar(const unsigned char *s, int len, escape_class cls)
+{
+    int i;
+
+    for(i = 0; i < len; i++) {
+        if(need_escape(s[i], cls)) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+#ifdef ESCAPE_X86
+/**
+ * 每种分类转换为一个上限(无符号小于等于)和三个需要匹配的字节，不需要的字节重复填充
+ */
+static const unsigned char class_bytes[3][4] = {
+    {0x1f, 0x7f, 0x7f, 0x7f},		//ESCAPE_CTRL
+    {0x1f, '"', '\\', '"'},		//ESCAPE_JSON
+    {0x20, '"', '\\', '='}		//ESCAPE_LOGFMT
+};
+
+static int find_sse2(const unsigned char *s, int len, escape_class cls)
+{
+    const unsigned char *c = class_bytes[cls];
+    const __m128i limit = _mm_set1_epi8(c[0]);
+    const __m128i c1 = _mm_set1_epi8(c[1]);
+    const __m128i c2 = _mm_set1_epi8(c[2]);
+    const __m128i c3 = _mm_set1_epi8(c[3]);
+    __m128i v, m;
+    int i, mask;
+
+    for(i = 0; i + 16 <= len; i += 16) {
+        v = _mm_loadu_si128((const __m128i *)(s + i));
+        m = _mm_cmpeq_epi8(_mm_min_epu8(v, limit), v);		//无符号v <= limit
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, c1));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, c2));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, c3));
+        mask = _mm_movemask_epi8(m);
+
+        if(mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + find_scalar(s + i, len - i, cls);
+}
+
+__attribute__((target("avx2")))
+static int find_avx2(const unsigned char *s, int len, escape_class cls)
+{
+    const unsigned char *c = class_bytes[cls];
+    const __m256i limit = _mm256_set1_epi8(c[0]);
+    const __m256i c1 = _mm256_set1_epi8(c[1]);
+    const __m256i c2 = _mm256_set1_epi8(c[2]);
+    const __m256i c3 = _mm256_set1_epi8(c[3]);
+    __m256i v, m;
+    unsigned int mask;
+    int i;
+
+    for(i = 0; i + 32 <= len; i += 32) {
+        v = _mm256_loadu_si256((const __m256i *)(s + i));
+        m = _mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v);
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, c1));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, c2));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, c3));
+        mask = _mm256_movemask_epi8(m);
+
+        if(mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + find_sse2(s + i, len - i, cls);
+}
+#endif
+
+typedef int (*find_func)(const unsigned char *s, int len, escape_class cls);
+static find_func find_impl = NULL;
+static const char *impl_name = "scalar";
+
+static void escape_select(void)
+{
+    find_func f = find_scalar;
+#ifdef ESCAPE_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        f = find_avx2;
+        impl_name = "avx2";
+    } else if(__builtin_cpu_supports("sse2")) {
+        f = find_sse2;
+        impl_name = "sse2";
+    }
+
+#endif
+    find_impl = f;		//多个线程同时初始化时结果相同
+}
+
+int escape_find(const char *s, int len, escape_class cls)
+{
+    if(find_impl == NULL) {
+        escape_select();
+    }
+
+    return find_impl((const unsigned char *)s, len, cls);
+}
+
+const char *escape_impl(void)
+{
+    if(find_impl == NULL) {
+        escape_select();
+    }
+
+    return impl_name;
+}
+
+void escape_json(fmt_buf *b, const char *s, int len)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    int i = 0, n;
+    char esc;
+
+    while(i < len) {
+        n = escape_find(s + i, len - i, ESCAPE_JSON);
+        fmt_putn(b, s + i, n);
+        i += n;
+
+        if(i == len) {
+            break;
+        }
+
+        esc = json_escape[p[i]];
+        fmt_putc(b, '\\');
+        fmt_putc(b, esc);
+
+        if(esc == 'u') {
+            fmt_putn(b, "00", 2);
+            fmt_putc(b, hex_digits[p[i] >> 4]);
+            fmt_putc(b, hex_digits[p[i] & 0xf]);
+        }
+
+        ++i;
+    }
+}
+
+void escape_sanitize(fmt_buf *b, const char *s, int len)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    int i = 0, n;
+
+    while(i < len) {
+        n = escape_find(s + i, len - i, ESCAPE_CTRL);
+        fmt_putn(b, s + i, n);
+        i += n;
+
+        if(i == len) {
+            break;
+        }
+
+        switch(p[i]) {
+            case '\t':
+                fmt_putc(b, '\t');
+                break;
+            case '\n':
+                fmt_putn(b, "\\n", 2);
+                break;
+            case '\r':
+                fmt_putn(b, "\\r", 2);
+                break;
+            default:
+                fmt_putn(b, "\\x", 2);
+                fmt_putc(b, hex_digits[p[i] >> 4]);
+                fmt_putc(b, hex_digits[p[i] & 0xf]);
+                break;
+        }
+
+        ++i;
+    }
+}
+
+void escape_text(fmt_buf *b, const char *s, int len, log_escape mode)
+{
+    switch(mode) {
+        case LOG_ESCAPE_SANITIZE:
+            escape_sanitize(b, s, len);
+            break;
+        case LOG_ESCAPE_JSON:
+            escape_json(b, s, len);
+            break;
+        case LOG_ESCAPE_RAW:
+        default:
+            fmt_putn(b, s, len);
+            break;
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file escape.h
+ * @brief 日志内容的清理和转义
+ *
+ * 1.使用SSE2/AVX2一次检查16/32字节，找到需要处理的字节之前的干净片段整段复制\n
+ * 2.运行时根据cpu选择实现(avx2 > sse2 > scalar)，非x86平台只有scalar实现\n
+ * 3.清理(sanitize)把换行、回车和其他控制字符替换为\\n \\r \\xHH的形式，保留制表符，保证一条日志只占一行\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __ESCAPE_H__
+#define __ESCAPE_H__
+
+#include "log.h"
+#include "fmt.h"
+
+/**
+ * @brief	需要处理的字节的分类
+ */
+typedef enum escape_class_s {
+    ESCAPE_CTRL = 0,		//控制字符(< 0x20)和DEL
+    ESCAPE_JSON,			//控制字符(< 0x20)，'"'和'\\'
+    ESCAPE_LOGFMT			//控制字符和空格(<= 0x20)，'"'，'='和'\\'
+} escape_class;
+
+/**
+ * @brief	escape_find	查找第一个需要处理的字节
+ *
+ * @param	s			字符串
+ * @param	len			长度
+ * @param	cls			字节分类
+ *
+ * @return	第一个需要处理的字节的位置，不存在时返回len
+ */
+int escape_find(const char *s, int len, escape_class cls);
+/**
+ * @brief	escape_json	输出json转义后的字符串(不包括两边的引号)
+ */
+void escape_json(fmt_buf *b, const char *s, int len);
+/**
+ * @brief	escape_sanitize	输出清理控制字符之后的字符串
+ */
+void escape_sanitize(fmt_buf *b, const char *s, int len);
+/**
+ * @brief	escape_text	按照设备的转义方式输出字符串
+ *
+ * @param	b			输出缓冲区
+ * @param	s			字符串
+ * @param	len			长度
+ * @param	mode		LOG_ESCAPE_RAW原样输出，LOG_ESCAPE_SANITIZE清理，LOG_ESCAPE_JSON json转义
+ */
+void escape_text(fmt_buf *b, const char *s, int len, log_escape mode);
+/**
+ * @brief	escape_impl	当前使用的实现的名字
+ *
+ * @return	"avx2"，"sse2"或者"scalar"
+ */
+const char *escape_impl(void);
+
+#endif /* __ESCAPE_H__ */
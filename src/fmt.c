@@ -0,0 +1,867 @@
+#include "fmt.h"
+#include <stdio.h>
+#include <math.h>
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * @brief	u64_to_str	从后向前每次生成两位数字
+ *
+ * @param	end			输出缓冲区的结尾
+ * @param	v			数字
+ *
+ * @return	第一个数字的位置
+ */
+static inline char *u64_to_str(char *end, uint64_t v)
+{
+    char *p = end;
+
+    while(v >= 100) {
+        int i = (v % 100) * 2;
+        v /= 100;
+        *--p = digit_pairs[i + 1];
+        *--p = digit_pairs[i];
+    }
+
+    if(v < 10) {
+        *--p = '0' + v;
+    } else {
+        *--p = digit_pairs[v * 2 + 1];
+        *--p = digit_pairs[v * 2];
+    }
+
+    return p;
+}
+
+void fmt_u64(fmt_buf *b, uint64_t v)
+{
+    char tmp[20];
+    char *p = u64_to_str(tmp + sizeof(tmp), v);
+    fmt_putn(b, p, tmp + sizeof(tmp) - p);
+}
+
+void fmt_i64(fmt_buf *b, int64_t v)
+{
+    if(v < 0) {
+        fmt_putc(b, '-');
+        fmt_u64(b, -(uint64_t)v);
+    } else {
+        fmt_u64(b, v);
+    }
+}
+
+void fmt_u64_pad(fmt_buf *b, uint64_t v, int width)
+{
+    char tmp[20];
+    char *p = u64_to_str(tmp + sizeof(tmp), v);
+    int len = tmp + sizeof(tmp) - p;
+
+    while(len < width--) {
+        fmt_putc(b, '0');
+    }
+
+    fmt_putn(b, p, len);
+}
+
+/////////////////////////////////////////grisu2/////////////////////////////////////////
+/**
+ * 10^k(k = -348 + 8 * i)规格化后的64位有效数字和二进制指数
+ */
+static const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76, 0xcf42894a5dce35ea,
+    0x9a6bb0aa55653b2d, 0xe61acf033d1a45df, 0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f,
+    0xbe5691ef416bd60c, 0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+    0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57, 0xc21094364dfb5637,
+    0x9096ea6f3848984f, 0xd77485cb25823ac7, 0xa086cfcd97bf97f4, 0xef340a98172aace5,
+    0xb23867fb2a35b28e, 0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+    0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126, 0xb5b5ada8aaff80b8,
+    0x87625f056c7c4a8b, 0xc9bcff6034c13053, 0x964e858c91ba2655, 0xdff9772470297ebd,
+    0xa6dfbd9fb8e5b88f, 0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+    0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06, 0xaa242499697392d3,
+    0xfd87b5f28300ca0e, 0xbce5086492111aeb, 0x8cbccc096f5088cc, 0xd1b71758e219652c,
+    0x9c40000000000000, 0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+    0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068, 0x9f4f2726179a2245,
+    0xed63a231d4c4fb27, 0xb0de65388cc8ada8, 0x83c7088e1aab65db, 0xc45d1df942711d9a,
+    0x924d692ca61be758, 0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+    0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d, 0x952ab45cfa97a0b3,
+    0xde469fbd99a05fe3, 0xa59bc234db398c25, 0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece,
+    0x88fcf317f22241e2, 0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+    0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410, 0x8bab8eefb6409c1a,
+    0xd01fef10a657842c, 0x9b10a4e5e9913129, 0xe7109bfba19c0c9d, 0xac2820d9623bf429,
+    0x80444b5e7aa7cf85, 0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+    0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b
+};
+
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+typedef struct diy_fp_s {
+    uint64_t f;
+    int e;
+} diy_fp;
+
+static inline diy_fp diy_make(uint64_t f, int e)
+{
+    diy_fp r = {f, e};
+    return r;
+}
+
+static inline diy_fp diy_mul(diy_fp x, diy_fp y)
+{
+    unsigned __int128 p = (unsigned __int128)x.f * y.f;
+    uint64_t h = p >> 64, l = (uint64_t)p;
+
+    if(l & ((uint64_t)1 << 63)) {	//四舍五入
+        ++h;
+    }
+
+    return diy_make(h, x.e + y.e + 64);
+}
+
+static inline diy_fp diy_normalize(diy_fp x)
+{
+    int s = __builtin_clzll(x.f);
+    return diy_make(x.f << s, x.e - s);
+}
+
+static const uint32_t pow10_u32[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+static inline int count_digits_u32(uint32_t n)
+{
+    int i = 1;
+
+    while(i < 10 && n >= pow10_u32[i]) {
+        ++i;
+    }
+
+    return i;
+}
+
+static inline void grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while(rest < wp_w && delta - rest >= ten_kappa
+          && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void grisu_digits(diy_fp w, diy_fp mp, uint64_t delta, char *buf, int *len, int *k)
+{
+    diy_fp one = diy_make((uint64_t)1 << -mp.e, mp.e);
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e), d;
+    uint64_t p2 = mp.f & (one.f - 1), tmp;
+    int kappa = count_digits_u32(p1);
+    *len = 0;
+
+    while(kappa > 0) {
+        d = p1 / pow10_u32[kappa - 1];
+        p1 %= pow10_u32[kappa - 1];
+
+        if(d || *len) {
+            buf[(*len)++] = '0' + d;
+        }
+
+        --kappa;
+        tmp = ((uint64_t)p1 << -one.e) + p2;
+
+        if(tmp <= delta) {
+            *k += kappa;
+            grisu_round(buf, *len, delta, tmp, (uint64_t)pow10_u32[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    while(1) {
+        p2 *= 10;
+        delta *= 10;
+        d = (uint32_t)(p2 >> -one.e);
+
+        if(d || *len) {
+            buf[(*len)++] = '0' + d;
+        }
+
+        p2 &= one.f - 1;
+        --kappa;
+
+        if(p2 < delta) {
+            *k += kappa;
+            grisu_round(buf, *len, delta, p2, one.f, -kappa < 10 ? wp_w * pow10_u32[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief	grisu2	生成最短的十进制数字串，v = buf * 10^k
+ *
+ * @param	v		正的有限浮点数
+ */
+static void grisu2(double v, char *buf, int *len, int *k)
+{
+    uint64_t u, f;
+    int e, index;
+    diy_fp w, plus, minus, c;
+    memcpy(&u, &v, sizeof(u));
+    f = u & 0x000FFFFFFFFFFFFFULL;
+    e = (u >> 52) & 0x7FF;
+
+    if(e != 0) {
+        f += 0x0010000000000000ULL;
+        e -= 1075;
+    } else {
+        e = -1074;
+    }
+
+    plus = diy_make((f << 1) + 1, e - 1);		//上下边界
+
+    while(!(plus.f & (0x0010000000000000ULL << 1))) {
+        plus.f <<= 1;
+        plus.e--;
+    }
+
+    plus.f <<= 10;
+    plus.e -= 10;
+    minus = (f == 0x0010000000000000ULL) ? diy_make((f << 2) - 1, e - 2) : diy_make((f << 1) - 1, e - 1);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    double dk = (-61 - plus.e) * 0.30102999566398114 + 347;	//选取缓存的10的幂，使乘积的指数落在[-60,-32]
+    index = (int)dk;
+
+    if(dk - index > 0.0) {
+        ++index;
+    }
+
+    index = (index >> 3) + 1;
+    *k = -(-348 + (index << 3));
+    c = diy_make(cached_powers_f[index], cached_powers_e[index]);
+    w = diy_mul(diy_normalize(diy_make(f, e)), c);
+    plus = diy_mul(plus, c);
+    minus = diy_mul(minus, c);
+    minus.f++;
+    plus.f--;
+    grisu_digits(w, plus, plus.f - minus.f, buf, len, k);
+}
+
+void fmt_double(fmt_buf *b, double v, int json)
+{
+    char d[24];
+    int len, k, kk, i;
+
+    if(isnan(v)) {
+        fmt_puts(b, json ? "null" : "nan");
+        return;
+    }
+
+    if(isinf(v)) {
+        fmt_puts(b, json ? "null" : (v < 0 ? "-inf" : "inf"));
+        return;
+    }
+
+    if(signbit(v)) {
+        fmt_putc(b, '-');
+        v = -v;
+    }
+
+    if(v == 0) {
+        fmt_putc(b, '0');
+        return;
+    }
+
+    grisu2(v, d, &len, &k);
+    kk = len + k;		//10^(kk-1) <= v < 10^kk
+
+    if(k >= 0 && kk <= 21) {		//1234e7 -> 12340000000
+        fmt_putn(b, d, len);
+
+        for(i = len; i < kk; i++) {
+            fmt_putc(b, '0');
+        }
+    } else if(kk > 0 && kk <= 21) {	//1234e-2 -> 12.34
+        fmt_putn(b, d, kk);
+        fmt_putc(b, '.');
+        fmt_putn(b, d + kk, len - kk);
+    } else if(kk > -6 && kk <= 0) {	//1234e-6 -> 0.001234
+        fmt_putn(b, "0.", 2);
+
+        for(i = kk; i < 0; i++) {
+            fmt_putc(b, '0');
+        }
+
+        fmt_putn(b, d, len);
+    } else {						//1234e30 -> 1.234e+33
+        fmt_putc(b, d[0]);
+
+        if(len > 1) {
+            fmt_putc(b, '.');
+            fmt_putn(b, d + 1, len - 1);
+        }
+
+        fmt_putc(b, 'e');
+        fmt_putc(b, kk - 1 < 0 ? '-' : '+');
+        fmt_u64(b, kk - 1 < 0 ? 1 - kk : kk - 1);
+    }
+}
+
+/////////////////////////////////////////printf/////////////////////////////////////////
+static inline void fmt_pad(fmt_buf *b, char c, int n)
+{
+    while(n-- > 0) {
+        fmt_putc(b, c);
+    }
+}
+
+/**
+ * @brief	fmt_field	输出带前缀(符号，0x等)的数字串并按宽度填充
+ *
+ * @param	zeros		前缀和数字之间补充的0的个数(来自精度)
+ */
+static void fmt_field(fmt_buf *b, const fmt_spec *spec, const char *prefix, int plen, int zeros, const char *digits, int dlen)
+{
+    int len = plen + zeros + dlen, pad = spec->width > len ? spec->width - len : 0;
+
+    if(spec->flags & FMT_LEFT) {
+        fmt_putn(b, prefix, plen);
+        fmt_pad(b, '0', zeros);
+        fmt_putn(b, digits, dlen);
+        fmt_pad(b, ' ', pad);
+    } else if(spec->flags & FMT_ZERO) {
+        fmt_putn(b, prefix, plen);
+        fmt_pad(b, '0', zeros + pad);
+        fmt_putn(b, digits, dlen);
+    } else {
+        fmt_pad(b, ' ', pad);
+        fmt_putn(b, prefix, plen);
+        fmt_pad(b, '0', zeros);
+        fmt_putn(b, digits, dlen);
+    }
+}
+
+void fmt_spec_int(fmt_buf *b, const fmt_spec *spec, uint64_t mag, int neg)
+{
+    static const char lower[] = "0123456789abcdef", upper[] = "0123456789ABCDEF";
+    char tmp[24], prefix[2], c;
+    char *p = tmp + sizeof(tmp);
+    int plen = 0, dlen, zeros = 0;
+    const char *hex;
+    fmt_spec s = *spec;
+
+    switch(spec->conv) {
+        case 'c':
+            c = (char)mag;
+            s.flags &= ~FMT_ZERO;
+            fmt_field(b, &s, NULL, 0, 0, &c, 1);
+            return;
+        case 'x':
+        case 'X':
+            hex = spec->conv == 'x' ? lower : upper;
+
+            while(mag != 0) {
+                *--p = hex[mag & 0xf];
+                mag >>= 4;
+            }
+
+            if((spec->flags & FMT_ALT) && p != tmp + sizeof(tmp)) {
+                prefix[plen++] = '0';
+                prefix[plen++] = spec->conv;
+            }
+
+            break;
+        case 'o':
+
+            while(mag != 0) {
+                *--p = '0' + (mag & 7);
+                mag >>= 3;
+            }
+
+            break;
+        default:
+
+            if(mag != 0) {
+                p = u64_to_str(tmp + sizeof(tmp), mag);
+            }
+
+            if(neg) {
+                prefix[plen++] = '-';
+            } else if(spec->flags & FMT_PLUS) {
+                prefix[plen++] = '+';
+            } else if(spec->flags & FMT_SPACE) {
+                prefix[plen++] = ' ';
+            }
+
+            break;
+    }
+
+    dlen = tmp + sizeof(tmp) - p;
+
+    if(spec->prec < 0 && dlen == 0) {	//没有精度时0也输出一位
+        *--p = '0';
+        dlen = 1;
+    }
+
+    if(spec->prec > dlen) {
+        zeros = spec->prec - dlen;
+    }
+
+    if(spec->conv == 'o' && (spec->flags & FMT_ALT) && zeros == 0 && (dlen == 0 || *p != '0')) {
+        zeros = 1;
+    }
+
+    if(spec->prec >= 0) {		//指定精度时忽略'0'标志
+        s.flags &= ~FMT_ZERO;
+    }
+
+    fmt_field(b, &s, prefix, plen, zeros, p, dlen);
+}
+
+void fmt_spec_str(fmt_buf *b, const fmt_spec *spec, const char *str, int len)
+{
+    fmt_spec s = *spec;
+
+    if(str == NULL) {
+        str = "(null)";
+        len = -1;
+    }
+
+    if(len < 0) {
+        len = spec->prec >= 0 ? (int)strnlen(str, spec->prec) : (int)strlen(str);
+    } else if(spec->prec >= 0 && len > spec->prec) {
+        len = spec->prec;
+    }
+
+    s.flags &= ~FMT_ZERO;
+    fmt_field(b, &s, NULL, 0, 0, str, len);
+}
+
+void fmt_spec_ptr(fmt_buf *b, const fmt_spec *spec, uintptr_t ptr)
+{
+    fmt_spec s = *spec;
+
+    if(ptr == 0) {
+        s.prec = -1;
+        fmt_spec_str(b, &s, "(nil)", 5);
+        return;
+    }
+
+    s.conv = 'x';
+    s.flags |= FMT_ALT;
+    fmt_spec_int(b, &s, ptr, 0);
+}
+
+static const uint64_t pow10_u64[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+int fmt_spec_double(fmt_buf *b, const fmt_spec *spec, double v)
+{
+    char tmp[48], prefix[1];
+    char *p = tmp + sizeof(tmp);
+    int prec = spec->prec < 0 ? 6 : spec->prec, plen = 0, e, s, i;
+    uint64_t u, m, ipart, q;
+    unsigned __int128 n, r, half;
+    fmt_spec sp = *spec;
+
+    if(spec->conv != 'f' && spec->conv != 'F') {
+        return -1;
+    }
+
+    if(signbit(v)) {
+        prefix[plen++] = '-';
+        v = -v;
+    } else if(spec->flags & FMT_PLUS) {
+        prefix[plen++] = '+';
+    } else if(spec->flags & FMT_SPACE) {
+        prefix[plen++] = ' ';
+    }
+
+    if(isnan(v) || isinf(v)) {
+        sp.flags &= ~FMT_ZERO;
+        fmt_field(b, &sp, prefix, plen, 0, isnan(v) ? (spec->conv == 'f' ? "nan" : "NAN") : (spec->conv == 'f' ? "inf" : "INF"), 3);
+        return 0;
+    }
+
+    if(prec > 19 || v >= 18446744073709551616.0) {
+        return -1;
+    }
+
+    memcpy(&u, &v, sizeof(u));
+    m = u & 0x000FFFFFFFFFFFFFULL;
+    e = (u >> 52) & 0x7FF;
+
+    if(e != 0) {
+        m |= 0x0010000000000000ULL;
+        e -= 1075;
+    } else {
+        e = -1074;
+    }
+
+    if(e >= 0) {		//v = m * 2^e，是整数
+        ipart = m << e;
+        q = 0;
+    } else {			//整数部分和小数部分分开，小数部分乘以10^prec后按银行家舍入
+        s = -e;
+        ipart = s < 64 ? m >> s : 0;
+        n = (unsigned __int128)(s < 64 ? m & (((uint64_t)1 << s) - 1) : m) * pow10_u64[prec];
+
+        if(s >= 128) {
+            q = 0;
+        } else {
+            q = (uint64_t)(n >> s);
+            r = n - ((unsigned __int128)q << s);
+            half = (unsigned __int128)1 << (s - 1);
+
+            if(r > half || (r == half && ((prec > 0 ? q : ipart) & 1))) {
+                ++q;
+            }
+        }
+
+        if(q >= pow10_u64[prec]) {		//进位到整数部分
+            q -= pow10_u64[prec];
+
+            if(++ipart == 0) {
+                return -1;
+            }
+        }
+    }
+
+    if(prec > 0 || (spec->flags & FMT_ALT)) {
+        for(i = 0; i < prec; i++) {
+            *--p = '0' + q % 10;
+            q /= 10;
+        }
+
+        *--p = '.';
+    }
+
+    p = u64_to_str(p, ipart);
+    fmt_field(b, &sp, prefix, plen, 0, p, tmp + sizeof(tmp) - p);
+    return 0;
+}
+
+const char *fmt_parse_spec(const char *f, fmt_spec *spec, va_list *va)
+{
+    spec->flags = 0;
+    spec->width = 0;
+    spec->prec = -1;
+    spec->length = 0;
+
+    while(1) {
+        switch(*f) {
+            case '-':
+                spec->flags |= FMT_LEFT;
+                break;
+            case '0':
+                spec->flags |= FMT_ZERO;
+                break;
+            case '+':
+                spec->flags |= FMT_PLUS;
+                break;
+            case ' ':
+                spec->flags |= FMT_SPACE;
+                break;
+            case '#':
+                spec->flags |= FMT_ALT;
+                break;
+            default:
+                goto width;
+        }
+
+        ++f;
+    }
+
+width:
+
+    if(*f == '*') {
+        if(va == NULL) {
+            spec->conv = '*';
+            return f + 1;
+        }
+
+        spec->width = va_arg(*va, int);
+
+        if(spec->width < 0) {
+            spec->flags |= FMT_LEFT;
+            spec->width = -spec->width;
+        }
+
+        ++f;
+    } else {
+        while(*f >= '0' && *f <= '9') {
+            spec->width = spec->width * 10 + (*f++ - '0');
+        }
+    }
+
+    if(*f == '.') {
+        ++f;
+        spec->prec = 0;
+
+        if(*f == '*') {
+            if(va == NULL) {
+                spec->conv = '*';
+                return f + 1;
+            }
+
+            spec->prec = va_arg(*va, int);
+            ++f;
+        } else {
+            while(*f >= '0' && *f <= '9') {
+                spec->prec = spec->prec * 10 + (*f++ - '0');
+            }
+        }
+    }
+
+    switch(*f) {
+        case 'h':
+            spec->length = 'h';
+
+            if(*++f == 'h') {
+                spec->length = 'H';
+                ++f;
+            }
+
+            break;
+        case 'l':
+            spec->length = 'l';
+
+            if(*++f == 'l') {
+                spec->length = 'L';
+                ++f;
+            }
+
+            break;
+        case 'q':
+        case 'j':
+            spec->length = 'L';
+            ++f;
+            break;
+        case 'z':
+        case 't':
+            spec->length = 'z';
+            ++f;
+            break;
+        case 'L':
+            spec->length = 'D';		//long double
+            ++f;
+            break;
+        default:
+            break;
+    }
+
+    spec->conv = *f;
+    return *f != '\0' ? f + 1 : f;
+}
+
+/**
+ * @brief	fmt_arg_int		按照长度修饰符从va_list中取整数
+ */
+static inline void fmt_arg_int(const fmt_spec *spec, va_list *va, uint64_t *mag, int *neg)
+{
+    int64_t sv;
+    uint64_t uv;
+
+    if(spec->conv == 'd' || spec->conv == 'i') {
+        switch(spec->length) {
+            case 'H':
+                sv = (signed char)va_arg(*va, int);
+                break;
+            case 'h':
+                sv = (short)va_arg(*va, int);
+                break;
+            case 'l':
+                sv = va_arg(*va, long);
+                break;
+            case 'L':
+                sv = va_arg(*va, long long);
+                break;
+            case 'z':
+                sv = va_arg(*va, ssize_t);
+                break;
+            default:
+                sv = va_arg(*va, int);
+                break;
+        }
+
+        *neg = sv < 0;
+        *mag = sv < 0 ? -(uint64_t)sv : (uint64_t)sv;
+    } else {
+        switch(spec->length) {
+            case 'H':
+                uv = (unsigned char)va_arg(*va, unsigned int);
+                break;
+            case 'h':
+                uv = (unsigned short)va_arg(*va, unsigned int);
+                break;
+            case 'l':
+                uv = va_arg(*va, unsigned long);
+                break;
+            case 'L':
+                uv = va_arg(*va, unsigned long long);
+                break;
+            case 'z':
+                uv = va_arg(*va, size_t);
+                break;
+            default:
+                uv = va_arg(*va, unsigned int);
+                break;
+        }
+
+        *neg = 0;
+        *mag = uv;
+    }
+}
+
+/**
+ * @brief	fmt_convert		格式化直到遇到不支持的转换，只使用本文件中的函数，可以在信号处理函数中调用
+ *
+ * @return	全部完成返回NULL，否则返回不支持的转换的'%'，之前的部分已经输出
+ */
+static const char *fmt_convert(fmt_buf *b, const char *fmt, va_list *ap)
+{
+    const char *f = fmt, *start, *conv;
+    fmt_spec spec;
+    uint64_t mag;
+    int neg;
+    double d;
+
+    while(*f != '\0') {
+        start = f;
+
+        while(*f != '\0' && *f != '%') {
+            ++f;
+        }
+
+        fmt_putn(b, start, f - start);
+
+        if(*f == '\0') {
+            break;
+        }
+
+        if(f[1] == '%') {
+            fmt_putc(b, '%');
+            f += 2;
+            continue;
+        }
+
+        conv = f;
+        f = fmt_parse_spec(f + 1, &spec, ap);
+
+        switch(spec.conv) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                fmt_arg_int(&spec, ap, &mag, &neg);
+                fmt_spec_int(b, &spec, mag, neg);
+                break;
+            case 'c':
+                fmt_spec_int(b, &spec, (unsigned char)va_arg(*ap, int), 0);
+                break;
+            case 's':
+
+                if(spec.length == 'l') {
+                    return conv;
+                }
+
+                fmt_spec_str(b, &spec, va_arg(*ap, const char *), -1);
+                break;
+            case 'p':
+                fmt_spec_ptr(b, &spec, (uintptr_t)va_arg(*ap, void *));
+                break;
+            case 'f':
+            case 'F':
+
+                if(spec.length == 'D') {
+                    return conv;
+                }
+
+                d = va_arg(*ap, double);
+
+                if(fmt_spec_double(b, &spec, d) != 0) {
+                    return conv;
+                }
+
+                break;
+            default:
+                return conv;
+        }
+    }
+
+    return NULL;
+}
+
+int fmt_vformat(fmt_buf *b, const char *fmt, va_list va)
+{
+    char *begin = b->cur;
+    int len, skip = b->skip;
+    va_list ap;
+    va_copy(ap, va);
+
+    if(fmt_convert(b, fmt, &ap) == NULL) {
+        va_end(ap);
+        return b->cur - begin;
+    }
+
+    va_end(ap);		//不支持的转换，从头交给vsnprintf
+    b->cur = begin;
+    b->skip = skip;
+    len = vsnprintf(b->cur, b->end - b->cur + 1, fmt, va);
+
+    if(len > b->end - b->cur) {
+        b->skip += len - (b->end - b->cur);
+        b->cur = b->end;
+    } else if(len > 0) {
+        b->cur += len;
+    }
+
+    return b->cur - begin;
+}
+
+int fmt_vformat_safe(fmt_buf *b, const char *fmt, va_list va)
+{
+    char *begin = b->cur;
+    const char *rest;
+    va_list ap;
+    va_copy(ap, va);
+
+    if((rest = fmt_convert(b, fmt, &ap)) != NULL) {		//参数类型未知，剩下的部分原样输出
+        fmt_puts(b, rest);
+    }
+
+    va_end(ap);
+    return b->cur - begin;
+}
+
+int fmt_format(fmt_buf *b, const char *fmt, ...)
+{
+    va_list va;
+    int len;
+    va_start(va, fmt);
+    len = fmt_vformat(b, fmt, va);
+    va_end(va);
+    return len;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file fmt.h
+ * @brief 日志渲染使用的格式化函数
+ *
+ * 1.数字格式化不经过printf系列函数，直接写入输出缓冲区\n
+ * 2.fmt_buf保证不会越界，空间不足时截断并记录没有写入的长度，fmt_end负责添加结尾的'\\0'\n
+ * 3.fmt_vformat支持日志中常用的printf子集:%d %i %u %x %X %o %c %s %p %f %F %%，
+ *   标志(- 0 + 空格 #)、宽度和精度(包括*)以及长度修饰符(hh h l ll z j t)，其他转换整体交给vsnprintf\n
+ * 4.%f在|v|<2^64并且精度不超过19时使用128位整数精确舍入，结果与glibc一致，超出范围时交给snprintf\n
+ * 5.fmt_double使用Grisu2算法输出能够精确还原的最短十进制表示(约千分之一的情况下多一位数字)\n
+ * 6.fmt_vformat_safe不使用vsnprintf，不分配内存也不加锁，可以在信号处理函数中使用\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __FMT_H__
+#define __FMT_H__
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define FMT_LEFT	0x01		//'-'
+#define FMT_ZERO	0x02		//'0'
+#define FMT_PLUS	0x04		//'+'
+#define FMT_SPACE	0x08		//' '
+#define FMT_ALT		0x10		//'#'
+
+/**
+ * @brief	一个转换说明，prec为-1表示没有指定精度
+ */
+typedef struct fmt_spec_s {
+    int flags;
+    int width;
+    int prec;
+    char length;		//长度修饰符，'H'表示hh，'L'表示ll(或者q,j)，'z'表示z或t
+    char conv;
+} fmt_spec;
+
+typedef struct fmt_buf_s {
+    char *start;
+    char *cur;
+    char *end;			//最后一个可写位置之后，预留了'\0'的空间
+    int skip;			//空间不足没有写入的长度，加上已经写入的长度就是完整的长度
+} fmt_buf;
+
+/**
+ * @brief	fmt_init	初始化输出缓冲区
+ *
+ * @param	b			缓冲区对象
+ * @param	buf			输出缓冲区
+ * @param	size		缓冲区大小(包括结尾的'\0')
+ */
+static inline void fmt_init(fmt_buf *b, char *buf, int size)
+{
+    b->start = buf;
+    b->cur = buf;
+    b->end = buf + (size > 0 ? size - 1 : 0);
+    b->skip = 0;
+}
+
+/**
+ * @brief	fmt_end		添加结尾的'\0'
+ *
+ * @return	已经写入的长度
+ */
+static inline int fmt_end(fmt_buf *b)
+{
+    *b->cur = '\0';
+    return b->cur - b->start;
+}
+
+static inline void fmt_putc(fmt_buf *b, char c)
+{
+    if(b->cur < b->end) {
+        *b->cur++ = c;
+    } else {
+        b->skip++;
+    }
+}
+
+static inline void fmt_putn(fmt_buf *b, const char *s, int len)
+{
+    if(len > b->end - b->cur) {
+        b->skip += len - (b->end - b->cur);
+        len = b->end - b->cur;
+    }
+
+    memcpy(b->cur, s, len);
+    b->cur += len;
+}
+
+static inline void fmt_puts(fmt_buf *b, const char *s)
+{
+    fmt_putn(b, s, strlen(s));
+}
+
+/**
+ * @brief	fmt_u64		输出无符号整数
+ */
+void fmt_u64(fmt_buf *b, uint64_t v);
+/**
+ * @brief	fmt_i64		输出有符号整数
+ */
+void fmt_i64(fmt_buf *b, int64_t v);
+/**
+ * @brief	fmt_u64_pad	输出无符号整数，不足width位时前面补0
+ */
+void fmt_u64_pad(fmt_buf *b, uint64_t v, int width);
+/**
+ * @brief	fmt_double	输出能够精确还原的最短十进制表示(1.5, 0.001, 1e+30)
+ *
+ * @param	b			缓冲区对象
+ * @param	v			浮点数
+ * @param	json		是否输出为json格式(NaN和Inf输出为null)
+ */
+void fmt_double(fmt_buf *b, double v, int json);
+/**
+ * @brief	fmt_parse_spec	解析'%'之后的标志、宽度、精度和长度修饰符
+ *
+ * @param	f				'%'之后的位置
+ * @param	spec			解析结果，conv为'\0'表示格式串不完整
+ * @param	va				宽度或者精度为*时从中取参数，为NULL时*不支持(conv设为'*')
+ *
+ * @return	转换字符之后的位置
+ */
+const char *fmt_parse_spec(const char *f, fmt_spec *spec, va_list *va);
+/**
+ * @brief	fmt_spec_int	按照转换说明输出整数(d i u x X o c)
+ *
+ * @param	b				缓冲区对象
+ * @param	spec			转换说明
+ * @param	mag				绝对值
+ * @param	neg				是否为负数
+ */
+void fmt_spec_int(fmt_buf *b, const fmt_spec *spec, uint64_t mag, int neg);
+/**
+ * @brief	fmt_spec_str	按照转换说明输出字符串，len为-1时使用strlen(受精度限制)
+ */
+void fmt_spec_str(fmt_buf *b, const fmt_spec *spec, const char *s, int len);
+/**
+ * @brief	fmt_spec_ptr	按照转换说明输出指针(与glibc一致，NULL输出为(nil))
+ */
+void fmt_spec_ptr(fmt_buf *b, const fmt_spec *spec, uintptr_t p);
+/**
+ * @brief	fmt_spec_double	按照转换说明输出浮点数(f F)
+ *
+ * @return	成功返回0，超出精确处理的范围返回-1，此时没有任何输出
+ */
+int fmt_spec_double(fmt_buf *b, const fmt_spec *spec, double v);
+/**
+ * @brief	fmt_vformat	printf子集的格式化，遇到不支持的转换时整体使用vsnprintf
+ *
+ * @return	写入的长度
+ */
+int fmt_vformat(fmt_buf *b, const char *fmt, va_list va);
+/**
+ * @brief	fmt_vformat_safe	异步信号安全的fmt_vformat，遇到不支持的转换时剩下的格式串原样输出
+ *
+ * @return	写入的长度
+ */
+int fmt_vformat_safe(fmt_buf *b, const char *fmt, va_list va);
+/**
+ * @brief	fmt_format	fmt_vformat的变参版本
+ */
+int fmt_format(fmt_buf *b, const char *fmt, ...);
+
+#endif /* __FMT_H__ */
@@ -0,0 +1,366 @@
+#include "kv.h"
+#include "escape.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define KV_NUM_LEN	8
+
+int kv_encode(char *buf, int size, const log_field *fields, int num)
+{
+    int i, klen, vlen, need, used = 0;
+    const char *key;
+    uint16_t slen;
+
+    for(i = 0; i < num; i++) {
+        key = fields[i].key != NULL ? fields[i].key : "";
+        klen = strlen(key);
+
+        if(klen > 255) {
+            klen = 255;
+        }
+
+        switch(fields[i].type) {
+            case LOG_FIELD_INT:
+            case LOG_FIELD_UINT:
+            case LOG_FIELD_DOUBLE:
+                vlen = KV_NUM_LEN;
+                break;
+            case LOG_FIELD_BOOL:
+                vlen = 1;
+                break;
+            case LOG_FIELD_STR:
+                vlen = 2;
+                break;
+            default:
+                continue;
+        }
+
+        need = 2 + klen + vlen;
+
+        if(used + need > size) {
+            break;
+        }
+
+        buf[used] = fields[i].type;
+        buf[used + 1] = klen;
+        memcpy(buf + used + 2, key, klen);
+        used += 2 + klen;
+
+        switch(fields[i].type) {
+            case LOG_FIELD_INT:
+            case LOG_FIELD_UINT:
+            case LOG_FIELD_DOUBLE:
+                memcpy(buf + used, &fields[i].value, KV_NUM_LEN);
+                used += KV_NUM_LEN;
+                break;
+            case LOG_FIELD_BOOL:
+                buf[used++] = fields[i].value.i != 0;
+                break;
+            case LOG_FIELD_STR:
+            default:
+                slen = fields[i].value.s != NULL ? strnlen(fields[i].value.s, size - used - 2) : 0;
+                memcpy(buf + used, &slen, 2);
+                memcpy(buf + used + 2, fields[i].value.s, slen);
+                used += 2 + slen;
+                break;
+        }
+    }
+
+    return used;
+}
+
+void kv_json_string(fmt_buf *b, const char *s, int len)
+{
+    fmt_putc(b, '"');
+    escape_json(b, s, len);
+    fmt_putc(b, '"');
+}
+
+void kv_logfmt_string(fmt_buf *b, const char *s, int len)
+{
+    if(len == 0 || escape_find(s, len, ESCAPE_LOGFMT) < len) {
+        kv_json_string(b, s, len);
+    } else {
+        fmt_putn(b, s, len);
+    }
+}
+
+static void kv_logfmt_key(fmt_buf *b, const char *key, int len)
+{
+    int i;
+
+    for(i = 0; i < len; i++) {
+        fmt_putc(b, ((unsigned char)key[i] <= ' ' || key[i] == '"' || key[i] == '=') ? '_' : key[i]);
+    }
+}
+
+typedef struct kv_item_s {
+    int type;
+    const char *key;
+    int klen;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } v;
+    const char *s;
+    int slen;
+} kv_item;
+
+/**
+ * @brief	kv_next		解码下一个字段
+ *
+ * @return	成功返回1，已经结束或者数据不完整返回0
+ */
+static int kv_next(const char **pp, const char *end, kv_item *it)
+{
+    const char *p = *pp;
+    uint16_t slen;
+
+    if(p + 2 > end) {
+        return 0;
+    }
+
+    memset(it, 0, sizeof(kv_item));		//没有解码的成员不会带着上一个字段的值
+    it->type = p[0];
+    it->klen = (unsigned char)p[1];
+    it->key = p + 2;
+    p += 2 + it->klen;
+
+    switch(it->type) {
+        case LOG_FIELD_INT:
+        case LOG_FIELD_UINT:
+        case LOG_FIELD_DOUBLE:
+
+            if(p + KV_NUM_LEN > end) {
+                return 0;
+            }
+
+            memcpy(&it->v, p, KV_NUM_LEN);
+            p += KV_NUM_LEN;
+            break;
+        case LOG_FIELD_BOOL:
+
+            if(p + 1 > end) {
+                return 0;
+            }
+
+            it->v.i = *p;
+            p += 1;
+            break;
+        case LOG_FIELD_STR:
+
+            if(p + 2 > end) {
+                return 0;
+            }
+
+            memcpy(&slen, p, 2);
+
+            if(p + 2 + slen > end) {
+                return 0;
+            }
+
+            it->s = p + 2;
+            it->slen = slen;
+            p += 2 + slen;
+            break;
+        default:
+            return 0;
+    }
+
+    *pp = p;
+    return 1;
+}
+
+static void kv_value(fmt_buf *b, kv_item *it, log_format format)
+{
+    switch(it->type) {
+        case LOG_FIELD_INT:
+            fmt_i64(b, it->v.i);
+            break;
+        case LOG_FIELD_UINT:
+            fmt_u64(b, it->v.u);
+            break;
+        case LOG_FIELD_DOUBLE:
+            fmt_double(b, it->v.d, format == LOG_FORMAT_JSON);
+            break;
+        case LOG_FIELD_BOOL:
+            fmt_puts(b, it->v.i ? "true" : "false");
+            break;
+        case LOG_FIELD_STR:
+        default:
+
+            if(format == LOG_FORMAT_JSON) {
+                kv_json_string(b, it->s, it->slen);
+            } else if(format == LOG_FORMAT_LOGFMT) {
+                kv_logfmt_string(b, it->s, it->slen);
+            } else {
+                fmt_putn(b, it->s, it->slen);
+            }
+
+            break;
+    }
+}
+
+void kv_render(fmt_buf *b, const char *kv, int len, log_format format)
+{
+    const char *p = kv, *end = kv + len;
+    kv_item it;
+
+    while(kv_next(&p, end, &it)) {
+        if(format == LOG_FORMAT_JSON) {
+            fmt_putc(b, ',');
+            kv_json_string(b, it.key, it.klen);
+            fmt_putc(b, ':');
+        } else {
+            fmt_putc(b, ' ');
+            kv_logfmt_key(b, it.key, it.klen);
+            fmt_putc(b, '=');
+        }
+
+        kv_value(b, &it, format == LOG_FORMAT_JSON ? LOG_FORMAT_JSON : LOG_FORMAT_LOGFMT);
+    }
+}
+
+int kv_field(fmt_buf *b, const char *kv, int len, const char *key, int klen)
+{
+    const char *p = kv, *end = kv + len;
+    kv_item it;
+
+    while(kv_next(&p, end, &it)) {
+        if(it.klen == klen && memcmp(it.key, key, klen) == 0) {
+            kv_value(b, &it, LOG_FORMAT_LOGFMT);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void kv_printf(fmt_buf *b, const char *spec, ...)
+{
+    va_list va;
+    int len;
+    va_start(va, spec);
+    len = vsnprintf(b->cur, b->end - b->cur + 1, spec, va);
+    va_end(va);
+
+    if(len > b->end - b->cur) {
+        b->skip += len - (b->end - b->cur);
+        b->cur = b->end;
+    } else if(len > 0) {
+        b->cur += len;
+    }
+}
+
+void kv_format(fmt_buf *b, const char *fmt, const char *args, int len)
+{
+    const char *p = args, *end = args + len, *f = fmt, *start;
+    char spec[32];
+    int n;
+    int64_t i64;
+    double d;
+    fmt_spec sp;
+    kv_item it;
+
+    while(*f != '\0') {
+        start = f;
+
+        while(*f != '\0' && *f != '%') {
+            ++f;
+        }
+
+        fmt_putn(b, start, f - start);
+
+        if(*f == '\0') {
+            break;
+        }
+
+        if(f[1] == '%') {
+            fmt_putc(b, '%');
+            f += 2;
+            continue;
+        }
+
+        start = f;
+        f = fmt_parse_spec(f + 1, &sp, NULL);
+
+        if(sp.conv == '\0' || sp.conv == '*' || !kv_next(&p, end, &it)) {
+            fmt_putn(b, start, f - start);
+            continue;
+        }
+
+        if(it.type == LOG_FIELD_STR && sp.conv != 's') {		//字符串只能用%s输出，类型不匹配时原样输出转换说明并跳过参数
+            fmt_putn(b, start, f - start);
+            continue;
+        }
+
+        i64 = it.type == LOG_FIELD_DOUBLE ? (int64_t)it.v.d : it.v.i;
+        d = it.type == LOG_FIELD_DOUBLE ? it.v.d : (it.type == LOG_FIELD_UINT ? (double)it.v.u : (double)it.v.i);
+
+        switch(sp.conv) {		//按照参数的实际类型输出，长度修饰符不起作用
+            case 'd':
+            case 'i':
+                fmt_spec_int(b, &sp, it.type == LOG_FIELD_INT && i64 < 0 ? -(uint64_t)i64 : (uint64_t)i64, it.type == LOG_FIELD_INT && i64 < 0);
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                fmt_spec_int(b, &sp, (uint64_t)i64, 0);
+                break;
+            case 'p':
+                fmt_spec_ptr(b, &sp, (uintptr_t)it.v.u);
+                break;
+            case 's':
+
+                if(it.type == LOG_FIELD_STR) {
+                    fmt_spec_str(b, &sp, it.s, it.slen);
+                } else {
+                    char str[32];
+                    fmt_buf tmp;
+                    fmt_init(&tmp, str, sizeof(str));
+                    kv_value(&tmp, &it, LOG_FORMAT_TEXT);
+                    fmt_spec_str(b, &sp, str, fmt_end(&tmp));
+                }
+
+                break;
+            case 'f':
+            case 'F':
+
+                if(fmt_spec_double(b, &sp, d) == 0) {
+                    break;
+                }
+
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                n = f - start;		//其余浮点转换交给snprintf，去掉长度修饰符
+
+                if(n >= (int)sizeof(spec)) {
+                    fmt_putn(b, start, n);
+                    break;
+                }
+
+                memcpy(spec, start, n);
+
+                while(n > 1 && (spec[n - 2] == 'l' || spec[n - 2] == 'L' || spec[n - 2] == 'h'
+                                || spec[n - 2] == 'q' || spec[n - 2] == 'j' || spec[n - 2] == 'z' || spec[n - 2] == 't')) {
+                    spec[n - 2] = spec[n - 1];
+                    --n;
+                }
+
+                spec[n] = '\0';
+                kv_printf(b, spec, d);
+                break;
+            default:
+                fmt_putn(b, start, f - start);
+                break;
+        }
+    }
+}
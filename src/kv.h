@@ -0,0 +1,75 @@
+/**
+ * @file kv.h
+ * @brief 结构化日志字段的编码和渲染
+ *
+ * 1.log_write_kv在生产者线程把字段紧凑编码到日志记录中，调度线程再按设备的格式渲染\n
+ * 2.编码格式:[类型:1][键长度:1][键][值]，数字固定8字节，布尔1字节，字符串为[长度:2][内容]\n
+ * 3.空间不足时丢弃放不下的字段，过长的字符串被截断\n
+ * 4.json和logfmt的转义和数字格式化都不经过printf系列函数\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __KV_H__
+#define __KV_H__
+
+#include "log.h"
+#include "fmt.h"
+
+/**
+ * @brief	kv_encode	编码字段
+ *
+ * @param	buf			输出缓冲区
+ * @param	size		缓冲区大小
+ * @param	fields		字段数组
+ * @param	num			字段数
+ *
+ * @return	编码后的长度
+ */
+int kv_encode(char *buf, int size, const log_field *fields, int num);
+/**
+ * @brief	kv_render	渲染编码后的字段
+ *
+ * json格式输出为 ,"key":value 的形式，用于追加在json对象内部；
+ * 其他格式输出为 key=value 的形式，每个字段前有一个空格
+ *
+ * @param	b			输出缓冲区
+ * @param	kv			kv_encode编码的字段
+ * @param	len			编码长度
+ * @param	format		输出格式
+ */
+void kv_render(fmt_buf *b, const char *kv, int len, log_format format);
+/**
+ * @brief	kv_field	按照logfmt的规则输出一个字段的值
+ *
+ * @param	b			输出缓冲区
+ * @param	kv			kv_encode编码的字段
+ * @param	len			编码长度
+ * @param	key			字段名
+ * @param	klen		字段名长度
+ *
+ * @return	找到返回1，没有这个字段返回0
+ */
+int kv_field(fmt_buf *b, const char *kv, int len, const char *key, int klen);
+/**
+ * @brief	kv_format	使用kv_encode编码的参数格式化printf风格的格式串
+ *
+ * 每个转换说明按照参数的实际类型输出，长度修饰符被忽略，参数不足或者字符串参数遇到%s以外的转换时原样输出转换说明
+ *
+ * @param	b			输出缓冲区
+ * @param	fmt			格式串
+ * @param	args		kv_encode编码的参数
+ * @param	len			编码长度
+ */
+void kv_format(fmt_buf *b, const char *fmt, const char *args, int len);
+/**
+ * @brief	kv_json_string	输出带引号并转义的json字符串
+ */
+void kv_json_string(fmt_buf *b, const char *s, int len);
+/**
+ * @brief	kv_logfmt_string	输出logfmt的值，包含空格、引号、等号或者控制字符时加引号转义
+ */
+void kv_logfmt_string(fmt_buf *b, const char *s, int len);
+
+#endif /* __KV_H__ */
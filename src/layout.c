@@ -0,0 +1,175 @@
+#include "layout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#define LAYOUT_WIDTH_MAX	1024
+
+static const char *time_names[] = {"DEFAULT", "ISO8601", "UNIX"};
+
+/**
+ * @brief	layout_arg	解析转换之后的{...}
+ *
+ * @return	没有参数时返回p，不完整时返回NULL
+ */
+static const char *layout_arg(const char *p, const char **arg, int *len)
+{
+    const char *end;
+
+    *arg = NULL;
+    *len = 0;
+
+    if(*p != '{') {
+        return p;
+    }
+
+    if((end = strchr(p, '}')) == NULL) {
+        return NULL;
+    }
+
+    *arg = p + 1;
+    *len = end - p - 1;
+    return end + 1;
+}
+
+static int layout_width(const char **pp)
+{
+    const char *p = *pp;
+    int v = 0;
+
+    while(isdigit((unsigned char)*p) && v <= LAYOUT_WIDTH_MAX) {
+        v = v * 10 + *p++ - '0';
+    }
+
+    *pp = p;
+    return v;
+}
+
+layout *layout_compile(const char *pattern)
+{
+    static const char convs[] = "dpcmtFLMlXn";
+    static const unsigned char types[] = {LAYOUT_TIME, LAYOUT_LEVEL, LAYOUT_CATEGORY, LAYOUT_MSG, LAYOUT_TID, LAYOUT_FILE,
+                                          LAYOUT_LINE, LAYOUT_FUNC, LAYOUT_LOCATION, LAYOUT_FIELDS, LAYOUT_NEWLINE
+                                         };
+    const char *p, *arg, *conv;
+    layout *l;
+    layout_op *op, *last = NULL;
+    char *text;
+    int i, len, arg_len;
+
+    if(pattern == NULL || (len = strlen(pattern)) == 0 || len > LAYOUT_PATTERN_LEN) {
+        fprintf(stderr, "layout: pattern is empty or longer than %d\n", LAYOUT_PATTERN_LEN);
+        return NULL;
+    }
+
+    //每个字符最多产生一条指令，文字和字段名不会比模板长
+    if((l = calloc(1, sizeof(layout) + len * sizeof(layout_op) + len)) == NULL) {
+        return NULL;
+    }
+
+    text = (char *)&l->ops[len];
+
+    for(p = pattern; *p != '\0'; last = op) {
+        if(*p != '%' || p[1] == '%') {		//连续的文字合并为一条指令
+            if(last == NULL || last->type != LAYOUT_TEXT || last->text_len == 255) {
+                op = &l->ops[l->num++];
+                op->type = LAYOUT_TEXT;
+                op->text = text;
+            } else {
+                op = last;
+            }
+
+            *text++ = *p;
+            op->text_len++;
+            p += *p == '%' ? 2 : 1;
+            continue;
+        }
+
+        op = &l->ops[l->num++];
+        ++p;
+
+        if(*p == '-') {
+            op->left = 1;
+            ++p;
+        }
+
+        op->min = layout_width(&p);
+
+        if(*p == '.') {
+            ++p;
+            op->max = layout_width(&p);
+        }
+
+        if(op->min > LAYOUT_WIDTH_MAX || op->max > LAYOUT_WIDTH_MAX) {
+            fprintf(stderr, "layout \"%s\": width at offset %d exceeds %d\n", pattern, (int)(p - pattern), LAYOUT_WIDTH_MAX);
+            goto fail;
+        }
+
+        if(*p == '\0') {
+            fprintf(stderr, "layout \"%s\": incomplete conversion at the end\n", pattern);
+            goto fail;
+        }
+
+        if((conv = strchr(convs, *p)) == NULL) {
+            fprintf(stderr, "layout \"%s\": unknown conversion '%%%c' at offset %d\n", pattern, *p, (int)(p - pattern));
+            goto fail;
+        }
+
+        op->type = types[conv - convs];
+
+        if((p = layout_arg(p + 1, &arg, &arg_len)) == NULL) {
+            fprintf(stderr, "layout \"%s\": missing '}'\n", pattern);
+            goto fail;
+        }
+
+        if(arg == NULL) {
+            continue;
+        }
+
+        if(op->type == LAYOUT_TIME) {
+            for(i = 0; i < 3 && !(strncasecmp(arg, time_names[i], arg_len) == 0 && time_names[i][arg_len] == '\0'); i++);
+
+            if(i == 3) {
+                fprintf(stderr, "layout \"%s\": unknown time style %.*s\n", pattern, arg_len, arg);
+                goto fail;
+            }
+
+            op->style = i;
+        } else if(op->type == LAYOUT_FIELDS && arg_len > 0 && arg_len < 256) {	//字段名放在文字区，不和前后的文字合并
+            op->type = LAYOUT_FIELD;
+            op->text = text;
+            op->text_len = arg_len;
+            memcpy(text, arg, arg_len);
+            text += arg_len;
+        } else {
+            fprintf(stderr, "layout \"%s\": bad argument {%.*s}\n", pattern, arg_len, arg);
+            goto fail;
+        }
+    }
+
+    if(l->num > 0 && l->ops[l->num - 1].type == LAYOUT_NEWLINE && l->ops[l->num - 1].min == 0) {	//结尾的换行由渲染统一添加
+        --l->num;
+    }
+
+    l->refs = 1;
+    return l;
+fail:
+    free(l);
+    return NULL;
+}
+
+void layout_get(layout *l)
+{
+    if(l != NULL) {
+        __sync_fetch_and_add(&l->refs, 1);
+    }
+}
+
+void layout_put(layout *l)
+{
+    if(l != NULL && __sync_sub_and_fetch(&l->refs, 1) == 0) {
+        free(l);
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file layout.h
+ * @brief 文本日志的格式模板，设置时编译为渲染指令序列
+ *
+ * 1.模板中%开头的是转换，其他字符原样输出:\n
+ *   %d或者%d{DEFAULT}时间(2026/10/18 12:00:00.000)，%d{ISO8601}(2026-10-18T12:00:00.000Z)，%d{UNIX}(1970年以来的秒数)，
+ *   秒的小数位数由log_set_clock设置\n
+ *   %p级别，%c分类，%m消息，%t线程号，%F源文件，%L行号，%M函数，%l源文件:行号，%X所有字段( key=value)，%X{key}一个字段的值，
+ *   %n换行，%%百分号\n
+ * 2.%和转换字符之间可以有宽度:%-5p左对齐补空格到5个字符，%8t右对齐，%.20c最多20个字符\n
+ * 3.分类和消息按照设备的转义方式(log_set_escape)输出，字段和文本格式一样按照logfmt的规则输出；没有调用点信息的日志%F %L %M %l不输出\n
+ * 4.结尾总有换行符，模板最后的%n可以省略\n
+ * 5.编译后的模板不再修改，由引用计数管理，配置快照之间共享\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#define LAYOUT_PATTERN_LEN		256		//模板的最大长度
+
+/**
+ * @brief	渲染指令的类型
+ */
+typedef enum layout_type_s {
+    LAYOUT_TEXT = 0,		//原样输出的文字
+    LAYOUT_TIME,
+    LAYOUT_LEVEL,
+    LAYOUT_CATEGORY,
+    LAYOUT_MSG,
+    LAYOUT_TID,
+    LAYOUT_FILE,
+    LAYOUT_LINE,
+    LAYOUT_FUNC,
+    LAYOUT_LOCATION,
+    LAYOUT_FIELDS,
+    LAYOUT_FIELD,			//text中是字段名
+    LAYOUT_NEWLINE
+} layout_type;
+
+/**
+ * @brief	时间的样式
+ */
+typedef enum layout_time_s {LAYOUT_TIME_DEFAULT = 0, LAYOUT_TIME_ISO8601, LAYOUT_TIME_UNIX} layout_time;
+
+typedef struct layout_op_s {
+    unsigned char type;		//layout_type
+    unsigned char style;	//LAYOUT_TIME的layout_time
+    unsigned char left;		//宽度不足时左对齐
+    unsigned char text_len;	//文字或者字段名的长度
+    unsigned short min;		//最小宽度，0表示不补空格
+    unsigned short max;		//最大宽度，0表示不截断
+    const char *text;
+} layout_op;
+
+typedef struct layout_s {
+    volatile int refs;
+    int num;
+    layout_op ops[];		//之后是所有文字和字段名
+} layout;
+
+/**
+ * @brief	layout_compile	编译格式模板
+ *
+ * @param	pattern			格式模板
+ *
+ * @return	失败时错误信息输出到stderr，返回NULL
+ */
+layout *layout_compile(const char *pattern);
+/**
+ * @brief	layout_get	增加引用，l可以为NULL
+ */
+void layout_get(layout *l);
+/**
+ * @brief	layout_put	减少引用，最后一个引用释放，l可以为NULL
+ */
+void layout_put(layout *l);
+
+#endif /* __LAYOUT_H__ */
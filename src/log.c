@@ -1,5 +1,18 @@
+#define _GNU_SOURCE
 #include "log.h"
 #include "queue.h"
+#include "shm_ring.h"
+#include "fmt.h"
+#include "kv.h"
+#include "escape.h"
+#include "topo.h"
+#include "rcu.h"
+#include "config.h"
+#include "sink.h"
+#include "recorder.h"
+#include "stamp.h"
+#include "pool.h"
+#include "layout.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,43 +22,380 @@
 #include <netdb.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
 
 
-#define convert_level(m) (m >= DEBUG ? 1 : 0)
+#define LOG_COLLECT_BATCH	4096
+#define LOG_WATCH_MAX		8		//同时监视配置的日志对象个数
+#define LOG_WATCH_DELAY		50		//配置文件变化后等待写入完成的毫秒数
+#define LOG_BACKEND_QUANTUM	64		//共享调度线程每轮为权重1的日志对象处理的条数
+#define LOG_LEVEL_DUMP		((log_level)(DEBUG + 1))	//log_dump_recorder放入队列的请求
+#define LOG_CRASH_DRAIN		4096	//崩溃时最多从队列中直接输出的条数
+#define LOG_CRASH_FRAMES	64		//崩溃处理函数输出的调用栈层数
+#define LOG_CRASH_STACK		65536	//崩溃处理函数使用的备用栈大小
+#define LOG_QUEUE_CHUNK		64		//队列变长布局的块大小，没有字段的日志不占用kv所在的块
+#define LOG_RENDER_LEN		(RENDER_BUF_LEN + LOG_PAYLOAD_MAX)	//渲染缓冲区的大小，池中的长消息也能完整渲染
+#define LOG_LANE_NUM		(DEBUG + 1)		//每个级别一个通道
+#define LOG_EVICT_RETRY		4		//LOG_OVERFLOW_EVICT丢弃最早的日志后重新取得槽位的次数
+#define LOG_SHED_HOLD		100		//负载削减至少保持的毫秒数，之后低于低水位才恢复一个级别
+
+enum log_sink_s {SINK_CONSOLE = 0, SINK_FILE, SINK_SOCKET, SINK_NUM};	//和配置文件中的设备顺序一致，之后是自定义设备
 ///////////////////////////queue///////////////////////////
 struct queue_element_t {
     log_mode mode;
     log_level level;
-    struct timeval timestamp;
+    log_clock clock;			//time使用的时钟，转换后为LOG_CLOCK_REALTIME
+    int tid;					//写日志的线程号
+    int64_t time;				//写日志时时钟的读数，输出前由调度线程转换为1970年以来的纳秒数
     char category[CATEGORY_LEN];
     char msg[LOG_LEN];
+    const char *fmt;			//不为NULL时kv中是log_write_args的参数，由调度线程格式化到msg
+    char *ext;					//超过LOG_LEN的完整消息(池中的块)，不为NULL时代替msg输出，调度线程输出后归还
+    const log_site *site;		//调用点，没有时为NULL
+    unsigned short kv_len;
+    char kv[LOG_KV_LEN];		//log_write_kv编码后的字段
 };
 
+/**
+ * @brief	崩溃时直接写入的描述符和格式，发布配置快照时更新，信号处理函数只读取这里的整数，不访问快照
+ */
+typedef struct crash_route_s {
+    volatile int fd[SINK_NUM + 1];	//终端，日志文件，socket，调试文件，-1表示不写
+    volatile log_format format[SINK_NUM];
+    volatile log_escape escape[SINK_NUM];
+    volatile int digits;
+    shm_ring *volatile shm;		//生产者模式写入共享内存环
+} crash_route;
+
+/**
+ * @brief	log_write_crash使用的预留区，log_init时分配
+ */
+typedef struct crash_reserve_s {
+    queue_element job;
+    char buf[LOG_RENDER_LEN];
+} crash_reserve;
+
 const char *log_level_str[] = {"FATAL", "ERROR", "INFO", "DEBUG"};
 const char *unknown = "UNKNOWN";
+static const char *log_clock_str[] = {"realtime", "coarse", "monotonic_raw", "tsc"};
+
+static log_site *volatile site_list = NULL;		//所有已经注册的调用点
+static volatile int site_count = 0;
+static volatile int64_t suppress_total = 0;		//所有调用点被限流丢弃的总条数
+
+/**
+ * @brief	调度线程为一个设备攒的一批日志
+ */
+typedef struct sink_batch_s {
+    char *buf;					//第一次使用时分配LOG_SINK_BUF_LEN字节
+    int used;
+    int num;
+    log_line lines[LOG_SINK_BATCH];
+} sink_batch;
+
+typedef struct log_conf_s log_conf;
+
+/**
+ * @brief	log_watch创建的监视线程，线程只使用这个结构中的字段，替换后在锁外停止和释放
+ */
+typedef struct log_watcher_s {
+    log_t *log;
+    pthread_t id;
+    int pipe[2];				//通知监视线程重新加载('r')或者退出('q')
+    int slot;					//在watch_fds中的位置，-1表示没有注册信号
+    volatile int quit;			//watch_free设置，管道满写不进'q'时监视线程也能看到
+    char path[];
+} log_watcher;
+
+/**
+ * @brief	调度线程的上下文，开启NUMA后每个节点一个，写日志的线程把日志放入本节点的队列
+ */
+typedef struct log_worker_s {
+    log_t *log;
+    queue_array *queue;			//默认队列
+    queue_array *lanes[LOG_LANE_NUM];	//每个级别使用的队列，没有单独通道时是queue
+    queue_array *order[LOG_LANE_NUM];	//不重复的队列，按照其中最高的级别排列
+    int lane_num;
+    queue_event ready;			//有多个通道时所有通道入队都通知这个事件
+    queue_element *sorted;		//按时间戳重新排序时复制的一批日志，第一次使用时分配
+    pthread_t id;
+    int node;					//所在的NUMA节点，-1表示不绑定
+    char *render_buffer;
+    queue_element pending;		//最近一条输出的日志，只有本调度线程使用
+    int pending_flag;
+    uint64_t pending_hash;
+    int64_t pending_time;
+    int repeat;					//pending之后被合并的条数
+    int64_t sweep_time;			//上次报告调用点丢弃统计的时间
+    volatile int fill;			//上次处理之前INFO和DEBUG队列积压的最大百分比
+    volatile int busy;			//共享调度线程正在处理，同一时间只有一个线程处理一个队列
+    int weight;					//共享调度线程中的权重
+    volatile int running;		//调度线程退出时清0，log_kill等待批写完
+    volatile int stop;			//log_kill设置，调度线程写完当前批之后退出
+    log_conf *conf;				//正在处理的一批日志使用的配置快照
+    unsigned int dirty;			//本批写过的设备
+    int blocked;				//本批有非阻塞设备返回了EAGAIN
+    sink_batch batch[LOG_SINK_MAX];
+} log_worker;
+
+/**
+ * @brief	共享调度线程服务的队列集合，和配置快照一样整体替换，旧集合延迟释放
+ */
+typedef struct backend_set_s {
+    int num;
+    log_worker *workers[];
+} backend_set;
+
+struct log_backend_s {
+    pthread_t *threads;
+    int thread_num;
+    backend_set *volatile set;
+    pthread_mutex_t lock;		//串行化attach和detach
+    queue_event ready;			//所有队列入队时通知
+    volatile unsigned int cursor;	//轮询的起点
+    volatile int stop;
+    volatile int64_t served;
+    volatile int64_t parks;
+};
+
+/**
+ * @brief	配置快照，发布之后不再修改
+ *
+ * 修改配置时复制当前快照，修改后替换指针，旧快照在读者离开读区间后释放，
+ * 写日志和调度线程只在rcu读区间中读取快照，不需要加锁
+ */
+struct log_conf_s {
+    int log_flag;				//log t enable or shutdown, just do not add_log and get_log
+    log_level level;			//允许输出的最低级别
+    sink_ref *sinks[LOG_SINK_MAX];	//下标是输出模式的位:终端，文件路由，socket，之后是自定义设备
+    sink_ref *shm;				//生产者模式，日志写入共享内存由收集进程输出
+    log_format format[LOG_SINK_MAX];	//每个输出设备的日志格式
+    log_escape escape[LOG_SINK_MAX];	//每个输出设备文本格式下的转义方式
+    layout *layout[LOG_SINK_MAX];	//格式为LOG_FORMAT_PATTERN的设备使用的模板
+    recorder *rec;				//飞行记录器，低于输出级别的日志保存在内存中，FATAL时输出
+    int rec_dump;				//每次最多输出的条数，0表示全部
+    int index_records;			//日志文件每多少条生成一个时间索引项，和index_bytes都为0表示不生成
+    int index_bytes;
+    log_clock clock;			//写日志时读取的时钟
+    log_overflow overflow[LOG_LANE_NUM];	//每个级别队列满时的策略
+    int reorder;				//调度线程每批按时间戳重新排序
+    int shed_high;				//队列积压超过这个百分比时削减一个级别，0表示关闭
+    int shed_low;				//低于这个百分比时恢复一个级别
+    log_mode shed_mode;			//负载削减的变化日志的输出模式
+    pool *payload;				//保存长消息的内存池，NULL表示长消息截断
+    log_clock stamp;			//实际使用的时钟，生产者模式下需要转换的时钟改为REALTIME，收集进程只按墙上时间合并
+    int time_digits;			//输出时间中秒的小数位数
+    log_worker *workers;		//写日志的线程选择队列使用
+    int worker_num;
+};
 
 struct log_lib_t {
-    queue_array *data;
-    volatile int log_flag;		//log t enable or shutdown, just do not add_log and get_log
+    log_conf *volatile conf;
+    queue_array *data;			//第一个调度线程的队列
+    log_worker *workers;
+    int worker_num;
+    int node_worker[TOPO_MAX_NODE];	//节点对应的调度线程
+    int lane_size[LOG_LANE_NUM];	//单独通道的容量，0表示使用默认队列
+    cpu_set_t affinity;			//调度线程可以使用的cpu
+    int affinity_num;
+    log_backend_t *backend;		//不为NULL时由共享调度线程服务
+    queue_event polled;			//内联调度时所有队列入队都通知这个事件，通知写入poll_fd
+    int poll_fd;				//内联调度的eventfd，-1表示不是内联调度
+    volatile int64_t polls;		//log_poll的调用次数
+    log_watcher *watch;			//监视配置文件的线程，在写锁中替换，锁外停止
     volatile int init_flag;
     volatile int start_flag;
-    pthread_rwlock_t lock;
+    pthread_rwlock_t lock;		//串行化修改配置的操作
     volatile int64_t total;		//recored num
-    pthread_t id;
-    FILE *log_fp[2];
-    /* FILE *debug_fp; */
-    int sock;
-    char *render_buffer;
+    volatile log_level shed;	//负载削减时允许入队的最低级别，DEBUG表示没有削减
+    volatile int64_t shed_time;	//上次改变削减级别的时间
+    volatile int shed_changes;	//削减级别改变的次数
+    volatile int64_t shed_dropped;	//被削减的条数，统计值不保证精确
+    shm_ring **rings;			//收集模式，所有生产者的共享内存环
+    int ring_num;
+    int64_t collect_bad;		//收集时丢弃的无效记录
+    time_t scan_time;
+    volatile int coalesce_window;	//合并重复日志的时间窗口(毫秒)，0表示关闭
+    volatile int coalesce_max;
+    volatile int64_t coalesced;	//被合并的总条数
+    crash_route crash;			//log_write_crash使用的设备
+    crash_reserve *reserve;
+    volatile int crash_busy;	//预留区正在使用
 };
 
 
 //////////////////////////////////////////////
 static inline const char *level2str(log_level level);
-static void log_recored(log_t *this,  queue_element *job);
-static void catch_signal(int i);
+static void log_recored(log_worker *w,  queue_element *job);
 static void *entry(void *p);
+static void worker_tick(log_worker *w, int64_t now);
+static void collect_scan(log_t *this, const char *name);
+static void log_coalesce(log_worker *w, queue_element *job);
+static void recorder_dump(log_worker *w, log_mode mode);
+static void coalesce_expire(log_worker *w, int64_t now);
+static int coalesce_wait(log_worker *w, int64_t now);
+static void log_kill(log_t *this);
+static void site_release(log_t *this);
+static void watch_stop(log_t *this);
+static int sock_connect(const char *ip, const char *port, sock_type type);
+static void log_detach(log_t *this);
+static void crash_uninstall(log_t *this);
+static inline void log_free(queue_element *e);
+static inline void log_stamp(queue_element *job);
 ///////////////////////////////////////////////////////////////////
 
+static void conf_free(void *p)
+{
+    log_conf *conf = p;
+    int i;
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        sink_put(conf->sinks[i]);
+        layout_put(conf->layout[i]);
+    }
+
+    sink_put(conf->shm);
+    free(conf);
+}
+
+/**
+ * @brief	conf_copy	复制当前的配置快照用于修改，需要持有写锁
+ *
+ * @return	失败返回NULL
+ */
+static log_conf *conf_copy(log_t *this)
+{
+    log_conf *conf = malloc(sizeof(log_conf));
+    int i;
+
+    if(conf == NULL) {
+        return NULL;
+    }
+
+    memcpy(conf, this->conf, sizeof(log_conf));
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        sink_get(conf->sinks[i]);
+        layout_get(conf->layout[i]);
+    }
+
+    sink_get(conf->shm);
+    return conf;
+}
+
+/**
+ * @brief	crash_update	记录快照中内置设备的描述符，流式socket可能正在发送半条日志，崩溃时不写
+ */
+static void crash_update(log_t *this, log_conf *conf)
+{
+    crash_route *c = &this->crash;
+    sink_ref *file = conf->sinks[SINK_FILE], *sock = conf->sinks[SINK_SOCKET];
+    int i;
+
+    c->fd[SINK_CONSOLE] = conf->sinks[SINK_CONSOLE] != NULL ? STDERR_FILENO : -1;
+    c->fd[SINK_FILE] = file == NULL ? -1 : file->sub[0] != NULL ? file->sub[0]->fd : STDERR_FILENO;
+    c->fd[SINK_NUM] = file == NULL ? -1 : file->sub[1] != NULL ? file->sub[1]->fd : STDERR_FILENO;
+    c->fd[SINK_SOCKET] = sock != NULL && sock->sock_type == SOCK_DGRAM ? sock->fd : -1;
+
+    for(i = 0; i < SINK_NUM; i++) {
+        c->format[i] = conf->format[i] != LOG_FORMAT_PATTERN ? conf->format[i] : LOG_FORMAT_TEXT;	//信号处理函数不访问模板
+        c->escape[i] = conf->escape[i];
+    }
+
+    c->digits = conf->time_digits;
+    c->shm = conf->shm != NULL ? conf->shm->shm : NULL;
+}
+
+/**
+ * @brief	conf_index	按照快照的设置打开或者关闭文件路由中日志文件和调试文件的时间索引
+ */
+static void conf_index(log_conf *conf, sink_ref *route)
+{
+    int i;
+
+    for(i = 0; route != NULL && i < 2; i++) {
+        if(route->sub[i] != NULL && sink_file_index(route->sub[i], conf->index_records, conf->index_bytes) != 0) {
+            fprintf(stderr, "open index of %s failed\n", route->sub[i]->path);
+        }
+    }
+}
+
+/**
+ * @brief	conf_publish	发布新的配置快照，旧快照延迟释放，需要持有写锁
+ */
+static void conf_publish(log_t *this, log_conf *conf)
+{
+    log_conf *old = this->conf;
+    conf->stamp = conf->shm != NULL && conf->clock >= LOG_CLOCK_MONOTONIC_RAW ? LOG_CLOCK_REALTIME : conf->clock;
+    crash_update(this, conf);
+    __sync_synchronize();		//快照的内容在指针之前可见
+    this->conf = conf;
+    rcu_retire(old, conf_free);
+}
+
+/**
+ * @brief	worker_order	按照优先级排列调度线程的队列，有多个通道时所有通道入队都通知ready
+ */
+static void worker_order(log_worker *w)
+{
+    int i, j;
+
+    for(i = 0, w->lane_num = 0; i < LOG_LANE_NUM; i++) {
+        for(j = 0; j < w->lane_num && w->order[j] != w->lanes[i]; j++);
+
+        if(j == w->lane_num) {
+            w->order[w->lane_num++] = w->lanes[i];
+        }
+    }
+
+    for(i = 0; i < w->lane_num; i++) {
+        queue_set_notify(w->order[i], w->lane_num > 1 ? &w->ready : NULL);
+    }
+}
+
+/**
+ * @brief	worker_lanes	为设置了通道的级别创建调度线程的队列，需要持有写锁
+ *
+ * @return	成功返回0
+ */
+static int worker_lanes(log_t *this, log_worker *w)
+{
+    queue_array *q;
+    int i, ret = 0;
+
+    for(i = 0; i < LOG_LANE_NUM; i++) {
+        if(this->lane_size[i] == 0 || w->lanes[i] != w->queue) {
+            continue;
+        }
+
+        if((q = create_queue()) != NULL) {
+            queue_set_node(q, w->node);
+            queue_set_layout(q, LOG_QUEUE_CHUNK);
+            queue_set_wait(q, w->queue->spin, w->queue->busy_poll);
+        }
+
+        if(q == NULL || q->init(q, this->lane_size[i], sizeof(struct queue_element_t)) != 0) {
+            fprintf(stderr, "create lane for %s failed\n", level2str(i));
+            queue_destroy(q);
+            ret = -1;
+            continue;
+        }
+
+        w->lanes[i] = q;
+    }
+
+    worker_order(w);
+    return ret;
+}
+
 log_t *log_create()
 {
     log_t *temp = malloc(sizeof(log_t));
@@ -55,6 +405,18 @@ log_t *log_create()
     }
 
     memset(temp, 0, sizeof(log_t));
+
+    if((temp->conf = calloc(1, sizeof(log_conf))) == NULL) {
+        free(temp);
+        return NULL;
+    }
+
+    temp->conf->level = DEBUG;
+    temp->conf->time_digits = 3;
+    temp->conf->shed_mode = TO_CONSOLE_AND_FILE;
+    temp->shed = DEBUG;
+    temp->poll_fd = -1;
+
     pthread_rwlockattr_t attr;
     pthread_rwlockattr_init(&attr);
     pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
@@ -64,6 +426,7 @@ log_t *log_create()
 
     if(temp->data == NULL) {
         pthread_rwlock_destroy(&temp->lock);
+        free(temp->conf);
         free(temp);
         return NULL;
     }
@@ -77,28 +440,60 @@ void log_destroy(log_t *this)
         return;
     }
 
+    watch_stop(this);		//监视线程可能正在等待写锁
     pthread_rwlock_wrlock(&this->lock);
 
     if(this->init_flag == 0) {
         return ;
     }
 
-    if(this->id != 0) {
-        pthread_kill(this->id, LOG_STOP_SIGNAL);
-        this->id = 0;
+    crash_uninstall(this);
+    log_kill(this);
+    log_detach(this);
+    site_release(this);
+    queue_element *job;
+    queue_array *q;
+    int i, j, len;
+
+    for(i = 0; i < this->worker_num; i++) {
+        for(j = 0; j < this->workers[i].lane_num; j++) {
+            q = this->workers[i].order[j];
+
+            while((job = q->peek(q, &len, 0)) != NULL) {	//没有输出的长消息归还到池中，池才能被释放
+                log_free(job);
+                q->release(q, job);
+            }
+
+            queue_destroy(q);
+        }
+
+        free(this->workers[i].sorted);
+        free(this->workers[i].render_buffer);
+
+        for(j = 0; j < LOG_SINK_MAX; j++) {
+            free(this->workers[i].batch[j].buf);
+        }
     }
 
-    queue_destroy(this->data);
+    free(this->workers);
+    free(this->reserve);
+    rcu_synchronize();		//被替换的快照中的自定义设备在返回之前关闭
+    rcu_reclaim();
+    recorder_destroy(this->conf->rec);
+    pool_release(this->conf->payload);
+    conf_free(this->conf);
+    this->conf = NULL;
 
-    if(this->log_fp[0] != NULL) {
-        fclose(this->log_fp[0]);
+    for(i = 0; i < this->ring_num; i++) {
+        shm_ring_close(this->rings[i], 0);
     }
 
-    if(this->log_fp[1] != NULL) {
-        fclose(this->log_fp[1]);
+    free(this->rings);
+
+    if(this->poll_fd >= 0) {
+        close(this->poll_fd);
     }
 
-    free(this->render_buffer);
     pthread_rwlock_unlock(&this->lock);
     pthread_rwlock_destroy(&this->lock);
     free_safe(this);
@@ -118,48 +513,101 @@ LOG_BOOL log_init(log_t *this)
         return LOG_TRUE;
     }
 
-    this->data = create_queue();
-    this->render_buffer = malloc(RENDER_BUF_LEN);
+    if(this->data == NULL) {
+        this->data = create_queue();
+    }
 
-    if(this->render_buffer  ==  NULL) {
-        fprintf(stderr, "log init failed\n");
-        pthread_rwlock_unlock(&this->lock);
-        return LOG_FALSE;
+    this->workers = calloc(1, sizeof(log_worker));
+    this->reserve = malloc(sizeof(crash_reserve));
+
+    if(this->workers != NULL) {
+        this->workers[0].render_buffer = malloc(LOG_RENDER_LEN);
     }
 
-    if(this->data->init(this->data, LOG_BUFFER_NUM, sizeof(struct queue_element_t)) != 0) {
+    if(this->workers == NULL || this->workers[0].render_buffer  ==  NULL || this->data == NULL || this->reserve == NULL) {
         fprintf(stderr, "log init failed\n");
-        free(this->render_buffer);
+
+        if(this->workers != NULL) {
+            free(this->workers[0].render_buffer);
+            free(this->workers);
+            this->workers = NULL;
+        }
+
+        free(this->reserve);
+        this->reserve = NULL;
+
         pthread_rwlock_unlock(&this->lock);
         return LOG_FALSE;
     }
 
-    this->init_flag = 1;
-    this->log_flag = 1;
-    this->start_flag = 0;
-    this->total = 0;
+    log_conf *conf = conf_copy(this);
+    int i;
+
+    if(conf != NULL) {
+        for(i = 0; i < LOG_SINK_MAX; i++) {
+            sink_put(conf->sinks[i]);
+            conf->sinks[i] = NULL;
+        }
 
-    if(this->log_fp[0] != NULL) {
-        fclose(this->log_fp[0]);
+        conf->sinks[SINK_CONSOLE] = sink_console();
+        conf->sinks[SINK_FILE] = sink_file_route(NULL, NULL);	//没有设置文件时写入stderr
     }
 
-    this->log_fp[0] = NULL;
+    queue_set_layout(this->data, LOG_QUEUE_CHUNK);
+
+    if(conf == NULL || conf->sinks[SINK_FILE] == NULL || this->data->init(this->data, LOG_BUFFER_NUM, sizeof(struct queue_element_t)) != 0) {
+        fprintf(stderr, "log init failed\n");
+
+        if(conf != NULL) {
+            conf_free(conf);
+        }
 
-    if(this->log_fp[1] != NULL) {
-        fclose(this->log_fp[1]);
+        free(this->workers[0].render_buffer);
+        free(this->workers);
+        this->workers = NULL;
+        free(this->reserve);
+        this->reserve = NULL;
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
     }
 
-    this->log_fp[1] = NULL;
+    this->workers[0].log = this;
+    this->workers[0].queue = this->data;
+    this->workers[0].node = -1;
+    this->worker_num = 1;
 
-    if(this->sock != 0) {
-        close(this->sock);
+    for(i = 0; i < LOG_LANE_NUM; i++) {
+        this->workers[0].lanes[i] = this->data;
     }
 
-    this->sock = 0;
+    worker_order(&this->workers[0]);
+
+    this->init_flag = 1;
+    this->start_flag = 0;
+    this->total = 0;
+    conf->log_flag = 1;
+    conf->workers = this->workers;
+    conf->worker_num = 1;
+    conf_publish(this, conf);
     pthread_rwlock_unlock(&this->lock);
     return LOG_TRUE;
 }
 
+/**
+ * @brief	log_set_flag	发布只修改了log_flag的快照，需要持有写锁
+ */
+static void log_set_flag(log_t *this, int flag)
+{
+    log_conf *conf;
+
+    if(this->conf->log_flag == flag || (conf = conf_copy(this)) == NULL) {
+        return;
+    }
+
+    conf->log_flag = flag;
+    conf_publish(this, conf);
+}
+
 inline void log_disable(log_t *this)
 {
     if(this == NULL) {
@@ -167,7 +615,7 @@ inline void log_disable(log_t *this)
     }
 
     pthread_rwlock_wrlock(&this->lock);
-    this->log_flag = 0;
+    log_set_flag(this, 0);
     pthread_rwlock_unlock(&this->lock);
 }
 
@@ -179,7 +627,7 @@ inline void log_enable(log_t *this)
     }
 
     pthread_rwlock_wrlock(&this->lock);
-    this->log_flag = 0;
+    log_set_flag(this, 1);
     pthread_rwlock_unlock(&this->lock);
 }
 
@@ -196,13 +644,10 @@ void log_stop(log_t *this)
         return ;
     }
 
-    if(this->id != 0) {
-        pthread_kill(this->id, LOG_STOP_SIGNAL);
-        this->id = 0;
-    }
-
+    log_kill(this);
+    log_detach(this);
     this->start_flag = 0;
-    this->log_flag = 0;
+    log_set_flag(this, 0);
     pthread_rwlock_unlock(&this->lock);
 }
 
@@ -213,340 +658,3552 @@ void log_print_status(log_t *this, FILE *stream)
         return ;
     }
 
+    int i;
     pthread_rwlock_rdlock(&this->lock);
-    fprintf(stream, "[log]\n\tlog_buffer_num=%d\n\tlog_total=%ld\n\tused_max_buffer=%d\n\tdrop_log_num=%d\n", LOG_BUFFER_NUM, this->total, this->data->used_max, this->data->drop_count);
-    pthread_rwlock_unlock(&this->lock);
-}
+    shm_ring *shm = this->conf->shm != NULL ? this->conf->shm->shm : NULL;
 
-LOG_BOOL log_write(log_t *this, log_mode mode, log_level level, char *category, char *fmt, ...)
-{
-    queue_element temp;
+    if(shm != NULL) {
+        fprintf(stream, "[log]\n\tshm=%s\n\tlog_buffer_num=%d\n\tlog_total=%ld\n\tdrop_log_num=%d\n", shm_ring_name(shm), LOG_SHM_BUFFER_NUM, this->total, shm_ring_drop_count(shm));
+    } else {
+        fprintf(stream, "[log]\n\tlog_buffer_num=%d\n\tlog_total=%ld\n\tused_max_buffer=%d\n\tdrop_log_num=%d\n", LOG_BUFFER_NUM, this->total, this->data->used_max, this->data->drop_count);
+        fprintf(stream, "\twakeup_num=%ld\n\tpark_num=%ld\n\tspin_us=%d%s\n", this->data->wakeups, this->data->parks, this->data->spin,
+                this->data->busy_poll ? "(busy_poll)" : "");
+    }
 
-    if(this == NULL) {
-        return LOG_FALSE;
+    if(this->poll_fd >= 0) {
+        fprintf(stream, "\tinline_fd=%d\n\tinline_polls=%ld\n", this->poll_fd, this->polls);
     }
 
-    pthread_rwlock_rdlock(&this->lock);
+    if(this->worker_num > 1) {
+        queue_array *q;
 
-    if(this->log_flag  ==  0) {
-        pthread_rwlock_unlock(&this->lock);
-        return LOG_FALSE;
+        for(i = 0; i < this->worker_num; i++) {
+            q = this->workers[i].queue;
+            fprintf(stream, "\tnode%d: used_max_buffer=%d drop_log_num=%d wakeup_num=%ld park_num=%ld\n", this->workers[i].node,
+                    q->used_max, q->drop_count, q->wakeups, q->parks);
+        }
     }
 
-    gettimeofday(&temp.timestamp, NULL);
+    for(i = 0; i < LOG_LANE_NUM; i++) {
+        if(this->lane_size[i] > 0 && this->workers[0].lanes[i] != this->data) {
+            queue_array *q = this->workers[0].lanes[i];
+            fprintf(stream, "\tlane_%s: log_buffer_num=%d used_max_buffer=%d drop_log_num=%d\n", level2str(i), this->lane_size[i],
+                    q->used_max, q->drop_count);
+        }
 
-    if(category != NULL) {
-        memcpy(temp.category, category, CATEGORY_LEN);
-    } else {
-        strcpy(temp.category, "main");
+        if(this->conf->overflow[i] != LOG_OVERFLOW_DROP) {
+            fprintf(stream, "\toverflow_%s=%s\n", level2str(i), this->conf->overflow[i] == LOG_OVERFLOW_EVICT ? "evict" : "block");
+        }
+    }
+
+    if(this->conf->reorder) {
+        fprintf(stream, "\treorder=1\n");
+    }
+
+    if(this->conf->shed_high > 0) {
+        fprintf(stream, "\tshed_high=%d%%\n\tshed_low=%d%%\n\tshed_level=%s\n\tshed_changes=%d\n\tshed_dropped=%ld\n", this->conf->shed_high,
+                this->conf->shed_low, level2str(this->shed), this->shed_changes, this->shed_dropped);
+    }
+
+    if(this->ring_num > 0) {
+        fprintf(stream, "\tcollect_rings=%d\n\tcollect_bad=%ld\n", this->ring_num, this->collect_bad);
+    }
+
+    if(this->backend != NULL) {
+        fprintf(stream, "\tbackend_threads=%d\n\tbackend_weight=%d\n\tbackend_served=%ld\n\tbackend_parks=%ld\n", this->backend->thread_num,
+                this->workers[0].weight, this->backend->served, this->backend->parks);
+    }
+
+    if(this->coalesce_window > 0) {
+        fprintf(stream, "\tcoalesced_total=%ld\n", this->coalesced);
+    }
+
+    fprintf(stream, "\tsuppressed_total=%ld\n\tescape_impl=%s\n", suppress_total, escape_impl());
+    fprintf(stream, "\tclock=%s\n\tclock_ns_per_tick=%.6f\n\ttime_digits=%d\n", log_clock_str[this->conf->stamp],
+            stamp_rate(this->conf->stamp), this->conf->time_digits);
+
+    if(this->conf->payload != NULL) {
+        int64_t hits, misses, oversize;
+        int used;
+        pool_stats(this->conf->payload, &hits, &misses, &oversize, &used);
+        fprintf(stream, "\tpayload_max=%d\n\tpayload_hit=%ld\n\tpayload_miss=%ld\n\tpayload_oversize=%ld\n\tpayload_used=%d\n",
+                pool_max(this->conf->payload), hits, misses, oversize, used);
+    }
+
+    if(this->conf->rec != NULL) {
+        fprintf(stream, "\trecorder_rings=%d\n\trecorder_total=%ld\n", recorder_rings(this->conf->rec), recorder_total(this->conf->rec));
+    }
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        sink_print(this->conf->sinks[i], i, stream);
     }
 
-    va_list va;
-    va_start(va , fmt);
-    vsnprintf(temp.msg, LOG_LEN, fmt, va);
-    va_end(va);
-    temp.mode = mode;
-    temp.level = level;
-    this->data->in_queue(this->data, &temp, QUEUE_UNBLOCK);
-    ++this->total;
     pthread_rwlock_unlock(&this->lock);
-    return LOG_TRUE;
 }
 
-//static LOG_BOOL log_dispatch( log_t *this, dispatch_type type, callback_do_type dotype, void ( *wrap )( log * ) );
-LOG_BOOL log_dispatch(log_t *this, dispatch_type type)
+/**
+ * @brief	log_tid	当前线程的线程号，第一次调用后缓存
+ */
+static inline int log_tid(void)
 {
-    if(this  ==  NULL) {
-        return LOG_FALSE;
+    static __thread int tid = 0;
+
+    if(tid == 0) {
+        tid = syscall(SYS_gettid);
     }
 
-    pthread_rwlock_wrlock(&this->lock);
+    return tid;
+}
 
-    if(this->init_flag == 0 || this->start_flag == 1) {
-        return LOG_FALSE;
+static inline void log_fill(queue_element *temp, log_clock clock, log_mode mode, log_level level, char *category, log_site *site)
+{
+    temp->time = stamp_read(clock);
+    temp->clock = clock;
+    temp->tid = log_tid();
+
+    if(category != NULL) {
+        memcpy(temp->category, category, CATEGORY_LEN);
+        temp->category[CATEGORY_LEN - 1] = '\0';
+    } else {
+        strcpy(temp->category, "main");
     }
 
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
+    temp->mode = mode;
+    temp->level = level;
+    temp->fmt = NULL;
+    temp->ext = NULL;
+    temp->site = site;
+    temp->kv_len = 0;
+}
 
-    switch(type) {
-        case DISPATCH_UNBLOCK:
-            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+/**
+ * @brief	render_site	输出调用点信息 " (file,line:func)"
+ */
+static void render_site(fmt_buf *b, const log_site *site)
+{
+    fmt_putn(b, " (", 2);
+    fmt_puts(b, site->file);
+    fmt_putc(b, ',');
+    fmt_u64(b, site->line);
+    fmt_putc(b, ':');
+    fmt_puts(b, site->func);
+    fmt_putc(b, ')');
+}
 
-            if(pthread_create((pthread_t *)(&this->id), &attr, entry, (void *)this) != 0) {
-                this->start_flag = 0;
-                this->id = 0;
-                pthread_rwlock_unlock(&this->lock);
-                return LOG_FALSE;
-            }
+/**
+ * @brief	log_len	日志实际使用的字节数，kv在最后
+ */
+static inline int log_len(const queue_element *e)
+{
+    return offsetof(queue_element, kv) + e->kv_len;
+}
 
-            break;
-        case DISPATCH_BLOCK:
+/**
+ * @brief	log_queue	写日志的线程使用的队列:开启NUMA时是所在节点的调度线程，设置了通道时是该级别的通道
+ */
+static inline queue_array *log_queue(log_t *this, log_conf *conf, log_level level)
+{
+    log_worker *w = conf->worker_num > 1 ? &conf->workers[this->node_worker[topo_current_node() % TOPO_MAX_NODE]] : conf->workers;
+    return level < LOG_LANE_NUM ? w->lanes[level] : w->queue;
+}
 
-            if(pthread_create((pthread_t *)(&this->id), NULL, entry, (void *)this) != 0) {
-                this->start_flag = 0;
-                this->id = 0;
-                pthread_rwlock_unlock(&this->lock);
-                return LOG_FALSE;
-            }
+/**
+ * @brief	log_reserve	在队列中取得槽位，队列满时按照级别的溢出策略处理
+ */
+static inline queue_element *log_reserve(log_conf *conf, queue_array *q, log_level level)
+{
+    queue_element *e;
+    int i, len;
 
-            if(pthread_join(this->id, NULL) != 0) {
-                perror("block failed");
+    switch(conf->overflow[level]) {
+        case LOG_OVERFLOW_BLOCK:
+            return q->reserve_timed(q, sizeof(queue_element), LOG_LANE_WAIT);
+        case LOG_OVERFLOW_EVICT:
+
+            for(i = 0; (e = q->reserve(q, sizeof(queue_element), QUEUE_UNBLOCK)) == NULL && i < LOG_EVICT_RETRY - 1; i++) {
+                if((e = q->peek(q, &len, 0)) != NULL) {		//和调度线程一样出队，每次失败的reserve计为一条丢弃
+                    log_free(e);
+                    q->release(q, e);
+                }
             }
 
-            break;
+            return e;
         default:
-            break;
+            return q->reserve(q, sizeof(queue_element), QUEUE_UNBLOCK);
     }
+}
 
-    pthread_rwlock_unlock(&this->lock);
-    return LOG_TRUE;
+/**
+ * @brief	log_msg	日志的消息，长消息在池中
+ */
+static inline const char *log_msg(const queue_element *e)
+{
+    return e->ext != NULL ? e->ext : e->msg;
 }
 
+/**
+ * @brief	log_free	归还长消息使用的块，调度线程处理完一条日志之后调用
+ */
+static inline void log_free(queue_element *e)
+{
+    if(e->ext != NULL) {
+        pool_put(e->ext);
+        e->ext = NULL;
+    }
+}
 
-static void *entry(void *p)
+/**
+ * @brief	log_extend	把超过LOG_LEN的消息复制到池中的块，没有空闲块时只保留msg中截断的部分
+ */
+static void log_extend(pool *p, queue_element *e, const char *msg, int len)
 {
-    if(p  ==  NULL) {
-        return NULL;
+    char *buf;
+    int size;
+
+    if(len >= LOG_LEN && (buf = pool_get(p, len + 1, &size)) != NULL) {
+        len = len < size ? len : size - 1;
+        memcpy(buf, msg, len);
+        buf[len] = '\0';
+        e->ext = buf;
     }
+}
 
-    log_t *this = (log_t *)p;
+/**
+ * @brief	log_vextend	消息在msg中被截断时按第一次格式化得到的完整长度从池中取得块，只在块中再格式化一次
+ */
+static void log_vextend(pool *p, queue_element *e, int len, const char *fmt, va_list va)
+{
+    fmt_buf b;
+    char *buf;
+    int size;
 
-    if(this->render_buffer  == NULL) {
-        fprintf(stderr, "malloc render_buffer failed\n");
+    if((buf = pool_get(p, len + 1, &size)) == NULL) {
+        return;
     }
 
-    queue_element job;
-    sigset_t sigmask;
-    int ret;
-    sigfillset(&sigmask);
-    sigdelset(&sigmask, LOG_STOP_SIGNAL);
-    pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
-    signal(LOG_STOP_SIGNAL, catch_signal);
+    fmt_init(&b, buf, size);
+    fmt_vformat(&b, fmt, va);
+    fmt_end(&b);
+    e->ext = buf;
+}
 
-    while(1) {		//对回调函数进行封装，屏蔽所有线程池调用细节
-        ret = this->data->out_queue(this->data, &job , QUEUE_BLOCK);
+static inline void log_push(log_t *this, log_conf *conf, queue_element *temp)
+{
+    queue_array *q;
+    fmt_buf b;
 
-        if(ret == QUEUE_OP_SUCCESS) {
-            log_recored(this, &job);
-        } else if(ret == QUEUE_OP_ERROR) {
-            fprintf(stderr, "log-dispatch : get log error\n");
+    if(conf->shm != NULL) {
+        if(temp->site != NULL && temp->level == DEBUG) {	//调用点的地址在收集进程中无效，位置信息追加到消息后面
+            fmt_init(&b, temp->msg, LOG_LEN);
+            b.cur += strlen(temp->msg);
+            render_site(&b, temp->site);
+            fmt_end(&b);
         }
+
+        temp->site = NULL;
+        shm_ring_push(conf->shm->shm, temp);
+    } else {
+        q = log_queue(this, conf, temp->level);
+        q->in_queue(q, temp, QUEUE_UNBLOCK);
     }
 
-    return NULL;
+    ++this->total;
 }
 
-static void catch_signal(int i)
+void log_site_register(log_site *site)
 {
-    pthread_exit(0);
+    if(site == NULL || !__sync_bool_compare_and_swap(&site->id, 0, -1)) {	//已经注册或者其他线程正在注册
+        return;
+    }
+
+    do {
+        site->next = site_list;
+    } while(!__sync_bool_compare_and_swap(&site_list, site->next, site));
+
+    site->id = __sync_add_and_fetch(&site_count, 1);
 }
 
-LOG_BOOL log_set_file(log_t *this, char *log_file, char *debug_file)
+static inline int64_t now_ns(void)
 {
-    FILE *fp;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-    if(log_file == NULL) {
-        return LOG_FALSE;
+/**
+ * @brief	site_allow	采样和令牌桶检查，令牌桶使用GCRA算法，只需要对一个时间戳做CAS
+ *
+ * @return	允许输出返回1，被丢弃返回0
+ */
+static int site_allow(log_site *site)
+{
+    int rate = site->rate, sample = site->sample, burst;
+    int64_t now, old, tat, t;
+
+    if(sample > 1 && (unsigned int)__sync_fetch_and_add(&site->sample_count, 1) % sample != 0) {
+        goto suppress;
     }
 
-    pthread_rwlock_wrlock(&this->lock);
-    fp = fopen(log_file, "a+");
+    if(rate > 0) {
+        burst = site->burst > 0 ? site->burst : rate;
+        t = 1000000000LL / rate;
+        now = now_ns();
 
-    if(fp == NULL) {
-        pthread_rwlock_unlock(&this->lock);
-        return LOG_FALSE;
-    }
+        do {
+            old = site->tat;
+            tat = old > now ? old : now;
 
-    if(this->log_fp[0] != NULL) {
-        fclose(this->log_fp[0]);
+            if(tat - now > t * (burst - 1)) {
+                goto suppress;
+            }
+        } while(!__sync_bool_compare_and_swap(&site->tat, old, tat + t));
     }
 
-    this->log_fp[0] = fp;
-    setlinebuf(this->log_fp[0]);
+    return 1;
+suppress:
+    __sync_fetch_and_add(&site->suppressed, 1);
+    __sync_fetch_and_add(&suppress_total, 1);
+    return 0;
+}
 
-    if(debug_file != NULL) {
-        fp = fopen(debug_file, "a+");
+/**
+ * @brief	site_enter	第一次使用时注册调用点，然后进行限流检查
+ *
+ * @return	允许输出返回1
+ */
+static inline int site_enter(log_t *this, log_site *site, const char *fmt, log_mode mode)
+{
+    if(site == NULL) {
+        return 1;
+    }
 
-        if(fp == NULL) {
-            pthread_rwlock_unlock(&this->lock);
-            return LOG_FALSE;
-        }
+    if(site->id == 0) {
+        site->fmt = fmt;
+        site->mode = mode;
+        log_site_register(site);
+    }
 
-        if(this->log_fp[1] != NULL) {
-            fclose(this->log_fp[1]);
-        }
+    if(site->owner == NULL) {		//日志对象销毁后由下一个使用的日志对象接管
+        site->owner = this;
+    }
 
-        this->log_fp[1] = fp;
-        setlinebuf(this->log_fp[1]);
+    if(site->rate > 0 || site->sample > 1) {
+        return site_allow(site);
     }
 
-    pthread_rwlock_unlock(&this->lock);
-    return LOG_TRUE;
+    return 1;
 }
 
-
-LOG_BOOL log_set_socket(log_t *this, char *ip, char *port, sock_type type)
+/**
+ * @brief	site_report	距离上次报告超过LOG_SUPPRESS_INTERVAL秒时，生成调用点的丢弃统计日志
+ *
+ * @return	生成了日志返回1
+ */
+static int site_report(log_site *site, int64_t now, queue_element *job)
 {
-    if(this == NULL	|| ip  ==  NULL || port  == NULL) {
-        return LOG_FALSE;
+    int64_t last = site->report_time;
+    int n;
+    fmt_buf b;
+
+    if(site->suppressed == 0 || now - last < LOG_SUPPRESS_INTERVAL * 1000000000LL
+       || !__sync_bool_compare_and_swap(&site->report_time, last, now)) {
+        return 0;
     }
 
-    if(type != UDP  &&  type != TCP) {
+    if((n = __sync_lock_test_and_set(&site->suppressed, 0)) == 0) {
+        return 0;
+    }
+
+    log_fill(job, LOG_CLOCK_REALTIME, site->mode != 0 ? site->mode : TO_CONSOLE_AND_FILE, site->level, NULL, NULL);
+    fmt_init(&b, job->msg, LOG_LEN);
+    fmt_format(&b, "suppressed %d messages from %s:%d", n, site->file, site->line);
+    fmt_end(&b);
+    return 1;
+}
+
+/**
+ * @brief	site_flush	生产者在输出一条日志之后顺便报告该调用点的丢弃统计，需要在rcu读区间中调用
+ */
+static inline void site_flush(log_t *this, log_conf *conf, log_site *site)
+{
+    queue_element temp;
+
+    if(site != NULL && site->suppressed != 0 && site_report(site, now_ns(), &temp)) {
+        log_push(this, conf, &temp);
+    }
+}
+
+/**
+ * @brief	log_sweep	调度线程定期报告本日志对象拥有的调用点的丢弃统计，覆盖丢弃之后调用点不再输出的情况
+ */
+static void log_sweep(log_worker *w, int64_t now)
+{
+    queue_element job;
+    log_site *site;
+
+    for(site = site_list; site != NULL; site = site->next) {
+        if(site->owner == w->log && site->suppressed != 0 && site_report(site, now, &job)) {
+            log_recored(w, &job);
+        }
+    }
+}
+
+/**
+ * @brief	site_release	日志对象销毁时放弃调用点，之后的丢弃统计由下一个使用调用点的日志对象报告
+ */
+static void site_release(log_t *this)
+{
+    log_site *site;
+
+    for(site = site_list; site != NULL; site = site->next) {
+        __sync_bool_compare_and_swap(&site->owner, this, NULL);
+    }
+}
+
+int log_set_limit(const char *file, int line, int rate, int burst, int sample)
+{
+    log_site *site;
+    int count = 0;
+
+    for(site = site_list; site != NULL; site = site->next) {
+        if((file != NULL && strcmp(site->file, file) != 0) || (line != 0 && site->line != line)) {
+            continue;
+        }
+
+        site->rate = rate > 0 ? rate : 0;
+        site->burst = burst > 0 ? burst : 0;
+        site->sample = sample > 1 ? sample : 0;
+        site->tat = 0;
+        ++count;
+    }
+
+    return count;
+}
+
+void log_print_sites(FILE *stream)
+{
+    log_site *site;
+
+    if(stream == NULL) {
+        return;
+    }
+
+    for(site = site_list; site != NULL; site = site->next) {
+        fprintf(stream, "%d\t%s\t%s:%d\t%s\t%s", site->id, level2str(site->level), site->file, site->line,
+                site->func, site->fmt != NULL ? site->fmt : "");
+
+        if(site->rate > 0 || site->sample > 1) {
+            fprintf(stream, "\trate=%d burst=%d sample=%d", site->rate, site->burst, site->sample);
+        }
+
+        fputc('\n', stream);
+    }
+}
+
+/**
+ * @brief	log_target	取得写日志的位置
+ *
+ * 级别允许输出时返回队列中取得的槽位(*q为该队列)，日志直接写在槽位中；生产者模式返回temp；
+ * 低于输出级别(或者被负载削减)但开启了飞行记录器时返回记录器中本线程的槽位，不入队；否则(包括队列满)返回NULL
+ */
+static inline queue_element *log_target(log_t *this, log_conf *conf, log_level level, queue_element *temp, queue_array **q)
+{
+    *q = NULL;
+
+    if(conf->log_flag == 0) {
+        return NULL;
+    }
+
+    if(level <= conf->level && level <= this->shed) {
+        if(conf->shm != NULL) {
+            return temp;
+        }
+
+        *q = log_queue(this, conf, level);
+        return log_reserve(conf, *q, level);
+    }
+
+    if(level <= conf->level) {		//被负载削减，和级别过滤一样可以保存到飞行记录器
+        ++this->shed_dropped;
+    }
+
+    return conf->rec != NULL ? recorder_begin(conf->rec) : NULL;
+}
+
+/**
+ * @brief	log_commit	提交队列中的槽位，或者把temp写入共享内存，或者结束飞行记录器槽位的写入
+ */
+static inline void log_commit(log_t *this, log_conf *conf, queue_element *e, queue_element *temp, queue_array *q, log_site *site)
+{
+    if(q != NULL) {
+        q->commit(q, e, e->fmt != NULL ? (int)sizeof(queue_element) : log_len(e));	//延迟格式化的日志由调度线程写入msg
+        ++this->total;
+    } else if(e == temp) {
+        log_push(this, conf, e);
+    } else {
+        recorder_end(e);
+        return;
+    }
+
+    site_flush(this, conf, site);
+}
+
+static LOG_BOOL log_vwrite(log_t *this, log_site *site, log_mode mode, log_level level, char *category, const char *fmt, va_list va)
+{
+    queue_element temp, *e;
+    queue_array *q;
+    log_conf *conf;
+    fmt_buf b;
+    va_list ap;
+
+    if(this == NULL || fmt == NULL) {
+        return LOG_FALSE;
+    }
+
+    if(!site_enter(this, site, fmt, mode)) {
+        return LOG_FALSE;
+    }
+
+    rcu_read_lock();
+    conf = this->conf;
+
+    if((e = log_target(this, conf, level, &temp, &q)) == NULL) {
+        rcu_read_unlock();
+        return LOG_FALSE;
+    }
+
+    log_fill(e, conf->stamp, mode, level, category, site);
+    fmt_init(&b, e->msg, LOG_LEN);
+    va_copy(ap, va);
+    fmt_vformat(&b, fmt, ap);
+    va_end(ap);
+    fmt_end(&b);
+
+    if(b.skip > 0 && q != NULL && conf->payload != NULL) {		//msg放不下，加上截掉的长度就是完整的长度
+        log_vextend(conf->payload, e, b.cur - b.start + b.skip, fmt, va);
+    }
+
+    log_commit(this, conf, e, &temp, q, site);
+    rcu_read_unlock();
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_write(log_t *this, log_mode mode, log_level level, char *category, char *fmt, ...)
+{
+    LOG_BOOL ret;
+    va_list va;
+    va_start(va , fmt);
+    ret = log_vwrite(this, NULL, mode, level, category, fmt, va);
+    va_end(va);
+    return ret;
+}
+
+LOG_BOOL log_write_site(log_t *this, log_site *site, log_mode mode, char *category, const char *fmt, ...)
+{
+    LOG_BOOL ret;
+    va_list va;
+
+    if(site == NULL) {
+        return LOG_FALSE;
+    }
+
+    va_start(va , fmt);
+    ret = log_vwrite(this, site, mode, site->level, category, fmt, va);
+    va_end(va);
+    return ret;
+}
+
+static LOG_BOOL log_kv(log_t *this, log_site *site, log_mode mode, log_level level, char *category, const char *msg, const log_field *fields, int num)
+{
+    queue_element temp, *e;
+    queue_array *q;
+    log_conf *conf;
+    fmt_buf b;
+
+    if(this == NULL) {
+        return LOG_FALSE;
+    }
+
+    if(!site_enter(this, site, msg, mode)) {
+        return LOG_FALSE;
+    }
+
+    rcu_read_lock();
+    conf = this->conf;
+
+    if((e = log_target(this, conf, level, &temp, &q)) == NULL) {
+        rcu_read_unlock();
+        return LOG_FALSE;
+    }
+
+    log_fill(e, conf->stamp, mode, level, category, site);
+    fmt_init(&b, e->msg, LOG_LEN);
+    fmt_puts(&b, msg != NULL ? msg : "");
+    fmt_end(&b);
+
+    if(b.cur == b.end && q != NULL && conf->payload != NULL) {
+        log_extend(conf->payload, e, msg, strlen(msg));
+    }
+
+    if(fields != NULL && num > 0) {
+        e->kv_len = kv_encode(e->kv, LOG_KV_LEN, fields, num);
+    }
+
+    log_commit(this, conf, e, &temp, q, site);
+    rcu_read_unlock();
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_write_kv(log_t *this, log_mode mode, log_level level, char *category, const char *msg, const log_field *fields, int num)
+{
+    return log_kv(this, NULL, mode, level, category, msg, fields, num);
+}
+
+LOG_BOOL log_write_kv_site(log_t *this, log_site *site, log_mode mode, char *category, const char *msg, const log_field *fields, int num)
+{
+    if(site == NULL) {
+        return LOG_FALSE;
+    }
+
+    return log_kv(this, site, mode, site->level, category, msg, fields, num);
+}
+
+static LOG_BOOL log_args(log_t *this, log_site *site, log_mode mode, log_level level, char *category, const char *fmt, const log_field *args, int num)
+{
+    queue_element temp, *e;
+    queue_array *q;
+    log_conf *conf;
+    fmt_buf b;
+
+    if(this == NULL || fmt == NULL) {
+        return LOG_FALSE;
+    }
+
+    if(!site_enter(this, site, fmt, mode)) {
+        return LOG_FALSE;
+    }
+
+    rcu_read_lock();
+    conf = this->conf;
+
+    if((e = log_target(this, conf, level, &temp, &q)) == NULL) {
+        rcu_read_unlock();
+        return LOG_FALSE;
+    }
+
+    log_fill(e, conf->stamp, mode, level, category, site);
+    e->msg[0] = '\0';
+
+    if(args != NULL && num > 0) {
+        e->kv_len = kv_encode(e->kv, LOG_KV_LEN, args, num);
+    }
+
+    if(conf->shm != NULL) {		//格式串的地址在收集进程中无效，只能在本进程格式化
+        fmt_init(&b, e->msg, LOG_LEN);
+        kv_format(&b, fmt, e->kv, e->kv_len);
+        fmt_end(&b);
+        e->kv_len = 0;
+    } else {
+        e->fmt = fmt;			//记录到飞行记录器时也不格式化，输出时才格式化
+    }
+
+    log_commit(this, conf, e, &temp, q, site);
+    rcu_read_unlock();
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_write_args(log_t *this, log_mode mode, log_level level, char *category, const char *fmt, const log_field *args, int num)
+{
+    return log_args(this, NULL, mode, level, category, fmt, args, num);
+}
+
+LOG_BOOL log_write_args_site(log_t *this, log_site *site, log_mode mode, char *category, const char *fmt, const log_field *args, int num)
+{
+    if(site == NULL) {
+        return LOG_FALSE;
+    }
+
+    return log_args(this, site, mode, site->level, category, fmt, args, num);
+}
+
+LOG_BOOL log_set_format(log_t *this, log_mode mode, log_format format)
+{
+    log_conf *conf;
+    int i;
+
+    if(this == NULL || format < LOG_FORMAT_TEXT || format > LOG_FORMAT_BINARY) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        if(mode & LOG_ROUTE(i)) {
+            conf->format[i] = format;
+            layout_put(conf->layout[i]);
+            conf->layout[i] = NULL;
+        }
+    }
+
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_pattern(log_t *this, log_mode mode, const char *pattern)
+{
+    log_conf *conf;
+    layout *l;
+    int i;
+
+    if(this == NULL || (l = layout_compile(pattern)) == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        layout_put(l);
+        return LOG_FALSE;
+    }
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        if(mode & LOG_ROUTE(i)) {		//多个设备共享编译结果
+            conf->format[i] = LOG_FORMAT_PATTERN;
+            layout_put(conf->layout[i]);
+            layout_get(l);
+            conf->layout[i] = l;
+        }
+    }
+
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    layout_put(l);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_escape(log_t *this, log_mode mode, log_escape escape)
+{
+    log_conf *conf;
+    int i;
+
+    if(this == NULL || escape < LOG_ESCAPE_RAW || escape > LOG_ESCAPE_JSON) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        if(mode & LOG_ROUTE(i)) {
+            conf->escape[i] = escape;
+        }
+    }
+
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_recorder(log_t *this, int records, int dump_num)
+{
+    recorder *rec = NULL, *old;
+    log_conf *conf;
+
+    if(this == NULL || records < 0) {
+        return LOG_FALSE;
+    }
+
+    if(records > 0 && (rec = recorder_create(records, sizeof(struct queue_element_t))) == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(this->conf->shm != NULL || (conf = conf_copy(this)) == NULL) {	//多进程模式下没有调度线程输出
+        pthread_rwlock_unlock(&this->lock);
+        recorder_destroy(rec);
+        return LOG_FALSE;
+    }
+
+    old = conf->rec;
+    conf->rec = rec;
+    conf->rec_dump = dump_num > 0 ? dump_num : 0;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    rcu_retire(old, recorder_destroy);		//旧快照和正在写入的线程都不再使用之后释放
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_payload(log_t *this, int max_len, int blocks)
+{
+    pool *p = NULL, *old;
+    log_conf *conf;
+
+    if(this == NULL || max_len < 0 || (max_len > 0 && blocks <= 0)) {
+        return LOG_FALSE;
+    }
+
+    if(max_len > 0 && (p = pool_create(max_len < LOG_PAYLOAD_MAX ? max_len : LOG_PAYLOAD_MAX, blocks)) == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(this->conf->shm != NULL || (conf = conf_copy(this)) == NULL) {	//收集进程不能访问本进程的内存池
+        pthread_rwlock_unlock(&this->lock);
+        pool_release(p);
+        return LOG_FALSE;
+    }
+
+    old = conf->payload;
+    conf->payload = p;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    rcu_retire(old, pool_release);		//队列中还没有输出的块归还之后旧池才释放
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_lane(log_t *this, log_level level, int capacity, log_overflow policy)
+{
+    log_conf *conf;
+    int i, ret = 0;
+
+    if(this == NULL || level < FATAL || level > DEBUG || capacity < 0 || (capacity > 0 && capacity < 3)
+       || policy < LOG_OVERFLOW_DROP || policy > LOG_OVERFLOW_BLOCK) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(capacity > 0 && (this->init_flag == 0 || this->start_flag == 1 || this->conf->shm != NULL || this->lane_size[level] != 0)) {
+        pthread_rwlock_unlock(&this->lock);		//调度线程运行时不能增加队列
+        return LOG_FALSE;
+    }
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    if(capacity > 0) {
+        this->lane_size[level] = capacity;
+
+        for(i = 0; i < this->worker_num; i++) {		//之前已经放入默认队列的日志照常输出
+            ret |= worker_lanes(this, &this->workers[i]);
+        }
+    }
+
+    conf->overflow[level] = policy;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return ret == 0 ? LOG_TRUE : LOG_FALSE;
+}
+
+LOG_BOOL log_set_shed(log_t *this, int high, int low, log_mode mode)
+{
+    log_conf *conf;
+
+    if(this == NULL || high < 0 || high > 100 || (high > 0 && (low < 0 || low >= high))) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    conf->shed_high = high;
+    conf->shed_low = high > 0 ? low : 0;
+    conf->shed_mode = mode;
+    conf_publish(this, conf);
+
+    if(high == 0) {
+        this->shed = DEBUG;
+    }
+
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_reorder(log_t *this, LOG_BOOL enable)
+{
+    log_conf *conf;
+
+    if(this == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    conf->reorder = enable == LOG_TRUE;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_index(log_t *this, int records, int kbytes)
+{
+    log_conf *conf;
+
+    if(this == NULL || records < 0 || kbytes < 0) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    conf->index_records = records;
+    conf->index_bytes = kbytes * 1024;
+    conf_index(conf, conf->sinks[SINK_FILE]);
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_clock(log_t *this, log_clock clock, int digits)
+{
+    log_conf *conf;
+
+    if(this == NULL || digits < 0 || digits > 9) {
+        return LOG_FALSE;
+    }
+
+    if(stamp_init(clock) != 0) {		//在锁外校准，TSC第一次使用时需要阻塞STAMP_INIT_MS毫秒
+        fprintf(stderr, "clock %d is not available\n", clock);
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    conf->clock = clock;
+    conf->time_digits = digits;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_dump_recorder(log_t *this, log_mode mode)
+{
+    queue_element temp;
+    log_conf *conf;
+    LOG_BOOL ret = LOG_FALSE;
+
+    if(this == NULL) {
+        return LOG_FALSE;
+    }
+
+    rcu_read_lock();
+    conf = this->conf;
+
+    if(conf->rec != NULL && conf->shm == NULL) {	//由调度线程输出，不和正在输出的日志交错
+        log_fill(&temp, LOG_CLOCK_REALTIME, mode, LOG_LEVEL_DUMP, NULL, NULL);
+        temp.msg[0] = '\0';
+        log_push(this, conf, &temp);
+        ret = LOG_TRUE;
+    }
+
+    rcu_read_unlock();
+    return ret;
+}
+
+LOG_BOOL log_set_coalesce(log_t *this, int window_ms, int max_count)
+{
+    if(this == NULL || window_ms < 0) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+    this->coalesce_window = window_ms;
+    this->coalesce_max = max_count > 0 ? max_count : 0;
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_wakeup(log_t *this, int spin_us, LOG_BOOL busy_poll)
+{
+    if(this == NULL || spin_us < 0) {
+        return LOG_FALSE;
+    }
+
+    int i, j;
+    pthread_rwlock_wrlock(&this->lock);
+    queue_set_wait(this->data, spin_us, busy_poll == LOG_TRUE);
+
+    for(i = 0; i < this->worker_num; i++) {
+        for(j = 0; j < this->workers[i].lane_num; j++) {
+            queue_set_wait(this->workers[i].order[j], spin_us, busy_poll == LOG_TRUE);
+        }
+    }
+
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_affinity(log_t *this, const int *cpus, int num)
+{
+    int i;
+
+    if(this == NULL || (num > 0 && cpus == NULL)) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+    CPU_ZERO(&this->affinity);
+    this->affinity_num = 0;
+
+    for(i = 0; i < num; i++) {
+        if(cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &this->affinity);
+            ++this->affinity_num;
+        }
+    }
+
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_numa(log_t *this, LOG_BOOL enable)
+{
+    int nodes[TOPO_MAX_NODE], num, i, j;
+    log_worker *workers, *old;
+    log_conf *conf;
+    queue_array *q;
+
+    if(this == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(this->init_flag == 0 || this->start_flag == 1 || this->conf->shm != NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    num = topo_node_num(nodes);
+
+    if(enable != LOG_TRUE || num <= 1 || this->worker_num > 1) {	//只有一个节点时不需要分开
+        pthread_rwlock_unlock(&this->lock);
+        return enable == LOG_TRUE || this->worker_num == 1 ? LOG_TRUE : LOG_FALSE;
+    }
+
+    if((workers = calloc(num, sizeof(log_worker))) == NULL || (conf = conf_copy(this)) == NULL) {
+        free(workers);
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    memcpy(workers, this->workers, sizeof(log_worker));		//第一个节点继续使用log_init分配的队列，写日志的线程可能正在使用
+    workers[0].node = nodes[0];
+    worker_order(&workers[0]);		//通道通知新数组中的事件
+
+    for(i = 1; i < num; i++) {
+        workers[i].log = this;
+        workers[i].node = nodes[i];
+        workers[i].render_buffer = malloc(LOG_RENDER_LEN);
+        q = create_queue();
+
+        if(q != NULL) {
+            queue_set_node(q, nodes[i]);
+            queue_set_layout(q, LOG_QUEUE_CHUNK);
+            queue_set_wait(q, this->data->spin, this->data->busy_poll);
+        }
+
+        if(q == NULL || workers[i].render_buffer == NULL || q->init(q, LOG_BUFFER_NUM, sizeof(struct queue_element_t)) != 0) {
+            fprintf(stderr, "create queue for node %d failed\n", nodes[i]);
+            queue_destroy(q);
+            free(workers[i].render_buffer);
+            break;
+        }
+
+        workers[i].queue = q;
+
+        for(j = 0; j < LOG_LANE_NUM; j++) {
+            workers[i].lanes[j] = q;
+        }
+
+        worker_lanes(this, &workers[i]);
+    }
+
+    num = i;
+
+    for(i = 0; i < TOPO_MAX_NODE; i++) {
+        this->node_worker[i] = 0;
+    }
+
+    for(i = 0; i < num; i++) {
+        this->node_worker[workers[i].node % TOPO_MAX_NODE] = i;
+    }
+
+    old = this->workers;
+    this->workers = workers;
+    this->worker_num = num;
+    conf->workers = workers;
+    conf->worker_num = num;
+    conf_publish(this, conf);
+    rcu_retire(old, free);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+/**
+ * @brief	worker_start	创建调度线程，设置了cpu亲和性或者绑定了节点时只在对应的cpu上运行
+ *
+ * @return	成功返回0
+ */
+static int worker_start(log_t *this, log_worker *w, int detach)
+{
+    pthread_attr_t attr;
+    cpu_set_t set, node;
+    int ret;
+    pthread_attr_init(&attr);
+
+    if(detach) {
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    }
+
+    CPU_ZERO(&set);
+
+    if(w->node >= 0 && topo_node_cpus(w->node, &node) > 0) {
+        if(this->affinity_num > 0) {
+            CPU_AND(&set, &this->affinity, &node);
+        }
+
+        if(CPU_COUNT(&set) == 0) {		//指定的cpu都不在本节点时使用节点的所有cpu
+            CPU_OR(&set, &set, &node);
+        }
+    } else if(this->affinity_num > 0) {
+        CPU_OR(&set, &set, &this->affinity);
+    }
+
+    if(CPU_COUNT(&set) > 0) {
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &set);
+    }
+
+    w->running = 1;
+    w->stop = 0;
+    ret = pthread_create(&w->id, &attr, entry, (void *)w);
+    pthread_attr_destroy(&attr);
+
+    if(ret != 0) {
+        w->id = 0;
+        w->running = 0;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief	worker_wake	设置退出标志并唤醒在worker_wait中休眠的调度线程
+ */
+static void worker_wake(log_worker *w)
+{
+    w->stop = 1;
+
+    if(w->lane_num == 1) {
+        queue_wakeup(w->queue);
+    } else {
+        queue_event_notify(&w->ready);
+    }
+}
+
+static void log_kill(log_t *this)
+{
+    int i;
+
+    for(i = 0; i < this->worker_num; i++) {
+        if(this->workers[i].id != 0) {
+            worker_wake(&this->workers[i]);
+            this->workers[i].id = 0;
+        }
+    }
+
+    for(i = 0; i < this->worker_num; i++) {		//调度线程在写完当前批之后才检查退出标志
+        while(this->workers[i].running) {
+            sched_yield();
+        }
+    }
+
+    if(this->poll_fd >= 0) {		//退出内联调度，事件循环之后调用log_poll返回EINVAL
+        this->polled.fd = 0;
+        close(this->poll_fd);
+        this->poll_fd = -1;
+
+        for(i = 0; i < this->worker_num; i++) {
+            worker_order(&this->workers[i]);
+        }
+    }
+
+    this->start_flag = 0;
+}
+
+/**
+ * @brief	log_inline	进入内联调度模式:创建eventfd，所有队列入队时通知polled，需要持有写锁
+ *
+ * @return	成功返回0
+ */
+static int log_inline(log_t *this)
+{
+    uint64_t one = 1;
+    int i, j, fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if(fd < 0) {
+        perror("create eventfd failed");
+        return -1;
+    }
+
+    this->poll_fd = fd;
+    this->polled.fd = fd + 1;
+
+    for(i = 0; i < this->worker_num; i++) {
+        for(j = 0; j < this->workers[i].lane_num; j++) {
+            queue_set_notify(this->workers[i].order[j], &this->polled);
+        }
+    }
+
+    this->start_flag = 1;		//之后不能再增加队列
+    while(write(fd, &one, sizeof(one)) < 0 && errno == EINTR);		//处理之前已经入队的日志
+    return 0;
+}
+
+//static LOG_BOOL log_dispatch( log_t *this, dispatch_type type, callback_do_type dotype, void ( *wrap )( log * ) );
+LOG_BOOL log_dispatch(log_t *this, dispatch_type type)
+{
+    if(this  ==  NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(this->backend != NULL) {		//attach之后由共享调度线程输出
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_TRUE;
+    }
+
+    if(this->init_flag == 0 || this->start_flag == 1) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    if(this->conf->shm != NULL) {		//共享内存模式由收集进程输出，不需要调度线程
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_TRUE;
+    }
+
+    int i;
+
+    switch(type) {
+        case DISPATCH_UNBLOCK:
+        case DISPATCH_BLOCK:
+
+            for(i = 0; i < this->worker_num; i++) {
+                if(worker_start(this, &this->workers[i], type == DISPATCH_UNBLOCK) != 0) {
+                    log_kill(this);
+                    pthread_rwlock_unlock(&this->lock);
+                    return LOG_FALSE;
+                }
+            }
+
+            this->start_flag = 1;		//调度线程运行时不能再替换队列和调度线程的数组
+
+            if(type == DISPATCH_UNBLOCK) {
+                break;
+            }
+
+            for(i = 0; i < this->worker_num; i++) {
+                if(pthread_join(this->workers[i].id, NULL) != 0) {
+                    perror("block failed");
+                }
+            }
+
+            this->start_flag = 0;
+            break;
+        case DISPATCH_INLINE:
+
+            if(log_inline(this) != 0) {
+                pthread_rwlock_unlock(&this->lock);
+                return LOG_FALSE;
+            }
+
+            break;
+        default:
+            break;
+    }
+
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+
+/**
+ * @brief	batch_begin	开始处理一批日志，这批日志使用同一个配置快照
+ */
+static inline void batch_begin(log_worker *w)
+{
+    rcu_read_lock();
+    w->conf = w->log->conf;
+    w->blocked = 0;
+}
+
+/**
+ * @brief	batch_flush	把攒的日志写入设备
+ */
+static void batch_flush(log_worker *w, int id)
+{
+    sink_batch *b = &w->batch[id];
+
+    if(b->num > 0) {
+        if(sink_write(w->conf->sinks[id], b->lines, b->num) < 0 && errno == EAGAIN) {
+            w->blocked = 1;
+        }
+
+        b->num = 0;
+        b->used = 0;
+    }
+}
+
+/**
+ * @brief	batch_add	把render_buffer中渲染好的日志加入设备的批，批满时写入设备
+ */
+static void batch_add(log_worker *w, int id, queue_element *job, int len)
+{
+    sink_batch *b = &w->batch[id];
+    log_line line;
+
+    if(b->buf == NULL && (b->buf = malloc(LOG_SINK_BUF_LEN)) == NULL) {	//没有内存时直接写
+        line.data = w->render_buffer;
+        line.len = len;
+        line.level = job->level;
+        line.time_us = job->time / 1000;
+        sink_write(w->conf->sinks[id], &line, 1);
+        return;
+    }
+
+    if(b->num == LOG_SINK_BATCH || b->used + len > LOG_SINK_BUF_LEN) {
+        batch_flush(w, id);
+    }
+
+    memcpy(b->buf + b->used, w->render_buffer, len);
+    b->lines[b->num].data = b->buf + b->used;
+    b->lines[b->num].len = len;
+    b->lines[b->num].level = job->level;
+    b->lines[b->num].time_us = job->time / 1000;
+    b->used += len;
+    ++b->num;
+    w->dirty |= 1U << id;
+}
+
+/**
+ * @brief	batch_end	写出所有设备的批并调用flush，结束读区间之后快照和设备才可能被释放
+ */
+static void batch_end(log_worker *w)
+{
+    int i;
+
+    for(i = 0; i < LOG_SINK_MAX; i++) {
+        if(w->dirty & (1U << i)) {
+            batch_flush(w, i);
+        }
+
+        if(sink_flush(w->conf->sinks[i]) < 0 && errno == EAGAIN) {		//没有新日志时也让设备重试缓存的数据
+            w->blocked = 1;
+        }
+    }
+
+    w->dirty = 0;
+    w->conf = NULL;
+    rcu_read_unlock();
+}
+
+/**
+ * @brief	worker_empty	调度线程的所有队列都为空
+ */
+static int worker_empty(log_worker *w)
+{
+    int i;
+
+    for(i = 0; i < w->lane_num; i++) {
+        if(!w->order[i]->is_empty(w->order[i])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief	worker_wait	等待任意一个队列中有数据，只有一个队列时使用队列自己的自旋和休眠
+ *
+ * @return	有数据返回1
+ */
+static int worker_wait(log_worker *w, int ms)
+{
+    int key;
+
+    if(w->lane_num == 1) {
+        return w->queue->wait(w->queue, ms);
+    }
+
+    key = queue_event_prepare(&w->ready);
+
+    if(!worker_empty(w) || w->stop) {
+        return 1;
+    }
+
+    queue_event_wait(&w->ready, key, ms);
+    return !worker_empty(w);
+}
+
+/**
+ * @brief	worker_peek	按优先级取得一条日志，每次都从最高级别的队列开始检查
+ *
+ * @param	w			调度线程
+ * @param	q			日志所在的队列
+ *
+ * @return	所有队列都为空时返回NULL
+ */
+static inline queue_element *worker_peek(log_worker *w, queue_array **q)
+{
+    queue_element *job;
+    int i, len;
+
+    for(i = 0; i < w->lane_num; i++) {
+        if((job = w->order[i]->peek(w->order[i], &len, 0)) != NULL) {
+            *q = w->order[i];
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+typedef struct sort_key_s {
+    int64_t time;
+    int index;					//取出的顺序，时间相同时保持原来的顺序
+} sort_key;
+
+static int sort_key_cmp(const void *a, const void *b)
+{
+    const sort_key *x = a, *y = b;
+
+    if(x->time != y->time) {
+        return x->time < y->time ? -1 : 1;
+    }
+
+    return x->index - y->index;
+}
+
+/**
+ * @brief	worker_reorder	每次取出最多LOG_DRAIN_MAX条复制到sorted，按时间戳排序后处理
+ *
+ * @return	处理的条数
+ */
+static int worker_reorder(log_worker *w, int max)
+{
+    sort_key keys[LOG_DRAIN_MAX];
+    queue_element *job;
+    queue_array *q;
+    int i, n, count = 0;
+
+    while(count < max) {
+        for(n = 0; n < LOG_DRAIN_MAX && count + n < max && (job = worker_peek(w, &q)) != NULL; n++) {
+            memcpy(&w->sorted[n], job, log_len(job));		//长消息的块随复制转移
+            q->release(q, job);
+            log_stamp(&w->sorted[n]);
+            keys[n].time = w->sorted[n].time;
+            keys[n].index = n;
+        }
+
+        if(n == 0) {
+            break;
+        }
+
+        qsort(keys, n, sizeof(sort_key), sort_key_cmp);
+
+        for(i = 0; i < n; i++) {
+            log_coalesce(w, &w->sorted[keys[i].index]);
+            log_free(&w->sorted[keys[i].index]);
+        }
+
+        count += n;
+    }
+
+    return count;
+}
+
+/**
+ * @brief	queue_fill	队列积压的百分比
+ */
+static inline int queue_fill(queue_array *q)
+{
+    int size = q->get_size(q);
+    return size > 0 ? q->get_current_len(q) * 100 / size : 0;
+}
+
+/**
+ * @brief	worker_drain	按优先级处理最多max条日志，需要在batch_begin和batch_end之间调用
+ *
+ * @return	处理的条数
+ */
+static int worker_drain(log_worker *w, int max)
+{
+    queue_element *job;
+    queue_array *q;
+    int count, fill;
+
+    w->fill = queue_fill(w->lanes[INFO]);		//处理之前取样，一批就能取空的小队列在处理之后总是空的
+
+    if(w->lanes[DEBUG] != w->lanes[INFO] && (fill = queue_fill(w->lanes[DEBUG])) > w->fill) {
+        w->fill = fill;
+    }
+
+    if(w->conf->reorder && (w->sorted != NULL || (w->sorted = malloc(LOG_DRAIN_MAX * sizeof(queue_element))) != NULL)) {
+        return worker_reorder(w, max);
+    }
+
+    for(count = 0; count < max && (job = worker_peek(w, &q)) != NULL; count++) {	//在槽位中处理不复制，每个设备按批写入
+        log_coalesce(w, job);
+        log_free(job);
+        q->release(q, job);
+    }
+
+    return count;
+}
+
+static void *entry(void *p)
+{
+    if(p  ==  NULL) {
+        return NULL;
+    }
+
+    log_worker *w = (log_worker *)p;
+
+    if(w->render_buffer  == NULL) {
+        fprintf(stderr, "malloc render_buffer failed\n");
+    }
+
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);		//信号由应用的线程处理
+
+    while(1) {		//对回调函数进行封装，屏蔽所有线程池调用细节
+        worker_wait(w, coalesce_wait(w, now_ns()));
+
+        if(w->stop) {		//只在等待之后退出，不会丢掉攒了一半的批，也不会带着没有释放的槽位退出
+            break;
+        }
+
+        batch_begin(w);
+        worker_drain(w, LOG_DRAIN_MAX);		//一次唤醒处理积压的日志
+        worker_tick(w, now_ns());
+        batch_end(w);
+    }
+
+    w->running = 0;
+    return NULL;
+}
+
+int log_poll_fd(log_t *this)
+{
+    return this != NULL ? this->poll_fd : -1;
+}
+
+int log_poll(log_t *this, int budget)
+{
+    uint64_t v;
+    int i, count = 0, blocked = 0;
+
+    if(this == NULL || this->poll_fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if(budget <= 0) {
+        budget = LOG_DRAIN_MAX;
+    }
+
+    ++this->polls;
+    while(read(this->poll_fd, &v, sizeof(v)) < 0 && errno == EINTR);		//先清除可读状态，之后的入队会重新通知
+
+    for(i = 0; i < this->worker_num; i++) {		//开启NUMA时依次处理每个节点的队列，额度用完后只做定时工作
+        batch_begin(&this->workers[i]);
+        count += worker_drain(&this->workers[i], budget - count);
+        worker_tick(&this->workers[i], now_ns());
+        batch_end(&this->workers[i]);
+        blocked |= this->workers[i].blocked;
+    }
+
+    queue_event_prepare(&this->polled);		//之后入队的日志写eventfd
+
+    for(i = 0; i < this->worker_num; i++) {
+        if(!worker_empty(&this->workers[i])) {		//额度用完或者prepare之前入队的日志，保持可读
+            v = 1;
+            while(write(this->poll_fd, &v, sizeof(v)) < 0 && errno == EINTR);
+            break;
+        }
+    }
+
+    if(blocked) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    return count;
+}
+
+/**
+ * @brief	log_shed	按照INFO和DEBUG所在队列的积压调整削减级别，需要在batch_begin和batch_end之间调用
+ *
+ * 超过高水位时多削减一个级别(先DEBUG后INFO，ERROR和FATAL不削减)，低于低水位并且保持了LOG_SHED_HOLD毫秒时恢复一个级别，
+ * 每次改变都直接输出一条日志(不经过队列，不会被削减)
+ */
+static void log_shed(log_worker *w, int64_t now)
+{
+    log_t *this = w->log;
+    log_conf *conf = w->conf;
+    log_level old = this->shed, new;
+    queue_element job;
+    fmt_buf b;
+    int i, fill = 0;
+
+    if(conf->shed_high <= 0) {
+        return;
+    }
+
+    for(i = 0; i < conf->worker_num; i++) {		//开启NUMA时取所有节点中最大的积压
+        if(conf->workers[i].fill > fill) {
+            fill = conf->workers[i].fill;
+        }
+    }
+
+    if(fill >= conf->shed_high && old > ERROR) {
+        new = old - 1;
+    } else if(fill <= conf->shed_low && old < DEBUG && now - this->shed_time >= LOG_SHED_HOLD * 1000000LL) {
+        new = old + 1;
+    } else {
+        return;
+    }
+
+    if(!__sync_bool_compare_and_swap(&this->shed, old, new)) {		//其他节点的调度线程已经改变
+        return;
+    }
+
+    this->shed_time = now;
+    __sync_fetch_and_add(&this->shed_changes, 1);
+    log_fill(&job, LOG_CLOCK_REALTIME, conf->shed_mode, new < old ? ERROR : INFO, NULL, NULL);
+    fmt_init(&b, job.msg, LOG_LEN);
+    fmt_format(&b, "load shedding: queue %d%% full, %s %s", fill, new < old ? "dropping" : "restored", level2str(new < old ? old : new));
+    fmt_end(&b);
+    log_recored(w, &job);
+}
+
+/**
+ * @brief	worker_tick	处理一批日志之后的定时工作:结束合并的时间窗口，校准时钟，调整负载削减，报告调用点的丢弃统计，回收旧配置
+ */
+static void worker_tick(log_worker *w, int64_t now)
+{
+    coalesce_expire(w, now);
+    stamp_calibrate(now);
+    log_shed(w, now);
+
+    if(w == w->log->workers && now - w->sweep_time >= LOG_SUPPRESS_INTERVAL * 1000000000LL) {	//只由第一个调度线程报告
+        w->sweep_time = now;
+        log_sweep(w, now);
+        rcu_reclaim();
+    }
+}
+
+/**
+ * @brief	backend_serve	共享调度线程处理一个队列，最多处理quantum条
+ *
+ * @return	处理的条数
+ */
+static int backend_serve(log_worker *w, int quantum)
+{
+    int count;
+    batch_begin(w);
+    count = worker_drain(w, quantum);
+    worker_tick(w, now_ns());
+    batch_end(w);
+    return count;
+}
+
+/**
+ * @brief	backend_idle	所有队列都为空时，休眠的最长毫秒数(合并窗口的剩余时间或者报告间隔)
+ *
+ * @return	有队列不为空时返回0
+ */
+static int backend_idle(backend_set *set, int64_t now)
+{
+    int i, wait, ms = LOG_SUPPRESS_INTERVAL * 1000;
+    log_worker *w;
+
+    for(i = 0; i < set->num; i++) {
+        w = set->workers[i];
+
+        if(!worker_empty(w)) {
+            return 0;
+        }
+
+        if((wait = coalesce_wait(w, now)) < ms) {	//其他线程正在处理时读到的值不准确，只影响休眠时间
+            ms = wait;
+        }
+    }
+
+    return ms;
+}
+
+static void *backend_entry(void *p)
+{
+    log_backend_t *backend = p;
+    backend_set *set;
+    log_worker *w;
+    sigset_t sigmask;
+    int i, key, ms, count;
+    sigfillset(&sigmask);
+    pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
+
+    while(!backend->stop) {
+        count = 0;
+        rcu_read_lock();		//log_detach等待读区间结束，之后不会再处理被移除的队列
+        set = backend->set;
+
+        for(i = 0; i < set->num; i++) {		//加权轮询，每个线程从不同的位置开始
+            w = set->workers[__sync_fetch_and_add(&backend->cursor, 1) % set->num];
+
+            if(w->busy || !__sync_bool_compare_and_swap(&w->busy, 0, 1)) {
+                continue;
+            }
+
+            count += backend_serve(w, w->weight * LOG_BACKEND_QUANTUM);
+            __sync_lock_release(&w->busy);
+        }
+
+        if(count > 0) {
+            __sync_fetch_and_add(&backend->served, count);
+            rcu_read_unlock();
+            continue;
+        }
+
+        key = queue_event_prepare(&backend->ready);
+        ms = backend->stop ? 0 : backend_idle(set, now_ns());
+        rcu_read_unlock();
+
+        if(ms > 0) {
+            __sync_fetch_and_add(&backend->parks, 1);
+            queue_event_wait(&backend->ready, key, ms);
+        }
+    }
+
+    return NULL;
+}
+
+log_backend_t *log_backend_create(int threads)
+{
+    log_backend_t *backend;
+    int i;
+
+    if(threads <= 0 || (backend = calloc(1, sizeof(log_backend_t))) == NULL) {
+        return NULL;
+    }
+
+    backend->set = calloc(1, sizeof(backend_set));
+    backend->threads = calloc(threads, sizeof(pthread_t));
+
+    if(backend->set == NULL || backend->threads == NULL) {
+        free(backend->set);
+        free(backend->threads);
+        free(backend);
+        return NULL;
+    }
+
+    pthread_mutex_init(&backend->lock, NULL);
+
+    for(i = 0; i < threads; i++) {
+        if(pthread_create(&backend->threads[i], NULL, backend_entry, backend) != 0) {
+            break;
+        }
+    }
+
+    backend->thread_num = i;
+
+    if(i == 0) {
+        log_backend_destroy(backend);
+        return NULL;
+    }
+
+    return backend;
+}
+
+void log_backend_destroy(log_backend_t *backend)
+{
+    int i;
+
+    if(backend == NULL) {
+        return;
+    }
+
+    backend->stop = 1;
+    queue_event_notify(&backend->ready);	//线程在prepare之后检查stop，一次通知可以唤醒所有线程
+
+    for(i = 0; i < backend->thread_num; i++) {
+        pthread_join(backend->threads[i], NULL);
+    }
+
+    pthread_mutex_lock(&backend->lock);
+
+    for(i = 0; i < backend->set->num; i++) {	//仍然挂在上面的日志对象不再由共享调度线程服务
+        backend->set->workers[i]->log->backend = NULL;
+        worker_order(backend->set->workers[i]);
+    }
+
+    pthread_mutex_unlock(&backend->lock);
+    pthread_mutex_destroy(&backend->lock);
+    free(backend->set);
+    free(backend->threads);
+    free(backend);
+}
+
+/**
+ * @brief	backend_publish	替换共享调度线程的队列集合，等待正在使用旧集合的线程结束后释放
+ */
+static void backend_publish(log_backend_t *backend, backend_set *set)
+{
+    backend_set *old = backend->set;
+    __sync_synchronize();
+    backend->set = set;
+    rcu_synchronize();
+    free(old);
+}
+
+LOG_BOOL log_attach(log_t *this, log_backend_t *backend, int weight)
+{
+    backend_set *set;
+    int i, j;
+
+    if(this == NULL || backend == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(this->init_flag == 0 || this->start_flag == 1 || this->backend != NULL || this->conf->shm != NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    pthread_mutex_lock(&backend->lock);
+    set = malloc(sizeof(backend_set) + (backend->set->num + this->worker_num) * sizeof(log_worker *));
+
+    if(set == NULL) {
+        pthread_mutex_unlock(&backend->lock);
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    memcpy(set->workers, backend->set->workers, backend->set->num * sizeof(log_worker *));
+    set->num = backend->set->num;
+
+    for(i = 0; i < this->worker_num; i++) {
+        this->workers[i].weight = weight > 0 ? weight : 1;
+        this->workers[i].busy = 0;
+
+        for(j = 0; j < this->workers[i].lane_num; j++) {
+            queue_set_notify(this->workers[i].order[j], &backend->ready);
+        }
+
+        set->workers[set->num++] = &this->workers[i];
+    }
+
+    backend_publish(backend, set);
+    pthread_mutex_unlock(&backend->lock);
+    this->backend = backend;
+    this->start_flag = 1;
+    pthread_rwlock_unlock(&this->lock);
+    queue_event_notify(&backend->ready);	//处理attach之前已经入队的日志
+    return LOG_TRUE;
+}
+
+/**
+ * @brief	log_detach	从共享调度线程中移除，返回后没有线程再处理本对象的队列，需要持有写锁
+ */
+static void log_detach(log_t *this)
+{
+    log_backend_t *backend = this->backend;
+    backend_set *set;
+    int i, j;
+
+    if(backend == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&backend->lock);
+
+    if((set = malloc(sizeof(backend_set) + backend->set->num * sizeof(log_worker *))) != NULL) {
+        for(i = 0, set->num = 0; i < backend->set->num; i++) {
+            for(j = 0; j < this->worker_num && backend->set->workers[i] != &this->workers[j]; j++);
+
+            if(j == this->worker_num) {
+                set->workers[set->num++] = backend->set->workers[i];
+            }
+        }
+
+        backend_publish(backend, set);
+    } else {
+        fprintf(stderr, "log detach failed\n");
+    }
+
+    pthread_mutex_unlock(&backend->lock);
+
+    for(i = 0; i < this->worker_num; i++) {
+        worker_order(&this->workers[i]);
+    }
+
+    this->backend = NULL;
+}
+
+LOG_BOOL log_set_file(log_t *this, char *log_file, char *debug_file)
+{
+    sink_ref *file, *debug = NULL, *route;
+    log_conf *conf;
+
+    if(this == NULL || log_file == NULL) {
+        return LOG_FALSE;
+    }
+
+    if((file = sink_file_open(log_file)) == NULL) {
+        return LOG_FALSE;
+    }
+
+    if(debug_file != NULL && (debug = sink_file_open(debug_file)) == NULL) {
+        sink_put(file);
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(debug == NULL && this->conf->sinks[SINK_FILE] != NULL) {	//没有指定调试文件时保持原来的
+        debug = this->conf->sinks[SINK_FILE]->sub[1];
+        sink_get(debug);
+    }
+
+    if((route = sink_file_route(file, debug)) == NULL || (conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        sink_put(route);
+        return LOG_FALSE;
+    }
+
+    sink_put(conf->sinks[SINK_FILE]);
+    conf->sinks[SINK_FILE] = route;
+    conf_index(conf, route);
+    conf_publish(this, conf);		//调度线程可能正在写旧文件，旧文件在快照释放时关闭
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+
+LOG_BOOL log_set_socket(log_t *this, char *ip, char *port, sock_type type)
+{
+    if(this == NULL	|| ip  ==  NULL || port  == NULL) {
+        return LOG_FALSE;
+    }
+
+    if(type != UDP  &&  type != TCP) {
+        return LOG_FALSE;
+    }
+
+    int client_sock;
+    sink_ref *sock;
+    log_conf *conf;
+
+    if((client_sock = sock_connect(ip, port, type)) < 0) {
+        return LOG_FALSE;
+    }
+
+    if((sock = sink_socket(client_sock)) == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        sink_put(sock);
+        return LOG_FALSE;
+    }
+
+    sink_put(conf->sinks[SINK_SOCKET]);
+    conf->sinks[SINK_SOCKET] = sock;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_unix(log_t *this, const char *path, unix_type type)
+{
+    sink_ref *sock;
+    log_conf *conf;
+
+    if(this == NULL || path == NULL || (type != UNIX_STREAM && type != UNIX_SEQPACKET)) {
+        return LOG_FALSE;
+    }
+
+    if((sock = sink_unix(path, type)) == NULL) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        sink_put(sock);
+        return LOG_FALSE;
+    }
+
+    sink_put(conf->sinks[SINK_SOCKET]);
+    conf->sinks[SINK_SOCKET] = sock;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+/**
+ * @brief	sock_connect	连接日志服务器，连接超时3秒
+ *
+ * @return	成功返回socket，失败返回-1
+ */
+static int sock_connect(const char *ip, const char *port, sock_type type)
+{
+    int flags, client_sock = -1;
+    struct addrinfo *result, hints, *rp = NULL;
+    /* result = get_addrinfo( ip, port, IP_ANY, type, IP_PROTOCOL ); */
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+    hints.ai_protocol = IPPROTO_IP;
+    hints.ai_flags = AI_NUMERICHOST;
+    //hints.ai_flags = 0;
+
+    if((flags = getaddrinfo(ip, port, (const struct addrinfo *)&hints, &result)) != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(flags));
+        return -1;
+    }
+
+    for(rp = result; rp != NULL; rp = rp->ai_next) {
+        client_sock =
+            socket(rp->ai_family, rp->ai_socktype,
+                   rp->ai_protocol);
+
+        if(client_sock == -1) {
+            continue;
+        }
+
+        flags = fcntl(client_sock, F_GETFL, 0);	//if get failed, socket just be block,so no need to do the error
+        fcntl(client_sock, F_SETFL, flags | O_NONBLOCK);
+
+        if(connect(client_sock, rp->ai_addr, rp->ai_addrlen) != -1) {
+            fcntl(client_sock, F_SETFL, flags);
+            break;
+        } else {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(client_sock, &set);
+            struct timeval tv;
+            tv.tv_usec = 0;
+            tv.tv_sec = 3;
+            int error = 0, len = 0;
+
+            if(select(client_sock + 1, NULL, &set, NULL, &tv) > 0) {
+                getsockopt(client_sock, SOL_SOCKET, SO_ERROR,
+                           &error, (socklen_t *) & len);
+
+                if(error != 0) {
+                    close(client_sock);
+                } else {
+                    fcntl(client_sock, F_SETFL, flags);
+                    break;
+                }
+            } else {	//timeout or select failed      means connect failed
+                close(client_sock);
+            }
+        }
+    }
+
+    freeaddrinfo(result);
+    return rp != NULL ? client_sock : -1;
+}
+
+LOG_BOOL log_set_level(log_t *this, log_level level)
+{
+    log_conf *conf;
+
+    if(this == NULL || level < FATAL || level > DEBUG) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
+
+    conf->level = level;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_reload(log_t *this, const char *path)
+{
+    log_config config;
+    sink_ref *file = NULL, *debug = NULL, *sock = NULL, *route = NULL;
+    layout *layouts[SINK_NUM] = {NULL};
+    log_conf *conf;
+    int i, fd;
+
+    if(this == NULL || this->init_flag == 0 || config_parse(path, &config) != 0) {
+        return LOG_FALSE;
+    }
+
+    if(config.clock >= 0 && stamp_init(config.clock) != 0) {
+        fprintf(stderr, "reload %s: clock %s is not available\n", path, log_clock_str[config.clock]);
+        return LOG_FALSE;
+    }
+
+    //在锁外打开所有设备，任何一个失败都保持原来的配置
+    if(config.file_set && config.file[0] != '\0' && (file = sink_file_open(config.file)) == NULL) {
+        fprintf(stderr, "reload %s: open %s failed\n", path, config.file);
+        goto fail;
+    }
+
+    if(config.debug_set && config.debug_file[0] != '\0' && (debug = sink_file_open(config.debug_file)) == NULL) {
+        fprintf(stderr, "reload %s: open %s failed\n", path, config.debug_file);
+        goto fail;
+    }
+
+    if(config.sock_set && config.sock_unix != 0) {
+        if((sock = sink_unix(config.sock_path, config.sock_unix)) == NULL) {
+            fprintf(stderr, "reload %s: connect %s failed\n", path, config.sock_path);
+            goto fail;
+        }
+    } else if(config.sock_set && config.sock_host[0] != '\0') {
+        if((fd = sock_connect(config.sock_host, config.sock_port, config.sock_type)) < 0) {
+            fprintf(stderr, "reload %s: connect %s:%s failed\n", path, config.sock_host, config.sock_port);
+            goto fail;
+        }
+
+        if((sock = sink_socket(fd)) == NULL) {
+            goto fail;
+        }
+    }
+
+    for(i = 0; i < SINK_NUM; i++) {
+        if(config.format[i] == LOG_FORMAT_PATTERN && (layouts[i] = layout_compile(config.pattern[i])) == NULL) {
+            fprintf(stderr, "reload %s: bad pattern %s\n", path, config.pattern[i]);
+            goto fail;
+        }
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        goto fail;
+    }
+
+    if(config.shed_high >= 0 || config.shed_low >= 0) {		//和原来的配置合并后检查水位
+        if(config.shed_high >= 0) {
+            conf->shed_high = config.shed_high;
+        }
+
+        if(config.shed_low >= 0) {
+            conf->shed_low = config.shed_low;
+        }
+
+        if(conf->shed_high > 0 && conf->shed_low >= conf->shed_high) {
+            pthread_rwlock_unlock(&this->lock);
+            fprintf(stderr, "reload %s: shed_low %d must be less than shed_high %d\n", path, conf->shed_low, conf->shed_high);
+            conf_free(conf);
+            goto fail;
+        }
+    }
+
+    if(config.file_set || config.debug_set) {	//没有配置的文件保持原来的
+        if(!config.file_set && (file = conf->sinks[SINK_FILE]->sub[0]) != NULL) {
+            sink_get(file);
+        }
+
+        if(!config.debug_set && (debug = conf->sinks[SINK_FILE]->sub[1]) != NULL) {
+            sink_get(debug);
+        }
+
+        route = sink_file_route(file, debug);
+        file = NULL;
+        debug = NULL;
+
+        if(route == NULL) {
+            pthread_rwlock_unlock(&this->lock);
+            conf_free(conf);
+            goto fail;
+        }
+
+        sink_put(conf->sinks[SINK_FILE]);
+        conf->sinks[SINK_FILE] = route;
+    }
+
+    if(config.index_records >= 0 || config.index_kb >= 0) {
+        conf->index_records = config.index_records >= 0 ? config.index_records : 0;
+        conf->index_bytes = config.index_kb >= 0 ? config.index_kb * 1024 : 0;
+    }
+
+    if(config.file_set || config.debug_set || config.index_records >= 0 || config.index_kb >= 0) {
+        conf_index(conf, conf->sinks[SINK_FILE]);
+    }
+
+    if(config.sock_set) {
+        sink_put(conf->sinks[SINK_SOCKET]);
+        conf->sinks[SINK_SOCKET] = sock;
+    }
+
+    if(config.level >= 0) {
+        conf->level = config.level;
+    }
+
+    if(config.enable >= 0) {
+        conf->log_flag = config.enable;
+    }
+
+    if(config.clock >= 0) {
+        conf->clock = config.clock;
+    }
+
+    if(config.time_digits >= 0) {
+        conf->time_digits = config.time_digits;
+    }
+
+    for(i = 0; i < SINK_NUM; i++) {
+        if(config.format[i] >= 0) {
+            conf->format[i] = config.format[i];
+            layout_put(conf->layout[i]);
+            conf->layout[i] = layouts[i];
+            layouts[i] = NULL;
+        }
+
+        if(config.escape[i] >= 0) {
+            conf->escape[i] = config.escape[i];
+        }
+    }
+
+    if(conf->shed_high == 0) {
+        this->shed = DEBUG;
+    }
+
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+fail:
+    sink_put(file);
+    sink_put(debug);
+    sink_put(sock);
+
+    for(i = 0; i < SINK_NUM; i++) {
+        layout_put(layouts[i]);
+    }
+
+    return LOG_FALSE;
+}
+
+static volatile int watch_fds[LOG_WATCH_MAX];		//监视线程管道的写端加1，0表示空闲
+static volatile int watch_handlers;		//正在执行的信号处理函数个数，不为0时可能有处理函数还持有清掉的写端
+
+static void watch_signal(int signo)
+{
+    int i, fd, saved = errno;
+
+    __sync_fetch_and_add(&watch_handlers, 1);		//先计数再读取写端
+
+    for(i = 0; i < LOG_WATCH_MAX; i++) {
+        if((fd = watch_fds[i]) > 0) {
+            if(write(fd - 1, "r", 1) < 0) {		//管道满时已经有未处理的通知
+                continue;
+            }
+        }
+    }
+
+    __sync_fetch_and_sub(&watch_handlers, 1);
+    errno = saved;
+}
+
+/**
+ * @brief	watch_drain	读完管道和inotify中的通知
+ *
+ * @return	收到退出通知返回-1，需要重新加载返回1，否则返回0
+ */
+static int watch_drain(log_watcher *w, int fd, const char *name)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *ev;
+    int i, n, ret = 0;
+
+    while((n = read(w->pipe[0], buf, sizeof(buf))) > 0) {
+        for(i = 0; i < n; i++) {
+            if(buf[i] == 'q') {
+                return -1;
+            }
+
+            ret = 1;
+        }
+    }
+
+    if(w->quit) {
+        return -1;
+    }
+
+    while(fd >= 0 && (n = read(fd, buf, sizeof(buf))) > 0) {
+        for(i = 0; i < n; i += sizeof(struct inotify_event) + ev->len) {
+            ev = (struct inotify_event *)(buf + i);
+
+            if(ev->len > 0 && strcmp(ev->name, name) == 0) {
+                ret = 1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+static void *watch_entry(void *p)
+{
+    log_watcher *w = p;
+    char dir[PATH_MAX], name[PATH_MAX], *base;
+    struct pollfd fds[2];
+    sigset_t sigmask;
+    int fd, ret;
+    sigfillset(&sigmask);
+    pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
+    snprintf(dir, sizeof(dir), "%s", w->path);
+    snprintf(name, sizeof(name), "%s", w->path);
+    base = basename(name);
+
+    //编辑器一般写临时文件再改名，所以监视所在的目录
+    if((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0
+       && inotify_add_watch(fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "watch %s failed\n", w->path);
+        close(fd);
+        fd = -1;
+    }
+
+    fds[0].fd = w->pipe[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = fd;
+    fds[1].events = POLLIN;
+
+    while(1) {
+        if(poll(fds, fd >= 0 ? 2 : 1, -1) < 0 && errno != EINTR) {
+            break;
+        }
+
+        if((ret = watch_drain(w, fd, base)) < 0) {
+            break;
+        }
+
+        if(ret == 0) {
+            continue;
+        }
+
+        poll(NULL, 0, LOG_WATCH_DELAY);		//合并连续的修改
+
+        if(watch_drain(w, fd, base) < 0) {
+            break;
+        }
+
+        log_reload(w->log, w->path);
+    }
+
+    if(fd >= 0) {
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief	watch_create	创建管道并启动监视线程
+ *
+ * @return	失败返回NULL
+ */
+static log_watcher *watch_create(log_t *this, const char *path)
+{
+    log_watcher *w;
+
+    if((w = calloc(1, sizeof(log_watcher) + strlen(path) + 1)) == NULL) {
+        return NULL;
+    }
+
+    w->log = this;
+    w->slot = -1;
+    strcpy(w->path, path);
+
+    if(pipe2(w->pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        free(w);
+        return NULL;
+    }
+
+    if(pthread_create(&w->id, NULL, watch_entry, w) != 0) {
+        close(w->pipe[0]);
+        close(w->pipe[1]);
+        free(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+/**
+ * @brief	watch_free	注销信号，停止并等待监视线程退出，之后关闭管道。不能持有写锁，监视线程可能正在等待
+ */
+static void watch_free(log_watcher *w)
+{
+    if(w == NULL) {
+        return;
+    }
+
+    if(w->slot >= 0) {
+        watch_fds[w->slot] = 0;
+        __sync_synchronize();
+
+        while(watch_handlers > 0) {		//之后开始的处理函数看不到写端，等待已经读到写端的处理函数返回再关闭
+            sched_yield();
+        }
+    }
+
+    w->quit = 1;
+    __sync_synchronize();
+
+    //管道满(EAGAIN)时监视线程一定会被唤醒，读完管道之后看到quit
+    while(write(w->pipe[1], "q", 1) < 0 && errno == EINTR);
+
+    pthread_join(w->id, NULL);		//线程退出之前不能关闭管道和释放路径
+    close(w->pipe[0]);
+    close(w->pipe[1]);
+    free(w);
+}
+
+/**
+ * @brief	watch_swap	在写锁中替换监视线程
+ *
+ * @return	原来的监视线程，由调用者在锁外释放
+ */
+static log_watcher *watch_swap(log_t *this, log_watcher *w)
+{
+    log_watcher *old;
+    pthread_rwlock_wrlock(&this->lock);
+    old = this->watch;
+    this->watch = w;
+    pthread_rwlock_unlock(&this->lock);
+    return old;
+}
+
+static void watch_stop(log_t *this)
+{
+    watch_free(watch_swap(this, NULL));
+}
+
+LOG_BOOL log_watch(log_t *this, const char *path, int signo)
+{
+    struct sigaction act;
+    log_watcher *w;
+    int i;
+
+    if(this == NULL) {
+        return LOG_FALSE;
+    }
+
+    watch_stop(this);
+
+    if(path == NULL) {
+        return LOG_TRUE;
+    }
+
+    if((w = watch_create(this, path)) == NULL) {
+        return LOG_FALSE;
+    }
+
+    if(signo > 0) {
+        for(i = 0; i < LOG_WATCH_MAX; i++) {
+            if(__sync_bool_compare_and_swap(&watch_fds[i], 0, w->pipe[1] + 1)) {
+                w->slot = i;
+                break;
+            }
+        }
+
+        memset(&act, 0, sizeof(act));
+        act.sa_handler = watch_signal;
+        act.sa_flags = SA_RESTART;
+        sigemptyset(&act.sa_mask);
+
+        if(w->slot < 0 || sigaction(signo, &act, NULL) != 0) {		//信号不可用时整体失败，不留下只监视文件的线程
+            fprintf(stderr, "watch signal %d failed\n", signo);
+            watch_free(w);
+            return LOG_FALSE;
+        }
+    }
+
+    watch_free(watch_swap(this, w));		//并发调用log_watch时只保留最后一个
+    return LOG_TRUE;
+}
+
+LOG_BOOL log_set_shm(log_t *this, const char *name)
+{
+    char path[SHM_RING_NAME_LEN];
+    shm_ring *ring;
+    sink_ref *shm;
+    log_conf *conf;
+
+    if(this == NULL || name == NULL || name[0] == '\0' || strchr(name, '/') != NULL) {
+        return LOG_FALSE;
+    }
+
+    snprintf(path, SHM_RING_NAME_LEN, "/" SHM_RING_PREFIX "%s.%d", name, (int)getpid());
+    ring = shm_ring_create(path, LOG_SHM_BUFFER_NUM, sizeof(struct queue_element_t));
+
+    if(ring == NULL) {
+        return LOG_FALSE;
+    }
+
+    if((shm = sink_shm(ring)) == NULL) {
+        shm_ring_close(ring, 1);		//还没有被收集进程打开，同时删除共享内存
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if((conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        sink_put(shm);
+        return LOG_FALSE;
+    }
+
+    sink_put(conf->shm);
+    conf->shm = shm;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
+}
+
+int log_add_sink(log_t *this, const log_sink_ops *ops, void *ctx, log_format format, log_escape escape)
+{
+    sink_ref *s;
+    log_conf *conf;
+    int id;
+
+    if(this == NULL || ops == NULL || ops->write_batch == NULL || format < LOG_FORMAT_TEXT || format > LOG_FORMAT_BINARY
+       || escape < LOG_ESCAPE_RAW || escape > LOG_ESCAPE_JSON) {
+        return -1;
+    }
+
+    if(ops->open != NULL && ops->open(ctx) != 0) {		//在锁外打开，不影响正在写日志的线程
+        return -1;
+    }
+
+    if((s = sink_new(ops, ctx)) == NULL) {
+        if(ops->close != NULL) {
+            ops->close(ctx);
+        }
+
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    for(id = SINK_NUM; id < LOG_SINK_MAX && this->conf->sinks[id] != NULL; id++);
+
+    if(id == LOG_SINK_MAX || (conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
+        sink_put(s);
+        return -1;
+    }
+
+    conf->sinks[id] = s;
+    conf->format[id] = format;
+    conf->escape[id] = escape;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    return id;
+}
+
+LOG_BOOL log_remove_sink(log_t *this, int id)
+{
+    log_conf *conf;
+
+    if(this == NULL || id < SINK_NUM || id >= LOG_SINK_MAX) {
+        return LOG_FALSE;
+    }
+
+    pthread_rwlock_wrlock(&this->lock);
+
+    if(this->conf->sinks[id] == NULL || (conf = conf_copy(this)) == NULL) {
+        pthread_rwlock_unlock(&this->lock);
         return LOG_FALSE;
     }
 
-    int flags, client_sock;
-    struct addrinfo *result, hints, *rp = NULL;
-    /* result = get_addrinfo( ip, port, IP_ANY, type, IP_PROTOCOL ); */
+    sink_put(conf->sinks[id]);
+    conf->sinks[id] = NULL;
+    layout_put(conf->layout[id]);
+    conf->layout[id] = NULL;
+    conf_publish(this, conf);
+    pthread_rwlock_unlock(&this->lock);
+    rcu_synchronize();		//等待调度线程写完使用旧快照的批，返回时已经调用close
+    rcu_reclaim();
+    return LOG_TRUE;
+}
+
+static void collect_scan(log_t *this, const char *name)
+{
+    struct dirent *ent;
+    char prefix[SHM_RING_NAME_LEN], path[sizeof(ent->d_name) + 1];
+    shm_ring *ring, **rings;
+    int i, len, found;
+    DIR *dir;
+
+    for(i = 0; i < this->ring_num;) {	//生产者已经退出并且环已经读空，回收共享内存
+        if(shm_ring_peek(this->rings[i]) == NULL && !shm_ring_is_alive(this->rings[i])) {
+            shm_ring_close(this->rings[i], 1);
+            this->rings[i] = this->rings[--this->ring_num];
+        } else {
+            ++i;
+        }
+    }
+
+    if((dir = opendir("/dev/shm")) == NULL) {
+        return;
+    }
+
+    len = snprintf(prefix, SHM_RING_NAME_LEN, SHM_RING_PREFIX "%s.", name);
+
+    while((ent = readdir(dir)) != NULL) {
+        if(strncmp(ent->d_name, prefix, len) != 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/%s", ent->d_name);
+
+        for(i = 0, found = 0; i < this->ring_num; i++) {
+            if(strcmp(shm_ring_name(this->rings[i]), path) == 0) {
+                found = 1;
+                break;
+            }
+        }
+
+        if(found || (ring = shm_ring_open(path, sizeof(struct queue_element_t))) == NULL) {
+            continue;
+        }
+
+        rings = realloc(this->rings, (this->ring_num + 1) * sizeof(shm_ring *));
+
+        if(rings == NULL) {
+            shm_ring_close(ring, 0);
+            break;
+        }
+
+        this->rings = rings;
+        this->rings[this->ring_num++] = ring;
+    }
+
+    closedir(dir);
+}
+
+int log_collect(log_t *this, const char *name)
+{
+    queue_element job, *head, *best;
+    time_t now;
+    int i, count = 0, index;
+
+    if(this == NULL || name == NULL || this->init_flag == 0) {
+        return -1;
+    }
+
+    time(&now);
+    batch_begin(this->workers);
+
+    if(now != this->scan_time) {
+        collect_scan(this, name);
+        this->scan_time = now;
+    }
+
+    while(count < LOG_COLLECT_BATCH) {	//按时间戳合并所有生产者的日志
+        best = NULL;
+        index = -1;
+
+        for(i = 0; i < this->ring_num; i++) {
+            head = shm_ring_peek(this->rings[i]);
+
+            if(head != NULL && (best == NULL || head->time < best->time)) {
+                best = head;
+                index = i;
+            }
+        }
+
+        if(best == NULL) {
+            break;
+        }
+
+        memcpy(&job, best, sizeof(queue_element));
+        shm_ring_pop(this->rings[index]);
+
+        //共享内存可以被任何有权限的进程改写，级别和输出模式不合法的记录(包括伪造的LOG_LEVEL_DUMP)直接丢弃
+        if((unsigned int)job.level > DEBUG || ((unsigned int)job.mode >> LOG_SINK_MAX) != 0) {
+            ++this->collect_bad;
+            continue;
+        }
+
+        job.clock = LOG_CLOCK_REALTIME;		//生产者写入的都是墙上时间
+        job.kv_len = job.kv_len > LOG_KV_LEN ? LOG_KV_LEN : job.kv_len;
+        job.category[CATEGORY_LEN - 1] = '\0';
+        job.msg[LOG_LEN - 1] = '\0';
+        job.fmt = NULL;
+        job.ext = NULL;			//生产者模式不使用内存池
+        job.site = NULL;
+        log_coalesce(this->workers, &job);
+        log_free(&job);
+        ++this->total;
+        ++count;
+    }
+
+    coalesce_expire(this->workers, now_ns());
+    batch_end(this->workers);
+    return count;
+}
+
+inline const char *level2str(log_level level)
+{
+    if(level > DEBUG) {
+        return unknown;
+    } else {
+        return log_level_str[level];
+    }
+}
+
+/**
+ * @brief	time_civil	把秒数转换为UTC的年月日时分秒，不使用gmtime_r(需要时区锁)，可以在信号处理函数中调用
+ */
+static void time_civil(time_t sec, struct tm *tm)
+{
+    int64_t days = sec / 86400, rem = sec % 86400, era, doe, yoe, doy, mp;
+
+    if(rem < 0) {
+        rem += 86400;
+        --days;
+    }
+
+    days += 719468;		//从0000-03-01开始计算，闰日在每年的最后
+    era = (days >= 0 ? days : days - 146096) / 146097;
+    doe = days - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    tm->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+    tm->tm_mon = mp < 10 ? mp + 2 : mp - 10;
+    tm->tm_year = yoe + era * 400 + (tm->tm_mon <= 1) - 1900;
+    tm->tm_hour = rem / 3600;
+    tm->tm_min = rem % 3600 / 60;
+    tm->tm_sec = rem % 60;
+}
+
+/**
+ * @brief	render_time	输出日志时间(UTC)
+ *
+ * @param	b			输出缓冲区
+ * @param	ns			1970年以来的纳秒数
+ * @param	style		LAYOUT_TIME_DEFAULT，LAYOUT_TIME_ISO8601或者LAYOUT_TIME_UNIX(1970年以来的秒数)
+ * @param	digits		秒的小数位数，0表示不输出小数部分
+ */
+static void render_time(fmt_buf *b, int64_t ns, int style, int digits)
+{
+    static const uint32_t scale[] = {1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1};
+    int iso = style == LAYOUT_TIME_ISO8601;
+    struct tm tm;
+
+    if(style == LAYOUT_TIME_UNIX) {
+        fmt_u64(b, ns / 1000000000);
+        goto fraction;
+    }
+
+    time_civil(ns / 1000000000, &tm);
+    fmt_u64_pad(b, tm.tm_year + 1900, 4);
+    fmt_putc(b, iso ? '-' : '/');
+    fmt_u64_pad(b, tm.tm_mon + 1, 2);
+    fmt_putc(b, iso ? '-' : '/');
+    fmt_u64_pad(b, tm.tm_mday, 2);
+    fmt_putc(b, iso ? 'T' : ' ');
+    fmt_u64_pad(b, tm.tm_hour, 2);
+    fmt_putc(b, ':');
+    fmt_u64_pad(b, tm.tm_min, 2);
+    fmt_putc(b, ':');
+    fmt_u64_pad(b, tm.tm_sec, 2);
+fraction:
+
+    if(digits > 0) {
+        fmt_putc(b, '.');
+        fmt_u64_pad(b, ns % 1000000000 / scale[digits], digits);
+    }
+
+    if(iso) {
+        fmt_putc(b, 'Z');
+    }
+}
+
+/**
+ * @brief	render_binary	把日志编码为log_record，记录自带长度，不加换行符
+ *
+ * @return	编码后的长度
+ */
+static int render_binary(char *out, queue_element *job)
+{
+    log_record head;
+    char *p = out + sizeof(log_record);
+    const char *text = log_msg(job);
+    int category = strlen(job->category), msg = strlen(text);
+    int room = LOG_RENDER_LEN - sizeof(log_record) - category - job->kv_len;
+
+    if(msg > room) {
+        msg = room;
+    }
+
+    head.magic = LOG_RECORD_MAGIC;
+    head.version = LOG_RECORD_VERSION;
+    head.level = job->level;
+    head.time_us = job->time / 1000;
+    head.category_len = category;
+    head.msg_len = msg;
+    head.kv_len = job->kv_len;
+    head.reserved = 0;
+    memcpy(p, job->category, category);
+    memcpy(p + category, text, msg);
+    memcpy(p + category + msg, job->kv, job->kv_len);
+    head.len = sizeof(log_record) + category + msg + job->kv_len;
+    memcpy(out, &head, sizeof(log_record));
+    return head.len;
+}
+
+/**
+ * @brief	log_render	按照指定格式把日志渲染到out(LOG_RENDER_LEN字节)，文本格式结尾保证有换行符
+ *
+ * @return	渲染后的长度
+ */
+static int log_render(char *out, queue_element *job, log_format format, log_escape escape, int digits)
+{
+    const char *msg = log_msg(job);
+    fmt_buf b;
+    int len;
+    if(format == LOG_FORMAT_BINARY) {
+        return render_binary(out, job);
+    }
+
+    fmt_init(&b, out, LOG_RENDER_LEN);
+
+    switch(format) {
+        case LOG_FORMAT_JSON:
+            fmt_puts(&b, "{\"time\":\"");
+            render_time(&b, job->time, LAYOUT_TIME_ISO8601, digits);
+            fmt_puts(&b, "\",\"level\":\"");
+            fmt_puts(&b, level2str(job->level));
+            fmt_puts(&b, "\",\"category\":");
+            kv_json_string(&b, job->category, strlen(job->category));
+            fmt_puts(&b, ",\"msg\":");
+            kv_json_string(&b, msg, strlen(msg));
+            kv_render(&b, job->kv, job->kv_len, LOG_FORMAT_JSON);
+
+            if(job->level == DEBUG && job->site != NULL) {
+                fmt_puts(&b, ",\"file\":");
+                kv_json_string(&b, job->site->file, strlen(job->site->file));
+                fmt_puts(&b, ",\"line\":");
+                fmt_u64(&b, job->site->line);
+                fmt_puts(&b, ",\"func\":");
+                kv_json_string(&b, job->site->func, strlen(job->site->func));
+            }
+
+            fmt_putc(&b, '}');
+            break;
+        case LOG_FORMAT_LOGFMT:
+            fmt_puts(&b, "time=");
+            render_time(&b, job->time, LAYOUT_TIME_ISO8601, digits);
+            fmt_puts(&b, " level=");
+            fmt_puts(&b, level2str(job->level));
+            fmt_puts(&b, " category=");
+            kv_logfmt_string(&b, job->category, strlen(job->category));
+            fmt_puts(&b, " msg=");
+            kv_logfmt_string(&b, msg, strlen(msg));
+            kv_render(&b, job->kv, job->kv_len, LOG_FORMAT_LOGFMT);
+
+            if(job->level == DEBUG && job->site != NULL) {
+                fmt_puts(&b, " file=");
+                kv_logfmt_string(&b, job->site->file, strlen(job->site->file));
+                fmt_puts(&b, " line=");
+                fmt_u64(&b, job->site->line);
+                fmt_puts(&b, " func=");
+                kv_logfmt_string(&b, job->site->func, strlen(job->site->func));
+            }
+
+            break;
+        case LOG_FORMAT_TEXT:
+        default:
+            fmt_putc(&b, '[');
+            render_time(&b, job->time, LAYOUT_TIME_DEFAULT, digits);
+            fmt_putn(&b, "][", 2);
+            fmt_puts(&b, level2str(job->level));
+
+            for(len = strlen(level2str(job->level)); len < 5; len++) {
+                fmt_putc(&b, ' ');
+            }
+
+            fmt_putn(&b, "][", 2);
+            escape_text(&b, job->category, strlen(job->category), escape);
+            fmt_putn(&b, "] - ", 4);
+            escape_text(&b, msg, strlen(msg), escape);
+            kv_render(&b, job->kv, job->kv_len, LOG_FORMAT_TEXT);
+
+            if(job->level == DEBUG && job->site != NULL) {
+                render_site(&b, job->site);
+            }
+
+            break;
+    }
+
+    if(b.cur == b.end) {		//被截断时也保留换行符
+        --b.cur;
+    }
+
+    fmt_putc(&b, '\n');
+    return fmt_end(&b);
+}
+
+/**
+ * @brief	render_layout	按照编译好的模板渲染文本日志，结尾保证有换行符
+ *
+ * @return	渲染后的长度
+ */
+static int render_layout(char *out, queue_element *job, const layout *l, log_escape escape, int digits)
+{
+    const layout_op *op;
+    const char *msg = log_msg(job);
+    char *start;
+    fmt_buf b;
+    int n, pad;
+
+    fmt_init(&b, out, LOG_RENDER_LEN);
+
+    for(op = l->ops; op < l->ops + l->num; op++) {
+        start = b.cur;
+
+        switch(op->type) {
+            case LAYOUT_TEXT:
+                fmt_putn(&b, op->text, op->text_len);
+                break;
+            case LAYOUT_TIME:
+                render_time(&b, job->time, op->style, digits);
+                break;
+            case LAYOUT_LEVEL:
+                fmt_puts(&b, level2str(job->level));
+                break;
+            case LAYOUT_CATEGORY:
+                escape_text(&b, job->category, strlen(job->category), escape);
+                break;
+            case LAYOUT_MSG:
+                escape_text(&b, msg, strlen(msg), escape);
+                break;
+            case LAYOUT_TID:
+                fmt_u64(&b, job->tid);
+                break;
+            case LAYOUT_FILE:
+            case LAYOUT_LOCATION:
+
+                if(job->site != NULL) {
+                    fmt_puts(&b, job->site->file);
+                }
+
+                if(job->site == NULL || op->type == LAYOUT_FILE) {
+                    break;
+                }
+
+                fmt_putc(&b, ':');		//%l继续输出行号
+            case LAYOUT_LINE:
+
+                if(job->site != NULL) {
+                    fmt_u64(&b, job->site->line);
+                }
+
+                break;
+            case LAYOUT_FUNC:
+
+                if(job->site != NULL) {
+                    fmt_puts(&b, job->site->func);
+                }
+
+                break;
+            case LAYOUT_FIELDS:
+                kv_render(&b, job->kv, job->kv_len, LOG_FORMAT_TEXT);
+                break;
+            case LAYOUT_FIELD:
+                kv_field(&b, job->kv, job->kv_len, op->text, op->text_len);
+                break;
+            case LAYOUT_NEWLINE:
+            default:
+                fmt_putc(&b, '\n');
+                break;
+        }
+
+        n = b.cur - start;
+
+        if(op->max > 0 && n > op->max) {
+            b.cur = start + op->max;
+        } else if(n < op->min) {		//补空格，缓冲区不够时能补多少补多少
+            pad = op->min - n < b.end - b.cur ? op->min - n : b.end - b.cur;
+
+            if(op->left) {
+                memset(b.cur, ' ', pad);
+            } else {
+                memmove(start + pad, start, n);
+                memset(start, ' ', pad);
+            }
+
+            b.cur += pad;
+        }
+    }
+
+    if(b.cur == b.end) {		//被截断时也保留换行符
+        --b.cur;
+    }
 
-    if(result == NULL) {
-        return LOG_FALSE;
+    fmt_putc(&b, '\n');
+    return fmt_end(&b);
+}
+
+static inline int render_sink(log_worker *w, log_conf *conf, queue_element *job, int sink, int *rendered, const layout **shape, int len)
+{
+    int key = conf->format[sink] << 4 | conf->escape[sink];
+
+    if(*rendered != key || *shape != conf->layout[sink]) {	//多个设备格式、转义方式和模板相同时只渲染一次
+        *rendered = key;
+        *shape = conf->layout[sink];
+
+        if(conf->format[sink] == LOG_FORMAT_PATTERN && conf->layout[sink] != NULL) {
+            return render_layout(w->render_buffer, job, conf->layout[sink], conf->escape[sink], conf->time_digits);
+        }
+
+        return log_render(w->render_buffer, job, conf->format[sink], conf->escape[sink], conf->time_digits);
     }
 
-    memset(&hints, 0, sizeof(struct addrinfo));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = type;
-    hints.ai_protocol = IPPROTO_IP;
-    hints.ai_flags = AI_NUMERICHOST;
-    //hints.ai_flags = 0;
+    return len;
+}
 
-    if((flags = getaddrinfo(ip, port, (const struct addrinfo *)&hints, &result)) != 0) {
-        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(flags));
-        return LOG_FALSE;
+/**
+ * @brief	log_stamp	把写日志时读取的时钟转换为墙上时间
+ */
+static inline void log_stamp(queue_element *job)
+{
+    if(job->clock >= LOG_CLOCK_MONOTONIC_RAW) {
+        job->time = stamp_wall(job->clock, job->time);
+        job->clock = LOG_CLOCK_REALTIME;
     }
+}
 
-    for(rp = result; rp != NULL; rp = rp->ai_next) {
-        client_sock =
-            socket(rp->ai_family, rp->ai_socktype,
-                   rp->ai_protocol);
+/**
+ * @brief	log_materialize	延迟格式化的日志(log_write_args)在调度线程中格式化到msg，设置了内存池时长消息放在池中
+ */
+static inline void log_materialize(log_worker *w, queue_element *job)
+{
+    pool *p = w->conf->payload;
+    fmt_buf b;
+    int len;
 
-        if(client_sock == -1) {
+    if(job->fmt == NULL) {
+        return;
+    }
+
+    if(p != NULL) {		//先格式化到渲染缓冲区得到完整的长度，渲染还没有开始
+        fmt_init(&b, w->render_buffer, pool_max(p));
+        kv_format(&b, job->fmt, job->kv, job->kv_len);
+        len = fmt_end(&b);
+        log_extend(p, job, w->render_buffer, len);
+        fmt_init(&b, job->msg, LOG_LEN);
+        fmt_putn(&b, w->render_buffer, len);
+    } else {
+        fmt_init(&b, job->msg, LOG_LEN);
+        kv_format(&b, job->fmt, job->kv, job->kv_len);
+    }
+
+    fmt_end(&b);
+    job->fmt = NULL;
+    job->kv_len = 0;
+}
+
+static uint64_t log_hash(queue_element *job)
+{
+    const unsigned char *p;
+    uint64_t h = 14695981039346656037ULL ^ (job->level << 8 | job->mode);	//FNV-1a
+
+    for(p = (const unsigned char *)job->category; *p != '\0'; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+
+    for(p = (const unsigned char *)job->msg; *p != '\0'; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+
+    for(p = (const unsigned char *)job->kv; p < (const unsigned char *)job->kv + job->kv_len; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static inline int log_same(queue_element *a, queue_element *b)
+{
+    return a->level == b->level && a->mode == b->mode && a->kv_len == b->kv_len
+           && strcmp(a->category, b->category) == 0 && strcmp(a->msg, b->msg) == 0
+           && memcmp(a->kv, b->kv, a->kv_len) == 0;
+}
+
+/**
+ * @brief	coalesce_flush	输出被合并的条数，清除pending
+ */
+static void coalesce_flush(log_worker *w)
+{
+    queue_element job;
+    fmt_buf b;
+
+    if(w->pending_flag && w->repeat > 0) {
+        log_fill(&job, LOG_CLOCK_REALTIME, w->pending.mode, w->pending.level, w->pending.category, NULL);
+        fmt_init(&b, job.msg, LOG_LEN);
+        fmt_format(&b, "last message repeated %d times", w->repeat);
+        fmt_end(&b);
+        log_recored(w, &job);
+    }
+
+    w->pending_flag = 0;
+    w->repeat = 0;
+}
+
+static void log_coalesce(log_worker *w, queue_element *job)
+{
+    log_t *this = w->log;
+    int64_t now;
+    uint64_t hash;
+
+    if(job->level == LOG_LEVEL_DUMP) {
+        recorder_dump(w, job->mode);
+        return;
+    }
+
+    if(this->coalesce_window <= 0) {
+        if(w->pending_flag) {
+            coalesce_flush(w);
+        }
+
+        log_recored(w, job);
+        return;
+    }
+
+    log_materialize(w, job);
+
+    if(job->ext != NULL) {		//长消息不合并，pending不持有池中的块
+        coalesce_flush(w);
+        log_recored(w, job);
+        return;
+    }
+
+    hash = log_hash(job);
+    now = now_ns();
+
+    if(w->pending_flag && w->pending_hash == hash && now - w->pending_time < this->coalesce_window * 1000000LL
+       && log_same(&w->pending, job)) {
+        __sync_fetch_and_add(&this->coalesced, 1);
+
+        if(++w->repeat >= this->coalesce_max && this->coalesce_max > 0) {
+            coalesce_flush(w);
+        }
+
+        return;
+    }
+
+    coalesce_flush(w);
+    log_recored(w, job);
+    memcpy(&w->pending, job, log_len(job));
+    w->pending.site = NULL;
+    w->pending_hash = hash;
+    w->pending_time = now;
+    w->pending_flag = 1;
+}
+
+/**
+ * @brief	coalesce_expire	时间窗口结束时输出被合并的条数
+ */
+static void coalesce_expire(log_worker *w, int64_t now)
+{
+    if(w->pending_flag && now - w->pending_time >= w->log->coalesce_window * 1000000LL) {
+        coalesce_flush(w);
+    }
+}
+
+/**
+ * @brief	coalesce_wait	调度线程等待队列的最长时间(毫秒)，有被合并的日志时不超过时间窗口的剩余时间
+ */
+static int coalesce_wait(log_worker *w, int64_t now)
+{
+    int64_t left;
+
+    if(!w->pending_flag || w->repeat == 0) {
+        return LOG_SUPPRESS_INTERVAL * 1000;
+    }
+
+    left = (w->pending_time + w->log->coalesce_window * 1000000LL - now) / 1000000LL + 1;
+    return left < LOG_SUPPRESS_INTERVAL * 1000 ? (int)left : LOG_SUPPRESS_INTERVAL * 1000;
+}
+
+static int record_cmp(const void *a, const void *b)
+{
+    const queue_element *x = a, *y = b;
+
+    if(x->time < y->time) {
+        return -1;
+    }
+
+    return x->time > y->time ? 1 : 0;
+}
+
+/**
+ * @brief	recorder_dump	按时间顺序输出飞行记录器中还没有输出过的日志，需要在batch_begin和batch_end之间调用
+ *
+ * @param	w			调度线程
+ * @param	mode		输出模式，和触发输出的日志相同
+ */
+static void recorder_dump(log_worker *w, log_mode mode)
+{
+    recorder *rec = w->conf->rec;
+    queue_element *jobs, job;
+    int i, n, max, start;
+    fmt_buf b;
+
+    if(rec == NULL || (max = recorder_capacity(rec)) == 0 || (jobs = malloc(max * sizeof(queue_element))) == NULL) {
+        return;
+    }
+
+    n = recorder_collect(rec, jobs, max);
+
+    for(i = 0; i < n; i++) {
+        log_stamp(&jobs[i]);
+    }
+
+    qsort(jobs, n, sizeof(queue_element), record_cmp);
+    start = w->conf->rec_dump > 0 && n > w->conf->rec_dump ? n - w->conf->rec_dump : 0;
+
+    if(n > start) {
+        log_fill(&job, LOG_CLOCK_REALTIME, mode, INFO, NULL, NULL);
+        fmt_init(&b, job.msg, LOG_LEN);
+        fmt_format(&b, "flight recorder: last %d of %d records", n - start, n);
+        fmt_end(&b);
+        log_recored(w, &job);
+    }
+
+    for(i = start; i < n; i++) {
+        jobs[i].mode = mode;
+        log_recored(w, &jobs[i]);
+        log_free(&jobs[i]);
+    }
+
+    free(jobs);
+}
+
+/**
+ * @brief	log_recored	按照输出模式的每一位把日志路由到对应的设备，需要在batch_begin和batch_end之间调用
+ */
+static void log_recored(log_worker *w,  queue_element *job)
+{
+    log_conf *conf = w->conf;
+    unsigned int mode = job->mode != 0 ? job->mode : TO_CONSOLE;
+    const layout *shape = NULL;
+    int i, len = 0, rendered = -1;
+
+    if(job->level == FATAL && conf->rec != NULL) {		//先输出FATAL之前的上下文
+        recorder_dump(w, job->mode);
+    }
+
+    log_stamp(job);
+    log_materialize(w, job);
+
+    for(i = 0; mode != 0 && i < LOG_SINK_MAX; i++, mode >>= 1) {
+        if((mode & 1) && conf->sinks[i] != NULL) {
+            len = render_sink(w, conf, job, i, &rendered, &shape, len);
+            batch_add(w, i, job, len);
+        }
+    }
+}
+
+/**
+ * @brief	crash_write	直接写入描述符，datagram socket只发送一次
+ */
+static void crash_write(int fd, int sock, const char *buf, int len)
+{
+    int n;
+
+    while(len > 0) {
+        n = sock ? send(fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT) : write(fd, buf, len);
+
+        if(n < 0 && errno == EINTR) {
             continue;
         }
 
-        flags = fcntl(client_sock, F_GETFL, 0);	//if get failed, socket just be block,so no need to do the error
-        fcntl(client_sock, F_SETFL, flags | O_NONBLOCK);
+        if(n <= 0 || sock) {
+            return;
+        }
 
-        if(connect(client_sock, rp->ai_addr, rp->ai_addrlen) != -1) {
-            fcntl(client_sock, F_SETFL, flags);
-            break;
-        } else {
-            fd_set set;
-            FD_ZERO(&set);
-            FD_SET(client_sock, &set);
-            struct timeval tv;
-            tv.tv_usec = 0;
-            tv.tv_sec = 3;
-            int error = 0, len = 0;
+        buf += n;
+        len -= n;
+    }
+}
 
-            if(select(client_sock + 1, NULL, &set, NULL, &tv) > 0) {
-                getsockopt(client_sock, SOL_SOCKET, SO_ERROR,
-                           &error, (socklen_t *) & len);
+/**
+ * @brief	crash_output	按照输出模式把日志渲染到预留区后写入内置设备，自定义设备不写
+ */
+static void crash_output(log_t *this, queue_element *job, char *buf)
+{
+    crash_route *c = &this->crash;
+    unsigned int mode = job->mode != 0 ? job->mode : TO_CONSOLE;
+    int i, fd, len;
+    fmt_buf b;
 
-                if(error != 0) {
-                    close(client_sock);
-                } else {
-                    fcntl(client_sock, F_SETFL, flags);
-                    break;
+    if(job->fmt != NULL) {		//参数的格式化可能用到snprintf，格式串原样输出，参数作为字段输出
+        fmt_init(&b, job->msg, LOG_LEN);
+        fmt_puts(&b, job->fmt);
+        fmt_end(&b);
+        job->fmt = NULL;
+    }
+
+    log_stamp(job);
+
+    for(i = 0; i < SINK_NUM; i++) {
+        fd = i == SINK_FILE && job->level == DEBUG ? c->fd[SINK_NUM] : c->fd[i];
+
+        if((mode & (1U << i)) && fd >= 0) {
+            len = log_render(buf, job, c->format[i], c->escape[i], c->digits);
+            crash_write(fd, i == SINK_SOCKET, buf, len);
+        }
+    }
+}
+
+/**
+ * @brief	crash_drain	把队列中还没有输出的日志直接写入设备，和调度线程并发出队
+ *
+ * @return	输出的条数
+ */
+static int crash_drain(log_t *this, crash_reserve *r)
+{
+    queue_array *q;
+    int i, j, n = 0;
+
+    for(i = 0; i < this->worker_num; i++) {
+        for(j = 0; j < this->workers[i].lane_num; j++) {		//高级别的通道先输出
+            q = this->workers[i].order[j];
+
+            while(n < LOG_CRASH_DRAIN && q->out_queue(q, &r->job, QUEUE_UNBLOCK) == QUEUE_OP_SUCCESS) {
+                if(r->job.level != LOG_LEVEL_DUMP) {
+                    crash_output(this, &r->job, r->buf);
+                    ++n;
                 }
-            } else {	//timeout or select failed      means connect failed
-                close(client_sock);
             }
         }
     }
 
-    freeaddrinfo(result);
+    return n;
+}
+
+LOG_BOOL log_write_crash(log_t *this, log_mode mode, log_level level, char *category, const char *fmt, ...)
+{
+    crash_reserve *r;
+    fmt_buf b;
+    va_list va;
+    int i, saved = errno;
 
-    if(rp == NULL) {
+    if(this == NULL || fmt == NULL || this->init_flag == 0 || (r = this->reserve) == NULL) {
         return LOG_FALSE;
+    }
+
+    if(__sync_lock_test_and_set(&this->crash_busy, 1)) {		//其他线程同时崩溃或者处理过程中再次出错
+        return LOG_FALSE;
+    }
+
+    if(this->crash.shm == NULL) {		//先输出崩溃之前已经入队的日志
+        crash_drain(this, r);
+    }
+
+    r->job.time = stamp_read(LOG_CLOCK_REALTIME);
+    r->job.clock = LOG_CLOCK_REALTIME;
+
+    for(i = 0; category != NULL && i < CATEGORY_LEN - 1 && category[i] != '\0'; i++) {
+        r->job.category[i] = category[i];
+    }
+
+    r->job.category[i] = '\0';
+
+    if(category == NULL) {
+        memcpy(r->job.category, "main", 5);
+    }
+
+    r->job.mode = mode;
+    r->job.level = level;
+    r->job.fmt = NULL;
+    r->job.ext = NULL;
+    r->job.site = NULL;
+    r->job.kv_len = 0;
+    fmt_init(&b, r->job.msg, LOG_LEN);
+    va_start(va, fmt);
+    fmt_vformat_safe(&b, fmt, va);
+    va_end(va);
+    fmt_end(&b);
+
+    if(this->crash.shm != NULL) {		//由收集进程输出，进程退出后共享内存中的日志仍然可以被读取
+        shm_ring_push(this->crash.shm, &r->job);
     } else {
-        pthread_rwlock_wrlock(&this->lock);
-        this->sock = client_sock;
-        pthread_rwlock_unlock(&this->lock);
-        return LOG_TRUE;
+        crash_output(this, &r->job, r->buf);
     }
+
+    __sync_lock_release(&this->crash_busy);
+    errno = saved;
+    return LOG_TRUE;
 }
 
-inline const char *level2str(log_level level)
+static log_t *volatile crash_log = NULL;		//安装了崩溃处理函数的日志对象，进程内只有一个
+static volatile log_mode crash_mode;
+static const int crash_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+static const char *crash_names[] = {"SIGSEGV", "SIGBUS", "SIGFPE", "SIGILL", "SIGABRT"};
+static struct sigaction crash_old[sizeof(crash_signals) / sizeof(int)];
+static void *crash_stack = NULL;
+
+static void crash_handler(int sig, siginfo_t *info, void *uc)
 {
-    if(level > DEBUG) {
-        return unknown;
-    } else {
-        return log_level_str[level];
+    log_t *this = crash_log;
+    void *frames[LOG_CRASH_FRAMES];
+    int i, n, fd, last = -1;
+
+    for(i = 0; crash_signals[i] != sig; i++);
+
+    if(this != NULL && (sig == SIGABRT ? log_write_crash(this, crash_mode, FATAL, NULL, "caught %s, backtrace:", crash_names[i])
+                        : log_write_crash(this, crash_mode, FATAL, NULL, "caught %s, fault address %p, backtrace:", crash_names[i], info->si_addr))) {
+        n = backtrace(frames, LOG_CRASH_FRAMES);
+
+        for(fd = SINK_CONSOLE; fd <= SINK_FILE; fd++) {		//调用栈只写入文本格式的终端和日志文件
+            if((crash_mode & (1U << fd)) && this->crash.fd[fd] >= 0 && this->crash.fd[fd] != last && this->crash.format[fd] == LOG_FORMAT_TEXT) {
+                last = this->crash.fd[fd];
+                backtrace_symbols_fd(frames, n, last);
+            }
+        }
     }
+
+    sigaction(sig, &crash_old[i], NULL);		//交给原来的处理函数或者默认动作(终止并生成core)
+    raise(sig);
 }
 
-static void log_recored(log_t *this,  queue_element *job)
+/**
+ * @brief	crash_uninstall	恢复原来的信号处理函数，需要持有写锁
+ */
+static void crash_uninstall(log_t *this)
 {
-    int i = convert_level(job->level);
-    struct tm tm;
-    gmtime_r(&job->timestamp.tv_sec, &tm);
-    pthread_rwlock_rdlock(&this->lock);
+    int i;
 
-    if(job->level != DEBUG) {
-        snprintf(this->render_buffer, RENDER_BUF_LEN ,  "[%04d/%02d/%02d %02d:%02d:%02d.%03ld][%-5s][%s] - %s\n",
-                 tm.tm_year + 1900,  tm.tm_mon + 1,  tm.tm_mday,
-                 tm.tm_hour,  tm.tm_min,  tm.tm_sec,
-                 job->timestamp.tv_usec / 1000,
-                 level2str(job->level),
-                 job->category, job->msg);
-    } else {
-        snprintf(this->render_buffer, RENDER_BUF_LEN ,  "[%04d/%02d/%02d %02d:%02d:%02d.%03ld][%-5s][%s] - %s (%s,%d:%s)\n",
-                 tm.tm_year + 1900,  tm.tm_mon + 1,  tm.tm_mday,
-                 tm.tm_hour,  tm.tm_min,  tm.tm_sec,
-                 job->timestamp.tv_usec / 1000,
-                 level2str(job->level),
-                 job->category, job->msg, __FILE__, __LINE__, __FUNCTION__);
+    if(crash_log != this) {
+        return;
+    }
+
+    for(i = 0; i < (int)(sizeof(crash_signals) / sizeof(int)); i++) {
+        sigaction(crash_signals[i], &crash_old[i], NULL);
     }
 
-    switch(job->mode) {
-        case TO_FILE:
+    crash_log = NULL;
+}
 
-            if(this->log_fp[i] != NULL) {
-                fprintf(this->log_fp[i], "%s", this->render_buffer);
-            } else {
-                fprintf(stderr, "%s", this->render_buffer);
-            }
+LOG_BOOL log_set_crash_handler(log_t *this, log_mode mode)
+{
+    struct sigaction sa;
+    stack_t ss;
+    void *frame;
+    int i;
 
-            break;
-        case TO_CONSOLE_AND_FILE:
-            fprintf(stderr, "%s", this->render_buffer);
+    if(this == NULL) {
+        return LOG_FALSE;
+    }
 
-            if(this->log_fp[i] != NULL) {
-                fprintf(this->log_fp[i], "%s", this->render_buffer);
-            } else {
-                fprintf(stderr, "%s", this->render_buffer);
-            }
+    pthread_rwlock_wrlock(&this->lock);
 
-            break;
-        case TO_SOCKET:
+    if(this->init_flag == 0 || (crash_log != NULL && crash_log != this)) {
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_FALSE;
+    }
 
-            if(this->sock  == 0) {
-                return;
-            }
+    if(mode == 0) {
+        crash_uninstall(this);
+        pthread_rwlock_unlock(&this->lock);
+        return LOG_TRUE;
+    }
 
-            int total = 0, len, length;
-            length = strlen(this->render_buffer);
-            len = length;
+    if(sigaltstack(NULL, &ss) == 0 && (ss.ss_flags & SS_DISABLE)) {		//栈溢出时在备用栈上处理，只对调用的线程有效
+        if(crash_stack == NULL) {
+            crash_stack = malloc(LOG_CRASH_STACK);
+        }
 
-            while(len > 0) {
-                len = send(this->sock, this->render_buffer + total, len, 0);
+        if(crash_stack != NULL) {
+            ss.ss_sp = crash_stack;
+            ss.ss_size = LOG_CRASH_STACK;
+            ss.ss_flags = 0;
+            sigaltstack(&ss, NULL);
+        }
+    }
 
-                if(len <= 0) {
-                    break;
-                }
+    backtrace(&frame, 1);		//提前加载libgcc，信号处理函数中的backtrace不再分配内存
+    crash_mode = mode;
 
-                total  +=  len;
-                len = length - total;
-            }
+    if(crash_log == NULL) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = crash_handler;
+        sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&sa.sa_mask);
 
-            break;
-        case TO_CONSOLE:
-        default:
-            fprintf(stderr, "%s\n", this->render_buffer);
-            break;
+        for(i = 0; i < (int)(sizeof(crash_signals) / sizeof(int)); i++) {
+            sigaction(crash_signals[i], &sa, &crash_old[i]);
+        }
+
+        crash_log = this;
     }
 
     pthread_rwlock_unlock(&this->lock);
+    return LOG_TRUE;
 }
@@ -12,6 +12,30 @@
  * 8.debug级别的日志使用行缓冲，其他级别暂时也使用行缓冲，尽量减少日志丢失的可能性\n
  * 9.提供FATAL，ERROR，DEBUG，INFO四种级别\n
  * 10.日志信息的输出设备支持三种:文件，终端，SOCKET。SOCKET同时支持使用UDP或者TCP进行连接, 使用nc -u -l 5468和nc -l 5468可以进行本机测试\n
+ * 11.多进程模式:进程调用log_set_shm后日志写入本进程的共享内存环，由simplelog-collectd进程统一按时间戳合并输出，进程内不再需要调度线程\n
+ * 12.结构化日志:log_write_kv写入带类型的字段，每种输出设备可以分别选择文本、json或者logfmt格式\n
+ * 13.C++接口见simplelog.hpp，参数按类型序列化(log_write_args)，由调度线程格式化\n
+ * 14.文本格式下每种输出设备可以选择消息和分类的转义方式:原样输出(默认)、清理控制字符或者json转义，扫描使用SSE2/AVX2\n
+ * 15.LOG_*宏在每个调用点定义一个静态的log_site(文件，行号，函数，级别)，第一次使用时注册，日志记录只带指针，调试信息显示调用者的位置\n
+ * 16.每个调用点可以限流(令牌桶)和采样(每N条输出1条)，检查在格式化和入队之前，丢弃条数定期报告\n
+ * 17.调度线程可以合并连续重复的日志(分类、级别、消息和字段都相同)，只输出第一条和"last message repeated N times"\n
+ * 18.队列无锁，调度线程队列为空时先自旋再休眠，写日志的线程只有在调度线程休眠时才执行唤醒的系统调用\n
+ * 19.调度线程可以绑定cpu，开启NUMA后每个节点一个队列和调度线程，日志在写日志线程所在节点内处理\n
+ * 20.输出设备和开关等配置以不可修改的快照发布，写日志和调度线程读取快照不加锁，被替换的快照和设备在没有线程使用后释放\n
+ * 21.配置可以从ini文件加载，log_watch在文件修改或者收到信号时重新加载，新设备在锁外打开，不影响正在写日志的线程\n
+ * 22.多个日志对象可以attach到同一个调度线程池，按照权重公平地处理各自的队列，同一个文件在进程内只打开一次\n
+ * 23.输出设备使用统一的接口并按批写入，日志按照输出模式的每一位路由到对应的设备，可以注册自定义设备和内存环形设备\n
+ * 24.SOCKET设备可以是本机的unix socket(流式或者SOCK_SEQPACKET)，每批日志一次发送，对端接收不过来时缓存在非阻塞的发送缓冲区，可以使用二进制格式\n
+ * 25.飞行记录器:低于输出级别的日志不入队，保存在每个线程的内存环中，出现FATAL或者调用log_dump_recorder时才输出最近的记录\n
+ * 26.崩溃日志:log_write_crash是异步信号安全的，只使用原子操作、预留区和内部的格式化函数，先把队列中的日志直接写入描述符再写入本条，log_set_crash_handler在SIGSEGV等信号中输出最后的日志和调用栈\n
+ * 27.日志文件可以生成稀疏的时间索引(文件名.idx)，每项记录一段日志的偏移、时间范围和出现的级别，tools/simplelog-query据此二分查找时间范围\n
+ * 28.写日志时可以只读取TSC或者CLOCK_MONOTONIC_RAW，由调度线程按照定期校准的映射转换为墙上时间，输出时间的精度可以设置到纳秒\n
+ * 29.日志直接写在队列的槽位中(reserve/commit)，调度线程在槽位中处理后释放(peek/release)，不再经过栈上的临时结构复制；队列使用变长布局，没有字段的日志只占用实际使用的块\n
+ * 30.超过LOG_LEN的消息可以放在按大小分级的无锁内存池中，日志记录只带块的指针，调度线程输出后归还；池中没有空闲块时截断\n
+ * 31.优先级通道:每个级别可以使用单独的队列(容量和溢出策略各自设置)，调度线程总是先处理高级别的队列，大量DEBUG日志积压时ERROR也能立即输出；可以选择在每批中按时间戳重新排序后输出\n
+ * 32.负载削减:队列积压超过高水位时自动提高入队的最低级别(先丢弃DEBUG，再丢弃INFO)，低于低水位时逐级恢复，每次变化都输出一条日志并计数\n
+ * 33.格式模板:每个设备可以设置类似"%d{ISO8601} %-5p [%c] %t %m%n"的模板(见layout.h)，设置时编译为渲染指令，输出时不再解析模板\n
+ * 34.内联调度:DISPATCH_INLINE不创建调度线程，有日志时eventfd可读，由应用的事件循环调用log_poll输出，非阻塞设备写不出去时返回EAGAIN\n
  *
  * @author tangfu - abctangfuqiang2008@163.com
  * @version 0.1
@@ -33,17 +57,135 @@
 #include <signal.h>
 #include <stdio.h>
 #include <time.h>
+#include <stdint.h>
 #include <sys/socket.h>
 
 
 typedef enum log_mode_s { TO_CONSOLE = 0x01, TO_FILE = 0x02, TO_SOCKET = 0x04, TO_CONSOLE_AND_FILE = 0x03} log_mode;
 typedef enum log_level_s {FATAL = 0, ERROR, INFO, DEBUG } log_level;
 typedef enum log_policy_s {LOG_DELAY = 0, LOG_DIRECT} log_policy;
-typedef enum dispatch_type_s {DISPATCH_UNBLOCK = 0, DISPATCH_BLOCK} dispatch_type;
+typedef enum dispatch_type_s {DISPATCH_UNBLOCK = 0, DISPATCH_BLOCK, DISPATCH_INLINE} dispatch_type;
 typedef enum sock_type_s {TCP = SOCK_STREAM, UDP = SOCK_DGRAM} sock_type;
+typedef enum unix_type_s {UNIX_STREAM = SOCK_STREAM, UNIX_SEQPACKET = SOCK_SEQPACKET} unix_type;
+typedef enum log_format_s {LOG_FORMAT_TEXT = 0, LOG_FORMAT_JSON, LOG_FORMAT_LOGFMT, LOG_FORMAT_BINARY, LOG_FORMAT_PATTERN} log_format;
+typedef enum log_escape_s {LOG_ESCAPE_RAW = 0, LOG_ESCAPE_SANITIZE, LOG_ESCAPE_JSON} log_escape;
+typedef enum log_clock_s {LOG_CLOCK_REALTIME = 0, LOG_CLOCK_COARSE, LOG_CLOCK_MONOTONIC_RAW, LOG_CLOCK_TSC} log_clock;
+typedef enum log_overflow_s {LOG_OVERFLOW_DROP = 0, LOG_OVERFLOW_EVICT, LOG_OVERFLOW_BLOCK} log_overflow;
+typedef enum log_field_type_s {LOG_FIELD_INT = 1, LOG_FIELD_UINT, LOG_FIELD_DOUBLE, LOG_FIELD_STR, LOG_FIELD_BOOL} log_field_type;
+
+/**
+ * @brief	结构化日志的字段，一般通过LOG_KV_*宏构造
+ */
+typedef struct log_field_s {
+    const char *key;
+    log_field_type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s;
+    } value;
+} log_field;
+
+/**
+ * @brief	调用点描述，由LOG_SITE宏在每个调用点静态定义，第一次写入时注册到全局的调用点表中
+ *
+ * file，line，func和level在注册后不再改变，可以被渲染和其他模块长期引用；
+ * rate，burst和sample是限流配置，可以在LOG_*_LIMIT/LOG_*_SAMPLE宏中指定或者运行时通过log_set_limit修改
+ */
+typedef struct log_site_s {
+    const char *file;
+    int line;
+    const char *func;
+    log_level level;
+    const char *fmt;			//第一次使用时的格式串(或者消息)
+    volatile int id;			//注册后从1开始编号，0表示尚未注册
+    struct log_site_s *next;
+    volatile int rate;			//每秒允许输出的条数，0表示不限制
+    volatile int burst;			//允许的突发条数，0表示等于rate
+    volatile int sample;		//每N条输出1条，0和1表示不采样
+    log_mode mode;				//第一次使用时的输出模式，用于输出丢弃统计
+    volatile int64_t tat;		//令牌桶(GCRA)的理论到达时间，纳秒
+    volatile int64_t report_time;
+    volatile int sample_count;
+    volatile int suppressed;	//上次报告之后被限流丢弃的条数
+    struct log_lib_t *volatile owner;	//第一次使用的日志对象，只有它的调度线程定期报告丢弃统计
+} log_site;
+
+/**
+ * @brief	一条渲染好的日志(带换行符)，输出设备按批接收
+ */
+typedef struct log_line_s {
+    const char *data;
+    int len;
+    log_level level;
+    int64_t time_us;			//日志的时间(1970年以来的微秒数)
+} log_line;
+
+/**
+ * @brief	输出设备接口，内置的终端、文件和socket也使用这个接口
+ *
+ * 调度线程把路由到设备的日志渲染后攒成一批再调用write_batch，同一个设备的write_batch不会被并发调用；
+ * 设备被移除后，在调度线程不再使用它时调用close。除write_batch外都可以为NULL
+ */
+typedef struct log_sink_ops_s {
+    const char *name;
+    int (*open)(void *ctx);										//log_add_sink时调用，返回0表示成功
+    int (*write_batch)(void *ctx, const log_line *lines, int num);	//返回写入的条数，失败返回-1，非阻塞设备写不出去时设置errno为EAGAIN
+    int (*flush)(void *ctx);									//调度线程空闲之前调用，非阻塞设备还有缓存的数据时返回-1并设置errno为EAGAIN
+    void (*close)(void *ctx);
+    void (*stats)(void *ctx, FILE *stream);						//log_print_status时输出设备自己的统计
+} log_sink_ops;
+
+typedef struct log_ring_sink_s log_ring_sink;
+
+/**
+ * @brief	LOG_FORMAT_BINARY的记录头(本机字节序)，后面依次是分类、消息和字段(kv.h的编码)，都不带\0
+ *
+ * 记录自带长度，连续写入流式socket或者文件时也可以逐条解析，SOCK_SEQPACKET的一个包是一批完整的记录
+ */
+typedef struct log_record_s {
+    uint32_t len;				//整条记录的字节数，包括记录头
+    uint16_t magic;				//LOG_RECORD_MAGIC
+    uint8_t version;
+    uint8_t level;
+    int64_t time_us;			//日志的时间(1970年以来的微秒数)
+    uint16_t category_len;
+    uint16_t msg_len;
+    uint16_t kv_len;
+    uint16_t reserved;
+} log_record;
+
+#define LOG_RECORD_MAGIC	0x474c	//"LG"
+#define LOG_RECORD_VERSION	1
+
+/**
+ * @brief	日志文件的时间索引项(本机字节序)，索引文件是"日志文件名.idx"，由索引项依次组成
+ *
+ * 每项描述文件中从offset开始的一段连续的日志，到下一项的offset之前的数据都属于这一段，
+ * 最后一项之后还没有生成索引的日志需要顺序扫描
+ */
+typedef struct log_index_entry_s {
+    uint64_t offset;			//这一段在日志文件中的偏移
+    uint32_t length;			//这一段的字节数
+    uint32_t records;			//条数
+    int64_t min_us;				//最早和最晚的日志时间(1970年以来的微秒数)
+    int64_t max_us;
+    uint32_t levels;			//出现过的级别(1 << level)
+    uint32_t magic;				//LOG_INDEX_MAGIC
+} log_index_entry;
+
+#define LOG_INDEX_MAGIC		0x58494c47	//"GLIX"
+
+#define LOG_SINK_MAX		16		//路由位的个数，0-2是终端、文件和socket
+#define LOG_SINK_BATCH		64		//每批最多的条数
+#define LOG_SINK_BUF_LEN	32768	//每个调度线程每个设备的批缓冲区大小
+#define LOG_ROUTE(id)		((log_mode)(1 << (id)))		//log_add_sink返回的设备对应的输出模式，可以和TO_*组合
 
-#define LOG_STOP_SIGNAL SIGRTMAX-5
 #define LOG_SOCKET_PORT_DEFAULT "5468"
+#define LOG_SUPPRESS_INTERVAL 1		//限流丢弃统计的报告间隔(秒)
+#define LOG_LANE_WAIT		100		//LOG_OVERFLOW_BLOCK最多等待的毫秒数，调度线程停止时写日志的线程不会一直阻塞
+#define LOG_DRAIN_MAX		256		//调度线程被唤醒后最多连续处理的条数，之后写出批缓冲区
 
 
 #define LOG_FILE 0
@@ -53,11 +195,15 @@ typedef enum sock_type_s {TCP = SOCK_STREAM, UDP = SOCK_DGRAM} sock_type;
 #define LOG_BUFFER_NUM		50
 #define CATEGORY_LEN			64
 #define LOG_LEN				128
-#define RENDER_BUF_LEN		512
+#define LOG_KV_LEN			256
+#define RENDER_BUF_LEN		1024
+#define LOG_PAYLOAD_MAX		16384	//池中保存的长消息的最大长度
+#define LOG_SHM_BUFFER_NUM	1024
 
 
 /////////////////////////////////////////////LOG_INTERFACE/////////////////////////////////////////////////////
 typedef struct log_lib_t log_t;
+typedef struct log_backend_s log_backend_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,60 +219,73 @@ extern "C" {
     /**
      * @brief	log_init 初始化日志对象
      *
-     * @param	this	日志库对象指针
+     * @param	log	日志库对象指针
      *
      * @return	日志错误码
      */
-    LOG_BOOL log_init(log_t *this);
+    LOG_BOOL log_init(log_t *log);
     /**
      * @brief	log_set_file	为日志指定输出文件和调试文件
      *
-     * @param	this			日志对象
+     * @param	log			日志对象
      * @param	log_file		日志默认输出文件
      * @param	debug_file		默认调试文件
      *
      * @return	日志错误码
      */
-    LOG_BOOL log_set_file(log_t *this, char *log_file,  char *debug_file);
+    LOG_BOOL log_set_file(log_t *log, char *log_file,  char *debug_file);
     /**
      * @brief	log_set_socket	为日志指定输出套接字
      *
-     * @param	this			日志对象
+     * @param	log			日志对象
      * @param	ip				输出目标主机IP
      * @param	port			目标主机端口
      * @param	type			协议类型TCP or UDP
      *
      * @return	日志错误码
      */
-    LOG_BOOL log_set_socket(log_t *this, char *ip, char *port, sock_type type);
+    LOG_BOOL log_set_socket(log_t *log, char *ip, char *port, sock_type type);
+    /**
+     * @brief	log_set_unix	使用本机的unix socket作为输出套接字(代替log_set_socket)
+     *
+     * 每批日志一次发送，SOCK_SEQPACKET时一批是一个包；对端接收不过来或者断开时日志缓存在发送缓冲区，
+     * 缓冲区满时丢弃，断开后每秒重连一次。和log_set_format(log, TO_SOCKET, LOG_FORMAT_BINARY)一起使用开销最小
+     *
+     * @param	log			日志对象
+     * @param	path			socket路径，以@开头表示抽象命名空间
+     * @param	type			UNIX_STREAM or UNIX_SEQPACKET
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_unix(log_t *log, const char *path, unix_type type);
     /**
      * @brief	log_destroy 销毁日志
      *
-     * @param	this		日志对象指针
+     * @param	log		日志对象指针
      */
-    void log_destroy(log_t *this);
+    void log_destroy(log_t *log);
     /**
      * @brief	log_disable 禁用日志，调用后日志无法输入和输出
      *
-     * @param	this		日志对象指针
+     * @param	log		日志对象指针
      */
-    void log_disable(log_t *this);
+    void log_disable(log_t *log);
     /**
      * @brief	log_enable	开启日志，重新开启日志功能
      *
-     * @param	this		日志对象指针
+     * @param	log		日志对象指针
      */
-    void log_enable(log_t *this);
+    void log_enable(log_t *log);
     /**
      * @brief	log_stop	停止日志调度
      *
-     * @param	this		日志对象指针
+     * @param	log		日志对象指针
      */
-    void log_stop(log_t *this);
+    void log_stop(log_t *log);
     /**
      * @brief	log_write	日志写入的接口
      *
-     * @param	this		日志对象指针
+     * @param	log		日志对象指针
      * @param	mode		日志输出模式
      * @param	level		日志级别
      * @param	category	日志分类
@@ -135,43 +294,550 @@ extern "C" {
      *
      * @return				日志错误码
      */
-    LOG_BOOL log_write(log_t *this, log_mode mode, log_level level, char *category, char *fmt, ...);
+    LOG_BOOL log_write(log_t *log, log_mode mode, log_level level, char *category, char *fmt, ...);
     /**
      * @brief	log_print_status	打印日志对象当前状态
      *
-     * @param	this				日志对象指针
+     * @param	log				日志对象指针
      * @param	stream				输出流
      */
-    void log_print_status(log_t *this , FILE *stream);
+    void log_print_status(log_t *log , FILE *stream);
     /**
      * @brief	log_dispatch	日志对象调度接口
      *
-     * @param	this			日志对象指针
-     * @param	type			阻塞方式，包括以阻塞方式调度或者以非阻塞方式调度
+     * @param	log			日志对象指针
+     * @param	type			阻塞方式，包括以阻塞方式调度或者以非阻塞方式调度；
+     *							DISPATCH_INLINE不创建线程，由事件循环使用log_poll_fd和log_poll输出
      *
      * @return
      */
-    LOG_BOOL log_dispatch(log_t *this, dispatch_type type);
+    LOG_BOOL log_dispatch(log_t *log, dispatch_type type);
+    /**
+     * @brief	log_poll_fd	内联调度模式下的eventfd，有日志等待输出时可读，加入epoll等事件循环
+     *
+     * @param	log			日志对象指针
+     *
+     * @return	不是内联调度模式时返回-1
+     */
+    int log_poll_fd(log_t *log);
+    /**
+     * @brief	log_poll	在调用者的线程中输出最多budget条日志，同一时间只能在一个线程中调用
+     *
+     * 调用时清除eventfd的可读状态，返回前队列中还有日志(超过了budget)时重新设为可读，事件循环下一轮继续处理。
+     * 设置了相同日志的合并(log_set_coalesce)时需要至少每个合并窗口调用一次，输出被合并的条数。
+     * 内置的文件和tcp/udp socket设备是阻塞写入的，事件循环中应该使用unix socket设备或者非阻塞的自定义设备，
+     * 它们发送不出去的数据由设备缓存
+     *
+     * @param	log			日志对象指针
+     * @param	budget			最多处理的条数，小于等于0时为LOG_DRAIN_MAX
+     *
+     * @return	处理的条数；有设备缓存了发送不出去的数据时返回-1并且errno为EAGAIN(日志已经被处理)，
+     *			调用者稍后应该再调用一次让设备重试；不是内联调度模式时返回-1并且errno为EINVAL
+     */
+    int log_poll(log_t *log, int budget);
+    /**
+     * @brief	log_set_shm		切换为多进程模式，日志写入共享内存环(/dev/shm/simplelog-<name>.<pid>)
+     *
+     * 设置后log_write不再进入本进程队列，log_dispatch也不再创建调度线程，
+     * 日志由同名的收集进程(simplelog-collectd -n name)统一输出
+     *
+     * @param	log			日志对象指针
+     * @param	name			收集进程的名字，不能包含'/'
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_shm(log_t *log, const char *name);
+    /**
+     * @brief	log_collect		收集进程接口，按时间戳合并输出所有同名生产者共享内存环中的日志
+     *
+     * 每秒最多扫描一次/dev/shm发现新的生产者，生产者退出并且环读空后删除对应的共享内存，
+     * 输出使用本日志对象通过log_set_file和log_set_socket设置的设备
+     *
+     * @param	log			日志对象指针
+     * @param	name			收集进程的名字
+     *
+     * @return	本次输出的日志条数，返回0表示暂时没有日志，出错返回-1
+     */
+    int log_collect(log_t *log, const char *name);
+    /**
+     * @brief	log_write_kv	结构化日志写入接口
+     *
+     * 字段在调用线程中紧凑编码到日志记录里(最多LOG_KV_LEN字节，放不下的字段被丢弃)，
+     * 由调度线程按照输出设备的格式渲染
+     *
+     * @param	log		日志对象指针
+     * @param	mode		日志输出模式
+     * @param	level		日志级别
+     * @param	category	日志分类
+     * @param	msg			日志消息
+     * @param	fields		字段数组
+     * @param	num			字段数
+     *
+     * @return				日志错误码
+     */
+    LOG_BOOL log_write_kv(log_t *log, log_mode mode, log_level level, char *category, const char *msg, const log_field *fields, int num);
+    /**
+     * @brief	log_set_format	设置输出设备的日志格式
+     *
+     * @param	log			日志对象指针
+     * @param	mode			输出设备，可以是多个设备的组合
+     * @param	format			LOG_FORMAT_TEXT(默认)，LOG_FORMAT_JSON，LOG_FORMAT_LOGFMT或者LOG_FORMAT_BINARY(见log_record)
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_format(log_t *log, log_mode mode, log_format format);
+    /**
+     * @brief	log_set_pattern	使用格式模板输出文本日志，设备的格式变为LOG_FORMAT_PATTERN
+     *
+     * 模板的语法见layout.h，设置时编译为渲染指令序列，调度线程逐条执行，不解析格式串；
+     * 之后调用log_set_format可以换回内置格式。崩溃时直接写入的日志使用文本格式
+     *
+     * @param	log			日志对象指针
+     * @param	mode			输出设备，可以是多个设备的组合，共享同一个编译结果
+     * @param	pattern			格式模板，例如"%d{ISO8601} %-5p [%c] %t %m%n"
+     *
+     * @return	模板有错误时错误信息输出到stderr，返回LOG_FALSE
+     */
+    LOG_BOOL log_set_pattern(log_t *log, log_mode mode, const char *pattern);
+    /**
+     * @brief	log_set_escape	设置输出设备在文本格式下对消息和分类的转义方式
+     *
+     * json和logfmt格式总是按照各自的规则转义，不受此设置影响
+     *
+     * @param	log			日志对象指针
+     * @param	mode			输出设备，可以是多个设备的组合
+     * @param	escape			LOG_ESCAPE_RAW(默认)原样输出，LOG_ESCAPE_SANITIZE把换行和控制字符替换为\\n \\xHH的形式，
+     *							LOG_ESCAPE_JSON按照json字符串的规则转义
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_escape(log_t *log, log_mode mode, log_escape escape);
+    /**
+     * @brief	log_write_args	延迟格式化的日志写入接口，参数已经按类型序列化，不使用va_list
+     *
+     * 参数的值在调用线程中编码到日志记录里，格式化由调度线程完成，
+     * 因此fmt必须在整个进程生命周期内有效(字符串常量)，一般由simplelog.hpp调用
+     * 参数的key不使用，字符串的值被复制，格式中的长度修饰符(l,ll,h等)被忽略，按参数实际类型输出
+     *
+     * @param	log		日志对象指针
+     * @param	mode		日志输出模式
+     * @param	level		日志级别
+     * @param	category	日志分类
+     * @param	fmt			日志消息的格式(字符串常量)
+     * @param	args		参数数组
+     * @param	num			参数个数
+     *
+     * @return				日志错误码
+     */
+    LOG_BOOL log_write_args(log_t *log, log_mode mode, log_level level, char *category, const char *fmt, const log_field *args, int num);
+    /**
+     * @brief	log_write_site	带调用点的日志写入接口，日志级别取自调用点，一般通过LOG_*宏调用
+     *
+     * @param	log		日志对象指针
+     * @param	site		调用点(静态对象)
+     * @param	mode		日志输出模式
+     * @param	category	日志分类
+     * @param	fmt			日志消息的格式
+     * @param	...			变参...
+     *
+     * @return				日志错误码
+     */
+    LOG_BOOL log_write_site(log_t *log, log_site *site, log_mode mode, char *category, const char *fmt, ...);
+    /**
+     * @brief	log_write_kv_site	带调用点的log_write_kv
+     */
+    LOG_BOOL log_write_kv_site(log_t *log, log_site *site, log_mode mode, char *category, const char *msg, const log_field *fields, int num);
+    /**
+     * @brief	log_write_args_site	带调用点的log_write_args
+     */
+    LOG_BOOL log_write_args_site(log_t *log, log_site *site, log_mode mode, char *category, const char *fmt, const log_field *args, int num);
+    /**
+     * @brief	log_site_register	注册调用点，分配编号，多次调用或者并发调用时只注册一次
+     *
+     * @param	site		调用点
+     */
+    void log_site_register(log_site *site);
+    /**
+     * @brief	log_print_sites		打印所有已经注册的调用点(编号，级别，位置，函数，格式串)，用于解析只记录调用点编号的日志
+     *
+     * @param	stream				输出流
+     */
+    void log_print_sites(FILE *stream);
+    /**
+     * @brief	log_set_limit	运行时修改已经注册的调用点的限流配置
+     *
+     * 被限流丢弃的日志不会格式化也不会进入队列，丢弃条数每LOG_SUPPRESS_INTERVAL秒以
+     * "suppressed N messages from file:line"的形式报告一次
+     *
+     * @param	file		调用点所在的文件(__FILE__)，NULL表示所有文件
+     * @param	line		调用点的行号，0表示文件中的所有调用点
+     * @param	rate		每秒允许输出的条数，0表示不限制
+     * @param	burst		允许的突发条数，0表示等于rate
+     * @param	sample		每N条输出1条，0和1表示不采样
+     *
+     * @return	修改的调用点的个数
+     */
+    int log_set_limit(const char *file, int line, int rate, int burst, int sample);
+    /**
+     * @brief	log_set_coalesce	设置调度线程合并连续重复日志
+     *
+     * 一条日志正常输出后，在window_ms毫秒内连续到达的相同日志(输出设备、分类、级别、格式化后的消息和字段都相同)
+     * 只计数不输出，时间窗口结束、出现不同的日志或者计数达到max_count时输出一条"last message repeated N times"，
+     * 只保存最近一条日志用于比较，最大延迟为window_ms
+     *
+     * @param	log			日志对象指针
+     * @param	window_ms		时间窗口(毫秒)，0表示关闭(默认)
+     * @param	max_count		最多合并的条数，0表示不限制
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_coalesce(log_t *log, int window_ms, int max_count);
+    /**
+     * @brief	log_set_wakeup	设置调度线程等待日志的方式
+     *
+     * 队列为空时调度线程先自旋spin_us微秒，仍然没有日志才在futex上休眠；写日志的线程只在调度线程休眠时唤醒它。
+     * 自旋时间越长，突发日志的唤醒延迟和唤醒的系统调用越少，但空闲时占用的cpu越多
+     *
+     * @param	log			日志对象指针
+     * @param	spin_us			休眠之前自旋的微秒数，0表示直接休眠，多核默认20，单核默认0
+     * @param	busy_poll		LOG_TRUE表示调度线程从不休眠(延迟最低，一直占用一个cpu，适合绑定到单独的核)
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_wakeup(log_t *log, int spin_us, LOG_BOOL busy_poll);
+    /**
+     * @brief	log_set_affinity	设置调度线程可以运行的cpu，在log_dispatch之前调用
+     *
+     * 开启NUMA后每个调度线程使用其中属于本节点的cpu，都不属于本节点时使用节点的所有cpu
+     *
+     * @param	log			日志对象指针
+     * @param	cpus			cpu编号数组
+     * @param	num				个数，0表示不限制(默认)
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_affinity(log_t *log, const int *cpus, int num);
+    /**
+     * @brief	log_set_numa	每个NUMA节点使用单独的队列和调度线程，在log_init之后、log_dispatch之前调用
+     *
+     * 写日志的线程把日志放入所在节点的队列，队列内存分配在该节点上，调度线程只在该节点的cpu上运行，
+     * 各调度线程的输出在设备上串行写入(每条日志整体写入，不同节点之间不按时间戳重新排序)，
+     * 合并重复日志在每个节点内分别进行。只有一个节点时不做任何改变
+     *
+     * @param	log			日志对象指针
+     * @param	enable			LOG_TRUE表示开启，开启后不能关闭
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_numa(log_t *log, LOG_BOOL enable);
+    /**
+     * @brief	log_set_level	设置允许输出的最低级别，级别更低的日志在写入时直接丢弃
+     *
+     * @param	log			日志对象指针
+     * @param	level			FATAL，ERROR，INFO或者DEBUG(默认)
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_level(log_t *log, log_level level);
+    /**
+     * @brief	log_set_recorder	设置飞行记录器，保存低于输出级别的日志
+     *
+     * 被级别过滤的日志不入队，写入本线程的内存环(覆盖最老的记录，不加锁)，只格式化printf风格的消息，
+     * 出现FATAL时在FATAL之前、或者调用log_dump_recorder时，由调度线程按时间戳排序后输出最近的记录。
+     * 多进程模式(log_set_shm)下不可用
+     *
+     * @param	log			日志对象指针
+     * @param	records			每个线程保存的条数，0表示关闭(默认)
+     * @param	dump_num		每次最多输出的条数，0表示输出所有保存的记录
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_recorder(log_t *log, int records, int dump_num);
+    /**
+     * @brief	log_dump_recorder	输出飞行记录器中上次输出之后的记录
+     *
+     * @param	log			日志对象指针
+     * @param	mode			输出模式，与log_write相同
+     *
+     * @return	日志错误码，没有设置记录器时返回LOG_FALSE
+     */
+    LOG_BOOL log_dump_recorder(log_t *log, log_mode mode);
+    /**
+     * @brief	log_set_payload	设置保存长消息的内存池
+     *
+     * 格式化后超过LOG_LEN的消息从池中取得块重新格式化，日志记录只带块的指针，调度线程输出后归还。
+     * 池从256字节开始每级翻倍直到max_len，每级预先分配blocks块；需要的级别用完时使用更大的级别，
+     * 都用完时退回截断到LOG_LEN。log_write_args的消息由调度线程格式化时同样处理。写入飞行记录器的printf风格消息和多进程模式(log_set_shm)下仍然截断。
+     * 命中和缺失的统计见log_print_status
+     *
+     * @param	log			日志对象指针
+     * @param	max_len			消息的最大长度(包括结尾的\0)，超过时截断，不超过LOG_PAYLOAD_MAX，0表示关闭(默认)
+     * @param	blocks			每级的块数
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_payload(log_t *log, int max_len, int blocks);
+    /**
+     * @brief	log_set_lane	设置级别的优先级通道和队列满时的策略
+     *
+     * capacity大于0时该级别使用单独的队列(通道)，只能在log_dispatch和log_attach之前设置，每个级别只能设置一次；
+     * 没有单独通道的级别共用默认队列。调度线程每取一条都先检查高级别的通道，默认队列按其中最高的级别排序，
+     * 例如为FATAL和ERROR设置通道后，默认队列中积压的INFO和DEBUG不会推迟错误日志的输出。
+     * 队列满时的策略:LOG_OVERFLOW_DROP丢弃新日志(默认)，LOG_OVERFLOW_EVICT丢弃队列中最早的一条，
+     * LOG_OVERFLOW_BLOCK最多等待LOG_LANE_WAIT毫秒。策略对共用默认队列的级别同样有效，可以随时修改。
+     * 增加通道必须在log_dispatch之前(或者log_stop之后)，多进程模式(log_set_shm)下不能设置通道
+     *
+     * @param	log			日志对象指针
+     * @param	level			级别
+     * @param	capacity		通道能容纳的条数(至少3)，0表示只修改策略
+     * @param	policy			队列满时的策略
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_lane(log_t *log, log_level level, int capacity, log_overflow policy);
+    /**
+     * @brief	log_set_reorder	调度线程是否在每批(最多LOG_DRAIN_MAX条)中按时间戳重新排序后输出
+     *
+     * 使用通道时高级别的日志先被取出，打开后同一批中的日志仍然按照时间顺序输出，代价是每条多复制一次
+     *
+     * @param	log			日志对象指针
+     * @param	enable			是否打开，默认关闭
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_reorder(log_t *log, LOG_BOOL enable);
+    /**
+     * @brief	log_set_shed	设置按队列积压自动削减级别的高低水位
+     *
+     * 调度线程每处理一批日志检查INFO和DEBUG所在队列的积压(开启NUMA时取最大的节点)，超过高水位时多削减一个级别:
+     * 先不再接收DEBUG，仍然超过时不再接收INFO，ERROR和FATAL不会被削减；低于低水位并且距离上次变化至少LOG_SHED_HOLD毫秒时恢复一个级别。
+     * 写日志时只多比较一次级别，被削减的日志和低于输出级别的日志一样不入队(设置了飞行记录器时保存在记录器中)。
+     * 每次变化由调度线程直接输出一条日志，变化次数和被削减的条数见log_print_status。多进程模式(log_set_shm)下不起作用
+     *
+     * @param	log			日志对象指针
+     * @param	high			高水位，队列容量的百分比，0表示关闭(默认)并且立即恢复所有级别
+     * @param	low				低水位，小于high
+     * @param	mode			变化日志的输出模式，默认TO_CONSOLE_AND_FILE
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_shed(log_t *log, int high, int low, log_mode mode);
+    /**
+     * @brief	log_set_index	设置日志文件和调试文件的时间索引
+     *
+     * 索引文件为"文件名.idx"(格式见log_index_entry)，每records条或者kbytes KB日志生成一项，
+     * 之后log_set_file和log_reload打开的文件也使用这个设置；同一个文件被多个日志对象使用时以最后一次设置为准。
+     * 打开时索引描述的范围超出了文件大小(文件被截断或者替换)则清空旧的索引
+     *
+     * @param	log			日志对象指针
+     * @param	records			每多少条生成一项，0表示不按条数
+     * @param	kbytes			每多少KB生成一项，0表示不按大小，和records都为0时关闭索引
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_set_index(log_t *log, int records, int kbytes);
+    /**
+     * @brief	log_set_clock	设置写日志时读取的时钟和输出时间的精度
+     *
+     * LOG_CLOCK_REALTIME(默认)和LOG_CLOCK_COARSE(CLOCK_REALTIME_COARSE，精度为内核的tick)读出的就是墙上时间；
+     * LOG_CLOCK_MONOTONIC_RAW和LOG_CLOCK_TSC只记录原始值，由调度线程按照每秒重新校准的映射转换为墙上时间，
+     * TSC不需要系统调用和vDSO，只在x86并且cpu支持不变的TSC时可用，第一次设置时阻塞约10毫秒测量频率。
+     * 生产者模式(log_set_shm)下后两者按LOG_CLOCK_REALTIME处理。二进制格式和时间索引的精度固定为微秒
+     *
+     * @param	log			日志对象指针
+     * @param	clock			时钟
+     * @param	digits			输出时间中秒的小数位数，0到9，默认3(毫秒)
+     *
+     * @return	日志错误码，时钟不可用时返回LOG_FALSE
+     */
+    LOG_BOOL log_set_clock(log_t *log, log_clock clock, int digits);
+    /**
+     * @brief	log_write_crash	异步信号安全的日志写入接口，用于崩溃处理函数
+     *
+     * 不加锁、不分配内存、不使用printf系列函数，也不依赖调度线程:使用log_init时分配的预留区，
+     * 先把队列中还没有输出的日志(最多LOG_CRASH_DRAIN条)直接写入终端、文件和UDP socket的描述符，再写入本条日志。
+     * 不受级别和log_disable的限制；流式socket、unix socket和自定义设备不写；多进程模式下写入共享内存环。
+     * 格式串支持%d %i %u %x %X %o %c %s %p %f，遇到其他转换时剩下的格式串原样输出。
+     * 预留区正在被使用(多个线程同时崩溃或者处理过程中再次出错)时返回LOG_FALSE
+     *
+     * @param	log			日志对象指针
+     * @param	mode			输出模式，只使用终端、文件和socket三位
+     * @param	level			日志级别
+     * @param	category		日志分类，NULL表示main
+     * @param	fmt				格式串
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_write_crash(log_t *log, log_mode mode, log_level level, char *category, const char *fmt, ...);
+    /**
+     * @brief	log_set_crash_handler	安装崩溃信号(SIGSEGV，SIGBUS，SIGFPE，SIGILL，SIGABRT)的处理函数
+     *
+     * 收到信号时用log_write_crash输出FATAL日志，之后把调用栈写入文本格式的终端和日志文件，
+     * 再恢复原来的处理函数并重新发送信号(默认动作终止进程并生成core)。
+     * 进程内只能有一个日志对象安装，调用的线程同时设置备用栈以便处理栈溢出，log_destroy时自动卸载
+     *
+     * @param	log			日志对象指针
+     * @param	mode			崩溃日志的输出模式，0表示卸载
+     *
+     * @return	日志错误码，已经被其他日志对象安装时返回LOG_FALSE
+     */
+    LOG_BOOL log_set_crash_handler(log_t *log, log_mode mode);
+    /**
+     * @brief	log_reload	从配置文件重新加载级别、开关、输出设备和格式
+     *
+     * 新的文件和socket在锁外打开和连接，全部成功后作为新的配置快照一次替换，写日志和调度线程不会被阻塞，
+     * 旧设备在调度线程写完正在输出的日志后才关闭。文件有错误或者任何设备打开失败时保持原来的配置。
+     * 配置文件的格式见config.h，每次加载都重新打开文件，可以配合日志切割使用
+     *
+     * @param	log			日志对象指针，需要已经初始化
+     * @param	path			配置文件路径
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_reload(log_t *log, const char *path);
+    /**
+     * @brief	log_watch	创建线程监视配置文件，文件被修改或者收到信号时调用log_reload
+     *
+     * 使用inotify监视文件所在的目录(兼容先写临时文件再改名的编辑器)，信号处理函数只向管道写入通知，
+     * 实际的加载在监视线程中完成。同一个信号会通知所有监视配置的日志对象。
+     * 原来的监视先停止；信号无法注册时返回失败，不留下监视线程
+     *
+     * @param	log			日志对象指针
+     * @param	path			配置文件路径，NULL表示停止监视
+     * @param	signo			触发加载的信号(如SIGHUP)，0表示不使用信号
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_watch(log_t *log, const char *path, int signo);
+    /**
+     * @brief	log_backend_create	创建共享的调度线程池，多个日志对象attach之后由这组线程输出
+     *
+     * @param	threads			线程数
+     *
+     * @return	成功返回线程池，失败返回NULL
+     */
+    log_backend_t *log_backend_create(int threads);
+    /**
+     * @brief	log_backend_destroy	停止并释放线程池，仍然attach的日志对象不再被输出(需要重新log_dispatch)
+     */
+    void log_backend_destroy(log_backend_t *backend);
+    /**
+     * @brief	log_attach	日志对象由共享的调度线程池输出，代替log_dispatch，在log_init之后调用
+     *
+     * 线程池按照权重轮询所有日志对象的队列，每轮为每个队列处理weight*64条，同一时间一个队列只由一个线程处理，
+     * 所以每个日志对象的输出顺序不变。所有日志对象打开的同一个文件(按照设备号和inode判断)只打开一次。
+     * log_stop和log_destroy会从线程池中移除日志对象
+     *
+     * @param	log			日志对象指针
+     * @param	backend			线程池
+     * @param	weight			权重，不大于0时为1
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_attach(log_t *log, log_backend_t *backend, int weight);
+    /**
+     * @brief	log_add_sink	注册自定义的输出设备
+     *
+     * 返回的编号id通过LOG_ROUTE(id)作为输出模式使用，可以和TO_CONSOLE等组合，例如TO_FILE | LOG_ROUTE(id)
+     *
+     * @param	log			日志对象指针
+     * @param	ops				设备接口，需要在设备被移除之前一直有效
+     * @param	ctx				传给接口函数的参数
+     * @param	format			日志格式
+     * @param	escape			文本格式下的转义方式
+     *
+     * @return	成功返回设备编号(3到LOG_SINK_MAX-1)，失败返回-1
+     */
+    int log_add_sink(log_t *log, const log_sink_ops *ops, void *ctx, log_format format, log_escape escape);
+    /**
+     * @brief	log_remove_sink	移除自定义的输出设备，调度线程写完正在处理的日志后调用close，返回之后可以释放ctx
+     *
+     * @param	log			日志对象指针
+     * @param	id				log_add_sink返回的编号
+     *
+     * @return	日志错误码
+     */
+    LOG_BOOL log_remove_sink(log_t *log, int id);
+    /**
+     * @brief	log_ring_sink_create	创建内存环形输出设备，保存最近size字节的日志，一般用于测试
+     *
+     * 通过log_add_sink(log, &log_ring_sink_ops, ring, ...)注册，移除之后由调用者释放
+     *
+     * @param	size			保存的字节数
+     *
+     * @return	成功返回设备，失败返回NULL
+     */
+    log_ring_sink *log_ring_sink_create(int size);
+    void log_ring_sink_destroy(log_ring_sink *ring);
+    /**
+     * @brief	log_ring_sink_read	按顺序复制保存的日志(完整的行)
+     *
+     * @param	ring			设备
+     * @param	buf				缓冲区，结尾添加\0
+     * @param	len				缓冲区长度，不够时只复制最近的日志
+     *
+     * @return	复制的字节数
+     */
+    int log_ring_sink_read(log_ring_sink *ring, char *buf, int len);
+    /**
+     * @brief	log_ring_sink_lines	写入设备的总行数
+     */
+    int64_t log_ring_sink_lines(log_ring_sink *ring);
+    extern const log_sink_ops log_ring_sink_ops;
 
 #ifdef __cplusplus
 }
 #endif
 
 
+/**
+ *	@brief	调用点
+ *
+ *	在调用位置定义一个静态的log_site并返回其地址，每个调用点只有一个对象。
+ *	初始化列表写全所有字段，C++中-Wextra不会报告缺少的字段
+ *
+ */
+#define LOG_SITE_INIT(level, rate, burst, sample) \
+    {__FILE__, __LINE__, __FUNCTION__, level, NULL, 0, NULL, rate, burst, sample, (log_mode)0, 0, 0, 0, 0, NULL}
+#define LOG_SITE(level) ({ static log_site __log_site = LOG_SITE_INIT(level, 0, 0, 0); &__log_site; })
+#define LOG_SITE_LIMIT(level, rate, burst, sample) \
+    ({ static log_site __log_site = LOG_SITE_INIT(level, rate, burst, sample); &__log_site; })
+#define LOG_SITE_WRITE(this, mode, level, fmt, arg... ) log_write_site(this, LOG_SITE(level), mode, NULL, fmt, ##arg)
+
+/**
+ *	@brief	限流和采样
+ *
+ *	LOG_ERROR_LIMIT(log, 10, 20, "read failed: %d", err);	每秒最多10条，突发20条
+ *	LOG_INFO_SAMPLE(log, 100, "packet %d", id);			每100条输出1条
+ *
+ */
+#define LOG_LIMIT_WRITE(this, mode, level, rate, burst, sample, fmt, arg... ) \
+    log_write_site(this, LOG_SITE_LIMIT(level, rate, burst, sample), mode, NULL, fmt, ##arg)
+#define LOG_FATAL_LIMIT(this, rate, burst, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, FATAL, rate, burst, 0, fmt, ##arg)
+#define LOG_ERROR_LIMIT(this, rate, burst, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, ERROR, rate, burst, 0, fmt, ##arg)
+#define LOG_INFO_LIMIT(this, rate, burst, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, INFO, rate, burst, 0, fmt, ##arg)
+#define LOG_FATAL_SAMPLE(this, n, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, FATAL, 0, 0, n, fmt, ##arg)
+#define LOG_ERROR_SAMPLE(this, n, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, ERROR, 0, 0, n, fmt, ##arg)
+#define LOG_INFO_SAMPLE(this, n, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, INFO, 0, 0, n, fmt, ##arg)
+
 /**
  *	@attention
  *		开启ENABLE_DEBUG标记后，调试级别的日志信息才能正常输出，否则被注释掉了不会有任何效果
  */
 #ifdef ENABLE_DEBUG
-#define LOG_DEBUG_TO_CONSOLE(this, fmt, arg... ) log_write(this, TO_CONSOLE, DEBUG, NULL, fmt, ##arg)
-#define LOG_DEBUG(this, fmt, arg... ) log_write(this, TO_CONSOLE_AND_FILE, DEBUG, NULL, fmt, ##arg)
-#define LOG_DEBUG_TO_FILE(this, fmt, arg... ) log_write(this, TO_FILE, DEBUG, NULL, fmt, ##arg)
-#define LOG_DEBUG_TO_SOCKET(this, fmt, arg... ) log_write(this, TO_SOCKET, DEBUG, NULL, fmt, ##arg)
+#define LOG_DEBUG_TO_CONSOLE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE, DEBUG, fmt, ##arg)
+#define LOG_DEBUG(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE_AND_FILE, DEBUG, fmt, ##arg)
+#define LOG_DEBUG_TO_FILE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_FILE, DEBUG, fmt, ##arg)
+#define LOG_DEBUG_TO_SOCKET(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_SOCKET, DEBUG, fmt, ##arg)
+#define LOG_DEBUG_LIMIT(this, rate, burst, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, DEBUG, rate, burst, 0, fmt, ##arg)
+#define LOG_DEBUG_SAMPLE(this, n, fmt, arg... ) LOG_LIMIT_WRITE(this, TO_CONSOLE_AND_FILE, DEBUG, 0, 0, n, fmt, ##arg)
 #else
 #define LOG_DEBUG_TO_CONSOLE(this, fmt, arg... ) {}
 #define LOG_DEBUG(this, fmt, arg... ) {}
 #define LOG_DEBUG_TO_FILE(this, fmt, arg... ) {}
 #define LOG_DEBUG_TO_SOCKET(this, fmt, arg...) {}
+#define LOG_DEBUG_LIMIT(this, rate, burst, fmt, arg... ) {}
+#define LOG_DEBUG_SAMPLE(this, n, fmt, arg... ) {}
 #endif
 
 
@@ -181,9 +847,9 @@ extern "C" {
  *	将日志输入出到文件和终端的简化接口
  *
  */
-#define LOG_FATAL(this, fmt, arg... ) log_write(this, TO_CONSOLE_AND_FILE, FATAL, NULL, fmt, ##arg)
-#define LOG_ERROR(this, fmt, arg... ) log_write(this, TO_CONSOLE_AND_FILE, ERROR, NULL, fmt, ##arg)
-#define LOG_INFO(this, fmt, arg... ) log_write(this, TO_CONSOLE_AND_FILE, INFO, NULL, fmt, ##arg)
+#define LOG_FATAL(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE_AND_FILE, FATAL, fmt, ##arg)
+#define LOG_ERROR(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE_AND_FILE, ERROR, fmt, ##arg)
+#define LOG_INFO(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE_AND_FILE, INFO, fmt, ##arg)
 
 /**
  *	@brief	TO_CONSOLE
@@ -191,9 +857,9 @@ extern "C" {
  *	将日志输入出到终端的简化接口
  *
  */
-#define LOG_FATAL_TO_CONSOLE(this, fmt, arg... ) log_write(this, TO_CONSOLE, FATAL, NULL, fmt, ##arg)
-#define LOG_ERROR_TO_CONSOLE(this, fmt, arg... ) log_write(this, TO_CONSOLE, ERROR, NULL, fmt, ##arg)
-#define LOG_INFO_TO_CONSOLE(this, fmt, arg... ) log_write(this, TO_CONSOLE, INFO, NULL, fmt, ##arg)
+#define LOG_FATAL_TO_CONSOLE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE, FATAL, fmt, ##arg)
+#define LOG_ERROR_TO_CONSOLE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE, ERROR, fmt, ##arg)
+#define LOG_INFO_TO_CONSOLE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_CONSOLE, INFO, fmt, ##arg)
 
 /**
  *	@brief	TO_FILE
@@ -201,9 +867,9 @@ extern "C" {
  *	将日志输出到文件的简化接口
  *
  */
-#define LOG_FATAL_TO_FILE(this, fmt, arg... ) log_write(this, TO_FILE, FATAL, NULL, fmt, ##arg)
-#define LOG_ERROR_TO_FILE(this, fmt, arg... ) log_write(this, TO_FILE, ERROR, NULL, fmt, ##arg)
-#define LOG_INFO_TO_FILE(this, fmt, arg... ) log_write(this, TO_FILE, INFO, NULL, fmt, ##arg)
+#define LOG_FATAL_TO_FILE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_FILE, FATAL, fmt, ##arg)
+#define LOG_ERROR_TO_FILE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_FILE, ERROR, fmt, ##arg)
+#define LOG_INFO_TO_FILE(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_FILE, INFO, fmt, ##arg)
 
 /**
  *	@brief	TO_SOCKET
@@ -211,9 +877,33 @@ extern "C" {
  *	将日志输出到套机字的简化接口
  *
  */
-#define LOG_FATAL_TO_SOCKET(this, fmt, arg... ) log_write(this, TO_SOCKET, FATAL, NULL, fmt, ##arg)
-#define LOG_ERROR_TO_SOCKET(this, fmt, arg... ) log_write(this, TO_SOCKET, ERROR, NULL, fmt, ##arg)
-#define LOG_INFO_TO_SOCKET(this, fmt, arg... ) log_write(this, TO_SOCKET, INFO, NULL, fmt, ##arg)
+#define LOG_FATAL_TO_SOCKET(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_SOCKET, FATAL, fmt, ##arg)
+#define LOG_ERROR_TO_SOCKET(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_SOCKET, ERROR, fmt, ##arg)
+#define LOG_INFO_TO_SOCKET(this, fmt, arg... ) LOG_SITE_WRITE(this, TO_SOCKET, INFO, fmt, ##arg)
+
+/**
+ *	@brief	结构化日志字段
+ *
+ *	LOG_INFO_KV(log, "login", LOG_KV_STR("user", name), LOG_KV_INT("uid", uid));
+ *
+ */
+#define LOG_KV_INT(k, v)	((log_field){(k), LOG_FIELD_INT, {.i = (v)}})
+#define LOG_KV_UINT(k, v)	((log_field){(k), LOG_FIELD_UINT, {.u = (v)}})
+#define LOG_KV_DOUBLE(k, v)	((log_field){(k), LOG_FIELD_DOUBLE, {.d = (v)}})
+#define LOG_KV_STR(k, v)	((log_field){(k), LOG_FIELD_STR, {.s = (v)}})
+#define LOG_KV_BOOL(k, v)	((log_field){(k), LOG_FIELD_BOOL, {.i = (v) ? 1 : 0}})
+
+#define LOG_KV_WRITE(this, mode, level, msg, fields... ) \
+    log_write_kv_site(this, LOG_SITE(level), mode, NULL, msg, (log_field[]){fields}, sizeof((log_field[]){fields}) / sizeof(log_field))
+
+#ifdef ENABLE_DEBUG
+#define LOG_DEBUG_KV(this, msg, fields... ) LOG_KV_WRITE(this, TO_CONSOLE_AND_FILE, DEBUG, msg, ##fields)
+#else
+#define LOG_DEBUG_KV(this, msg, fields... ) {}
+#endif
+#define LOG_FATAL_KV(this, msg, fields... ) LOG_KV_WRITE(this, TO_CONSOLE_AND_FILE, FATAL, msg, ##fields)
+#define LOG_ERROR_KV(this, msg, fields... ) LOG_KV_WRITE(this, TO_CONSOLE_AND_FILE, ERROR, msg, ##fields)
+#define LOG_INFO_KV(this, msg, fields... ) LOG_KV_WRITE(this, TO_CONSOLE_AND_FILE, INFO, msg, ##fields)
 
 
 
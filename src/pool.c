@@ -0,0 +1,191 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define POOL_NIL		0xffffffffU		//空栈
+
+typedef struct pool_block_s {
+    pool *owner;
+    volatile uint32_t next;		//空闲时栈中的下一块
+    uint32_t cls;
+    char data[];
+} pool_block;
+
+typedef struct pool_class_s {
+    volatile uint64_t head;		//高32位是版本号，低32位是栈顶的块下标
+    int size;					//块的可用字节数
+    int stride;
+    char *base;
+} pool_class;
+
+struct pool_s {
+    int class_num;
+    int max_len;
+    int blocks;
+    volatile int refs;			//正在使用的块数加上创建者的引用
+    volatile int64_t hits;
+    volatile int64_t misses;
+    volatile int64_t oversize;
+    char *arena;
+    pool_class classes[POOL_CLASS_MAX];
+};
+
+static inline pool_block *class_block(pool_class *c, uint32_t index)
+{
+    return (pool_block *)(c->base + (size_t)index * c->stride);
+}
+
+static void class_push(pool_class *c, pool_block *blk, uint32_t index)
+{
+    uint64_t old, new;
+
+    do {
+        old = c->head;
+        blk->next = (uint32_t)old;
+        new = ((old >> 32) + 1) << 32 | index;
+    } while(!__sync_bool_compare_and_swap(&c->head, old, new));
+}
+
+static pool_block *class_pop(pool_class *c)
+{
+    uint64_t old, new;
+    uint32_t index;
+
+    do {
+        old = c->head;
+        index = (uint32_t)old;
+
+        if(index == POOL_NIL) {
+            return NULL;
+        }
+
+        new = ((old >> 32) + 1) << 32 | class_block(c, index)->next;	//块可能已经被其他线程取走，版本号变化时CAS失败
+    } while(!__sync_bool_compare_and_swap(&c->head, old, new));
+
+    return class_block(c, index);
+}
+
+pool *pool_create(int max_len, int blocks)
+{
+    pool *p;
+    pool_class *c;
+    size_t total = 0;
+    char *base;
+    int i, size;
+
+    if(max_len <= 0 || blocks <= 0 || (p = calloc(1, sizeof(pool))) == NULL) {
+        return NULL;
+    }
+
+    for(size = POOL_MIN_SIZE; p->class_num < POOL_CLASS_MAX; size <<= 1) {
+        c = &p->classes[p->class_num++];
+        c->size = size;
+        c->stride = sizeof(pool_block) + size;
+        total += (size_t)c->stride * blocks;
+
+        if(size >= max_len) {
+            break;
+        }
+    }
+
+    if((p->arena = malloc(total)) == NULL) {
+        free(p);
+        return NULL;
+    }
+
+    p->max_len = p->classes[p->class_num - 1].size < max_len ? p->classes[p->class_num - 1].size : max_len;
+    p->blocks = blocks;
+    p->refs = 1;
+
+    for(base = p->arena, c = p->classes; c < p->classes + p->class_num; c++) {
+        c->base = base;
+        c->head = POOL_NIL;
+        base += (size_t)c->stride * blocks;
+
+        for(i = blocks - 1; i >= 0; i--) {
+            class_block(c, i)->owner = p;
+            class_block(c, i)->cls = c - p->classes;
+            class_push(c, class_block(c, i), i);
+        }
+    }
+
+    return p;
+}
+
+static void pool_unref(pool *p)
+{
+    if(__sync_sub_and_fetch(&p->refs, 1) == 0) {
+        free(p->arena);
+        free(p);
+    }
+}
+
+void pool_release(void *p)
+{
+    if(p != NULL) {
+        pool_unref(p);
+    }
+}
+
+char *pool_get(pool *p, int len, int *size)
+{
+    pool_block *blk = NULL;
+    pool_class *c;
+
+    if(p == NULL) {
+        return NULL;
+    }
+
+    if(len > p->max_len) {
+        __sync_fetch_and_add(&p->oversize, 1);
+        len = p->max_len;
+    }
+
+    for(c = p->classes; c < p->classes + p->class_num && blk == NULL; c++) {	//需要的级别用完时向上借
+        if(c->size >= len) {
+            blk = class_pop(c);
+        }
+    }
+
+    if(blk == NULL) {
+        __sync_fetch_and_add(&p->misses, 1);
+        return NULL;
+    }
+
+    __sync_fetch_and_add(&p->refs, 1);
+    __sync_fetch_and_add(&p->hits, 1);
+    *size = p->classes[blk->cls].size < p->max_len ? p->classes[blk->cls].size : p->max_len;
+    return blk->data;
+}
+
+void pool_put(char *buf)
+{
+    pool_block *blk;
+    pool_class *c;
+    pool *p;
+
+    if(buf == NULL) {
+        return;
+    }
+
+    blk = (pool_block *)(buf - offsetof(pool_block, data));
+    p = blk->owner;
+    c = &p->classes[blk->cls];
+    class_push(c, blk, ((char *)blk - c->base) / c->stride);
+    pool_unref(p);
+}
+
+int pool_max(pool *p)
+{
+    return p != NULL ? p->max_len : 0;
+}
+
+void pool_stats(pool *p, int64_t *hits, int64_t *misses, int64_t *oversize, int *used)
+{
+    *hits = p->hits;
+    *misses = p->misses;
+    *oversize = p->oversize;
+    *used = p->refs - 1;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file pool.h
+ * @brief 按大小分级的内存池，保存超过LOG_LEN的日志消息
+ *
+ * 1.从POOL_MIN_SIZE字节开始每级翻倍，最大一级不小于创建时指定的最大长度，每级预先分配固定个数的块\n
+ * 2.每级的空闲块是一个无锁栈，栈顶是(块下标，版本号)，用一次64位CAS更新，没有ABA问题\n
+ * 3.需要的级别没有空闲块时使用更大的级别，都没有时pool_get失败，由调用者截断\n
+ * 4.块头记录所属的池和级别，pool_put不需要知道池；池被释放后等到所有的块都归还才真正释放内存\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stdint.h>
+
+#define POOL_MIN_SIZE		256		//最小一级的块大小
+#define POOL_CLASS_MAX		16
+
+typedef struct pool_s pool;
+
+/**
+ * @brief	pool_create	创建内存池
+ *
+ * @param	max_len			最大的块大小，超过的请求截断到这个长度
+ * @param	blocks			每级的块数
+ *
+ * @return	失败返回NULL
+ */
+pool *pool_create(int max_len, int blocks);
+/**
+ * @brief	pool_release	释放创建者的引用，所有的块都归还之后释放内存
+ */
+void pool_release(void *p);
+/**
+ * @brief	pool_get	取得至少len字节的块(len超过最大长度时按最大长度)
+ *
+ * @param	p				内存池
+ * @param	len				需要的字节数
+ * @param	size			块的实际可用字节数
+ *
+ * @return	没有空闲块时返回NULL
+ */
+char *pool_get(pool *p, int len, int *size);
+/**
+ * @brief	pool_put	归还pool_get取得的块，可以由任意线程调用
+ */
+void pool_put(char *buf);
+/**
+ * @brief	pool_max	最大的块大小
+ */
+int pool_max(pool *p);
+/**
+ * @brief	pool_stats	统计:命中(取得了块)，缺失(没有空闲块被截断)，超长(超过最大长度被截断)和正在使用的块数
+ */
+void pool_stats(pool *p, int64_t *hits, int64_t *misses, int64_t *oversize, int *used);
+
+#endif /* __POOL_H__ */
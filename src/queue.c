@@ -1,7 +1,29 @@
 #include "queue.h"
+#include "topo.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <linux/futex.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() __sync_synchronize()
+#endif
+
+#define QUEUE_PAD			-1		//数据区末尾放不下时的填充记录
+
+struct queue_slot_s {
+    volatile uint64_t seq;		//等于pos表示空闲或者已被取得，等于pos+1表示已提交，等于pos+size表示已被读取可以重用
+    int span;					//一条占用的块数，只在第一块中有效
+    int len;					//实际长度，QUEUE_PAD表示填充
+};
 
 //////////////////////////////////////////queue_array//////////////////////////////////////////
 static int queue_array_init(queue_array *this, int size , int element_size);
@@ -9,6 +31,13 @@ static int queue_array_resize(queue_array *this, int newsize);
 void queue_destroy(queue_array *this);
 static int queue_in_queue_array(queue_array *this, void *data, QUEUE_TYPE type);
 static int queue_out_queue_array(queue_array *this, void *data, QUEUE_TYPE type);
+static int queue_out_queue_array_timed(queue_array *this, void *data, int ms);
+static void *queue_reserve(queue_array *this, int len, QUEUE_TYPE type);
+static void *queue_reserve_timed(queue_array *this, int len, int ms);
+static void queue_commit(queue_array *this, void *p, int len);
+static void *queue_peek(queue_array *this, int *len, int ms);
+static void queue_release(queue_array *this, void *p);
+static int queue_wait(queue_array *this, int ms);
 static void queue_array_reset(queue_array *this);
 static inline int queue_array_getsize(queue_array *this);
 static inline int queue_array_getcurlen(queue_array *this);
@@ -24,6 +53,7 @@ queue_array *create_queue()
         return NULL;
     }
 
+    memset(this, 0, sizeof(queue_array));
     this->init = queue_array_init;
     this->reset = queue_array_reset;
     this->resize = queue_array_resize;
@@ -31,8 +61,17 @@ queue_array *create_queue()
     this->get_current_len = queue_array_getcurlen;
     this->in_queue = queue_in_queue_array;
     this->out_queue = queue_out_queue_array;
+    this->out_queue_timed = queue_out_queue_array_timed;
+    this->reserve = queue_reserve;
+    this->reserve_timed = queue_reserve_timed;
+    this->commit = queue_commit;
+    this->peek = queue_peek;
+    this->release = queue_release;
+    this->wait = queue_wait;
     this->is_empty = queue_array_is_empty;
     this->is_full = queue_array_is_full;
+    this->node = -1;
+    this->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? QUEUE_SPIN_DEFAULT : 0;	//单核上自旋没有意义
     pthread_rwlockattr_t attr;
     pthread_rwlockattr_init(&attr);
     pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
@@ -41,6 +80,386 @@ queue_array *create_queue()
     return this;
 }
 
+void queue_set_wait(queue_array *this, int spin, int busy_poll)
+{
+    if(this == NULL) {
+        return;
+    }
+
+    this->spin = spin > 0 ? spin : 0;
+    this->busy_poll = busy_poll != 0;
+}
+
+void queue_set_layout(queue_array *this, int chunk)
+{
+    if(this != NULL) {
+        this->chunk = chunk > 0 ? (chunk + 7) & ~7 : 0;
+    }
+}
+
+void queue_set_node(queue_array *this, int node)
+{
+    if(this != NULL) {
+        this->node = node;
+    }
+}
+
+/**
+ * @brief	queue_alloc	分配槽位内存，指定了节点时使用mmap并在第一次访问之前绑定
+ */
+static void *queue_alloc(queue_array *this, size_t len)
+{
+    void *p;
+
+    if(this->node < 0) {
+        return malloc(len);
+    }
+
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(p == MAP_FAILED) {
+        return NULL;
+    }
+
+    if(topo_bind(p, len, this->node) != 0) {
+        fprintf(stderr, "bind queue memory to node %d failed\n", this->node);
+    }
+
+    return p;
+}
+
+static void queue_free(queue_array *this)
+{
+    if(this->element == NULL) {
+        return;
+    }
+
+    if(this->element_len > 0) {
+        munmap(this->element, this->element_len);
+    } else {
+        free(this->element);
+    }
+
+    this->element = NULL;
+    this->element_len = 0;
+}
+
+static inline int queue_index(queue_array *this, void *p)
+{
+    return ((char *)p - this->data) / this->stride;
+}
+
+/**
+ * @brief	queue_slots_reset	重置所有槽位的序号和读写位置
+ */
+static void queue_slots_reset(queue_array *this)
+{
+    int i;
+
+    for(i = 0; i < this->size; i++) {
+        this->slots[i].seq = i;
+    }
+
+    this->in_pos = 0;
+    this->out_pos = 0;
+    this->used_max = 0;
+    __sync_synchronize();
+}
+
+static inline int64_t queue_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief	event_prepare	准备休眠，返回之后调用者需要再检查一次条件
+ *
+ * @return	传给event_wait的key
+ */
+static inline int event_prepare(queue_event *e)
+{
+    int key = e->seq;
+    e->waiters = 1;
+    __sync_synchronize();		//waiters的修改必须在再次检查条件之前可见
+    return key;
+}
+
+/**
+ * @brief	event_wait	在事件上休眠，key是event_prepare的返回值，之后已经有通知时立即返回
+ *
+ * @param	timeout		最长等待的纳秒数，小于0表示一直等待
+ */
+static void event_wait(queue_event *e, int key, int64_t timeout)
+{
+    struct timespec ts;
+
+    if(timeout >= 0) {
+        ts.tv_sec = timeout / 1000000000LL;
+        ts.tv_nsec = timeout % 1000000000LL;
+    }
+
+    syscall(SYS_futex, &e->seq, FUTEX_WAIT_PRIVATE, key, timeout >= 0 ? &ts : NULL, NULL, 0);
+}
+
+/**
+ * @brief	event_notify	条件已经改变，有等待者时唤醒
+ *
+ * @return	执行了唤醒返回1
+ */
+static inline int event_notify(queue_event *e)
+{
+    __sync_synchronize();		//条件的修改必须在读取waiters之前可见，与等待者的顺序相反
+
+    if(e->waiters == 0 || !__sync_bool_compare_and_swap(&e->waiters, 1, 0)) {	//多个通知者只有一个执行系统调用
+        return 0;
+    }
+
+    __sync_fetch_and_add(&e->seq, 1);
+
+    if(e->fd > 0) {
+        uint64_t one = 1;
+        while(write(e->fd - 1, &one, sizeof(one)) < 0 && errno == EINTR);
+        return 1;
+    }
+
+    syscall(SYS_futex, &e->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    return 1;
+}
+
+void queue_set_notify(queue_array *this, queue_event *event)
+{
+    if(this != NULL) {
+        this->notify = event;
+    }
+}
+
+void queue_wakeup(queue_array *this)
+{
+    if(this != NULL) {
+        this->woken = 1;
+        event_notify(&this->readable);
+    }
+}
+
+int queue_event_prepare(queue_event *event)
+{
+    return event_prepare(event);
+}
+
+void queue_event_wait(queue_event *event, int key, int ms)
+{
+    event_wait(event, key, ms >= 0 ? ms * 1000000LL : -1);
+}
+
+int queue_event_notify(queue_event *event)
+{
+    return event_notify(event);
+}
+
+/**
+ * @brief	ring_claim	生产者取得连续的span块，一条不跨过数据区的末尾，放不下时先提交一条填充记录占满末尾
+ *
+ * @return	第一块的数据，满时返回NULL
+ */
+static void *ring_claim(queue_array *this, int span)
+{
+    struct queue_slot_s *slot;
+    uint64_t pos = this->in_pos;
+    int64_t dif = 0;
+    int i, n, index;
+
+    while(1) {
+        index = pos % this->size;
+        n = index + span > this->size ? this->size - index : span;
+
+        for(i = 0; i < n; i++) {		//被取得还没有提交的块序号也等于pos，由CAS排除
+            if((dif = (int64_t)(this->slots[index + i].seq - (pos + i))) != 0) {
+                break;
+            }
+        }
+
+        if(i < n) {
+            if(dif < 0) {
+                return NULL;		//满
+            }
+
+            pos = this->in_pos;
+            continue;
+        }
+
+        if(!__sync_bool_compare_and_swap(&this->in_pos, pos, pos + n)) {
+            pos = this->in_pos;
+            continue;
+        }
+
+        slot = &this->slots[index];
+        slot->span = n;
+
+        if(n == span) {
+            return this->data + (size_t)index * this->stride;
+        }
+
+        slot->len = QUEUE_PAD;
+        __sync_synchronize();
+        slot->seq = pos + 1;
+        pos += n;
+    }
+}
+
+/**
+ * @brief	ring_free	把一条占用的块标记为下一圈可用，先标记后面的块，生产者从前往后检查时不会误判为满
+ */
+static void ring_free(queue_array *this, uint64_t pos, int span)
+{
+    int i, index = pos % this->size;
+    __sync_synchronize();
+
+    for(i = span - 1; i >= 0; i--) {
+        this->slots[index + i].seq = pos + i + this->size;
+    }
+}
+
+/**
+ * @brief	ring_take	消费者取得最早提交的一条，跳过填充记录
+ *
+ * @return	数据，空时返回NULL
+ */
+static void *ring_take(queue_array *this, int *len)
+{
+    struct queue_slot_s *slot;
+    uint64_t pos = this->out_pos;
+    int64_t dif;
+    int span;
+
+    while(1) {
+        slot = &this->slots[pos % this->size];
+        dif = (int64_t)(slot->seq - (pos + 1));
+
+        if(dif < 0) {
+            return NULL;		//空
+        }
+
+        if(dif == 0) {
+            __sync_synchronize();		//提交之前写入的span可见
+            span = slot->span;
+
+            if(__sync_bool_compare_and_swap(&this->out_pos, pos, pos + span)) {
+                if(slot->len != QUEUE_PAD) {
+                    *len = slot->len;
+                    return this->data + (size_t)(pos % this->size) * this->stride;
+                }
+
+                ring_free(this, pos, span);
+            }
+        }
+
+        pos = this->out_pos;
+    }
+}
+
+/**
+ * @brief	ring_poll	len不为NULL时取得最早的一条，否则只检查最早的一条是否已经提交
+ */
+static inline void *ring_poll(queue_array *this, int *len)
+{
+    uint64_t pos;
+
+    if(len != NULL) {
+        return ring_take(this, len);
+    }
+
+    pos = this->out_pos;
+    return this->slots[pos % this->size].seq == pos + 1 ? this->data : NULL;
+}
+
+/**
+ * @brief	queue_pop_wait	出队(len为NULL时只等待不取出)，队列为空时先自旋，再休眠
+ *
+ * @param	deadline	CLOCK_MONOTONIC的纳秒数，小于0表示一直等待
+ *
+ * @return	超时返回NULL
+ */
+static void *queue_pop_wait(queue_array *this, int *len, int64_t deadline)
+{
+    int64_t now, spin_end;
+    int i, key;
+    void *p;
+
+    if((p = ring_poll(this, len)) != NULL) {
+        return p;
+    }
+
+    now = queue_now();
+    spin_end = now + this->spin * 1000LL;
+
+    for(i = 1; this->busy_poll || now < spin_end; i++) {
+        if((p = ring_poll(this, len)) != NULL) {
+            return p;
+        }
+
+        if(this->woken) {
+            this->woken = 0;
+            return NULL;
+        }
+
+        cpu_relax();
+
+        if((i & 63) == 0) {		//减少读取时钟的次数
+            now = queue_now();
+
+            if(deadline >= 0 && now >= deadline) {
+                return NULL;
+            }
+        }
+    }
+
+    while(1) {
+        key = event_prepare(&this->readable);
+
+        if((p = ring_poll(this, len)) != NULL) {
+            return p;
+        }
+
+        if(this->woken || (deadline >= 0 && (now = queue_now()) >= deadline)) {
+            this->woken = 0;
+            return NULL;
+        }
+
+        __sync_fetch_and_add(&this->parks, 1);
+        event_wait(&this->readable, key, deadline >= 0 ? deadline - now : -1);
+
+        if((p = ring_poll(this, len)) != NULL) {
+            return p;
+        }
+    }
+}
+
+/**
+ * @brief	queue_setup	按照布局为size条最大长度的日志分配序号数组和数据区，成功后才释放原来的内存
+ */
+static int queue_setup(queue_array *this, int size)
+{
+    int chunks = size * this->span;
+    size_t head = ((size_t)chunks * sizeof(struct queue_slot_s) + QUEUE_CACHE_LINE - 1) & ~(size_t)(QUEUE_CACHE_LINE - 1);
+    size_t len = head + (size_t)chunks * this->stride;
+    void *p;
+
+    if((p = queue_alloc(this, len)) == NULL) {
+        return -1;
+    }
+
+    queue_free(this);
+    this->element = p;
+    this->element_len = this->node >= 0 ? len : 0;
+    this->slots = p;
+    this->data = (char *)p + head;
+    this->size = chunks;
+    queue_slots_reset(this);
+    return 0;
+}
+
 static int queue_array_init(queue_array *this, int size , int element_size)
 {
     if(this == NULL || size < 3) {
@@ -55,25 +474,16 @@ static int queue_array_init(queue_array *this, int size , int element_size)
         return 0;
     }
 
-    if(this->element != NULL) {
-        free(this->element);
-    }
+    this->element_size = element_size;
+    this->stride = this->chunk > 0 ? this->chunk : (element_size + 7) & ~7;
+    this->span = element_size > this->stride ? (element_size + this->stride - 1) / this->stride : 1;
 
-    if((this->element = malloc_array_safe(size * element_size, void)) == NULL) {
+    if(queue_setup(this, size) != 0) {
         fprintf(stderr, "static queue_array init failed\n");
         pthread_rwlock_unlock(&this->lock);
         return -1;
     }
 
-    sem_init(&this->empty, 0, size);
-    sem_init(&this->resource, 0, 0);
-    sem_init(&this->reader, 0, 1);
-    sem_init(&this->writer, 0, 1);
-    this->element_size = element_size;
-    this->size = size;
-    this->in_index = 0;
-    this->out_index = 0;
-    this->used_max = 0;
     this->drop_count = 0;
     this->init_flag = 1;
     pthread_rwlock_unlock(&this->lock);
@@ -94,34 +504,17 @@ static int queue_array_resize(queue_array *this, int newsize)
         return -1;
     }
 
-    if(this->size == newsize) {
+    if(this->size == newsize * this->span) {
         pthread_rwlock_unlock(&this->lock);
         return 0;
     }
 
-    queue_element *p;
-
-    if((p = malloc_array_safe(newsize * this->element_size, void)) == NULL) {
+    if(queue_setup(this, newsize) != 0) {
         fprintf(stderr, "static queue_array resize failed\n");
         pthread_rwlock_unlock(&this->lock);
         return -1;
     }
 
-    free_safe(this->element);
-    this->element = p;
-    this->size = newsize;
-    atomic_set(&this->cur_count, 0);
-    this->in_index = 0;
-    this->out_index = 0;
-    this->used_max = 0;
-    sem_destroy(&this->empty);
-    sem_destroy(&this->resource);
-    sem_destroy(&this->reader);
-    sem_destroy(&this->writer);
-    sem_init(&this->empty, 0, newsize);
-    sem_init(&this->resource, 0, 0);
-    sem_init(&this->reader, 0, 0);
-    sem_init(&this->writer, 0, 1);
     pthread_rwlock_unlock(&this->lock);
     return 0;
 }
@@ -141,15 +534,10 @@ void queue_destroy(queue_array *this)
         return;
     }
 
-    sem_destroy(&this->empty);
-    sem_destroy(&this->resource);
-    sem_destroy(&this->reader);
-    sem_destroy(&this->writer);
-    free_safe(this->element);
+    queue_free(this);
     this->init_flag = 0;
-    atomic_set(&this->cur_count, 0);
-    this->in_index = 0;
-    this->out_index = 0;
+    this->in_pos = 0;
+    this->out_pos = 0;
     this->size = 0;
     this->used_max = 0;
     this->drop_count = 0;
@@ -158,116 +546,174 @@ void queue_destroy(queue_array *this)
     free_safe(this);
 }
 
-static int queue_in_queue_array(queue_array *this, void *data , QUEUE_TYPE type)
+/**
+ * @brief	queue_claim_wait	取得槽位，队列满时在writable上等待
+ *
+ * @param	deadline	CLOCK_MONOTONIC的纳秒数，0表示不等待，小于0表示一直等待
+ *
+ * @return	超时返回NULL并计入丢弃
+ */
+static void *queue_claim_wait(queue_array *this, int len, int64_t deadline)
 {
-    if(this == NULL) {
-        return QUEUE_OP_ERROR;
-    }
+    int64_t now = 0;
+    int span, key;
+    void *p;
 
-    if(data == NULL) {
-        return QUEUE_OP_ERROR;
+    if(this == NULL || len < 0 || len > this->element_size) {
+        return NULL;
     }
 
-    int cur;
-    pthread_rwlock_rdlock(&this->lock);
-
     if(this->init_flag == 0) {
         fprintf(stderr, "static queue_array has not initd yet\n");
-        pthread_rwlock_unlock(&this->lock);
-        return QUEUE_OP_ERROR;
+        return NULL;
     }
 
-    switch(type) {
-        case QUEUE_BLOCK:
-            pthread_rwlock_unlock(&this->lock);
-            sem_wait(&this->empty);
-            pthread_rwlock_rdlock(&this->lock);
-            break;
-        case QUEUE_UNBLOCK:
-        default:
+    span = len > this->stride ? (len + this->stride - 1) / this->stride : 1;
 
-            if(sem_trywait(&this->empty) != 0) {
-                pthread_rwlock_unlock(&this->lock);
-                ++this->drop_count;
-                return QUEUE_FULL;
-            }
+    while((p = ring_claim(this, span)) == NULL) {
+        if(deadline == 0 || (deadline > 0 && (now = queue_now()) >= deadline)) {
+            __sync_fetch_and_add(&this->drop_count, 1);
+            return NULL;
+        }
 
+        key = event_prepare(&this->writable);
+
+        if((p = ring_claim(this, span)) != NULL) {
             break;
+        }
+
+        event_wait(&this->writable, key, deadline > 0 ? deadline - now : -1);
     }
 
-    sem_wait(&this->writer);
-    memcpy((char *)(this->element) + (this->in_index * this->element_size), data, this->element_size);
+    return p;
+}
 
-    if(this->in_index == this->size - 1) {
-        this->in_index = 0;
-    } else {
-        ++this->in_index;
+static void *queue_reserve(queue_array *this, int len, QUEUE_TYPE type)
+{
+    return queue_claim_wait(this, len, type == QUEUE_BLOCK ? -1 : 0);
+}
+
+static void *queue_reserve_timed(queue_array *this, int len, int ms)
+{
+    return queue_claim_wait(this, len, ms > 0 ? queue_now() + ms * 1000000LL : ms < 0 ? -1 : 0);
+}
+
+static void queue_commit(queue_array *this, void *p, int len)
+{
+    struct queue_slot_s *slot = &this->slots[queue_index(this, p)];
+    uint64_t pos = slot->seq;		//取得之后提交之前序号等于pos
+    int used = len > this->stride ? (len + this->stride - 1) / this->stride : 1, cur;
+
+    if(used < slot->span && __sync_bool_compare_and_swap(&this->in_pos, pos + slot->span, pos + used)) {	//之后没有生产者取得槽位时退回多余的块
+        slot->span = used;
     }
 
-    atomic_inc(&this->cur_count);
-    cur = atomic_read(&this->cur_count);
+    slot->len = len;
+    __sync_synchronize();
+    slot->seq = pos + 1;
+    cur = queue_array_getcurlen(this);
 
     if(this->used_max < cur) {
         this->used_max = cur;
     }
 
-    sem_post(&this->resource);
-    sem_post(&this->writer);
-    pthread_rwlock_unlock(&this->lock);
-    return QUEUE_OP_SUCCESS;
+    if(event_notify(this->notify != NULL ? this->notify : &this->readable)) {
+        __sync_fetch_and_add(&this->wakeups, 1);
+    }
 }
 
-static int queue_out_queue_array(queue_array *this, void *data, QUEUE_TYPE type)
+static void *queue_peek(queue_array *this, int *len, int ms)
 {
-    if(this == NULL) {
-        return QUEUE_OP_ERROR;
+    if(this == NULL || len == NULL) {
+        return NULL;
     }
 
-    if(data == NULL) {
-        return QUEUE_OP_ERROR;
+    if(this->init_flag == 0) {
+        fprintf(stderr, "static queue_array has not initd yet\n");
+        return NULL;
+    }
+
+    if(ms == 0) {
+        return ring_take(this, len);
     }
 
-    pthread_rwlock_rdlock(&this->lock);
+    return queue_pop_wait(this, len, ms > 0 ? queue_now() + ms * 1000000LL : -1);
+}
+
+static int queue_wait(queue_array *this, int ms)
+{
+    if(this == NULL || this->init_flag == 0) {
+        return 0;
+    }
+
+    return queue_pop_wait(this, NULL, ms >= 0 ? queue_now() + ms * 1000000LL : -1) != NULL;
+}
+
+static void queue_release(queue_array *this, void *p)
+{
+    struct queue_slot_s *slot = &this->slots[queue_index(this, p)];
+    ring_free(this, slot->seq - 1, slot->span);
+    event_notify(&this->writable);
+}
+
+static int queue_in_queue_array(queue_array *this, void *data , QUEUE_TYPE type)
+{
+    void *p;
+
+    if(this == NULL || data == NULL) {
+        return QUEUE_OP_ERROR;
+    }
 
     if(this->init_flag == 0) {
         fprintf(stderr, "static queue_array has not initd yet\n");
-        pthread_rwlock_unlock(&this->lock);
         return QUEUE_OP_ERROR;
     }
 
-    switch(type) {
-        case QUEUE_BLOCK:
-            pthread_rwlock_unlock(&this->lock);
-            sem_wait(&this->resource);
-            pthread_rwlock_rdlock(&this->lock);
-            break;
-        case QUEUE_UNBLOCK:
-        default:
+    if((p = queue_reserve(this, this->element_size, type)) == NULL) {
+        return QUEUE_FULL;
+    }
 
-            if(sem_trywait(&this->resource) != 0) {
-                pthread_rwlock_unlock(&this->lock);
-                return QUEUE_EMPTY;//队列空
-            }
+    memcpy(p, data, this->element_size);
+    queue_commit(this, p, this->element_size);
+    return QUEUE_OP_SUCCESS;
+}
 
-            break;
+/**
+ * @brief	queue_copy_out	复制peek取得的一条并释放槽位
+ */
+static int queue_copy_out(queue_array *this, void *data, int ms)
+{
+    void *p;
+    int len;
+
+    if(this == NULL || data == NULL) {
+        return QUEUE_OP_ERROR;
     }
 
-    sem_wait(&this->reader);
-    memcpy(data, (char *)(this->element) + this->out_index * this->element_size,  this->element_size);
+    if(this->init_flag == 0) {
+        fprintf(stderr, "static queue_array has not initd yet\n");
+        return QUEUE_OP_ERROR;
+    }
 
-    if(this->out_index == this->size - 1) {
-        this->out_index = 0;
-    } else {
-        ++this->out_index;
+    if((p = queue_peek(this, &len, ms)) == NULL) {
+        return QUEUE_EMPTY;		//队列空或者超时
     }
 
-    atomic_dec(&this->cur_count);
-    sem_post(&this->empty);
-    sem_post(&this->reader);
-    pthread_rwlock_unlock(&this->lock);
+    memcpy(data, p, len);
+    queue_release(this, p);
     return QUEUE_OP_SUCCESS;
 }
 
+static int queue_out_queue_array(queue_array *this, void *data, QUEUE_TYPE type)
+{
+    return queue_copy_out(this, data, type == QUEUE_BLOCK ? -1 : 0);
+}
+
+static int queue_out_queue_array_timed(queue_array *this, void *data, int ms)
+{
+    return queue_copy_out(this, data, ms);
+}
+
 static void queue_array_reset(queue_array *this)
 {
     if(this == NULL) {
@@ -282,72 +728,30 @@ static void queue_array_reset(queue_array *this)
         return;
     }
 
-    atomic_set(&this->cur_count, 0);
-    this->in_index = 0;
-    this->out_index = 0;
-    this->used_max = 0;
+    queue_slots_reset(this);
     this->drop_count = 0;
-    sem_destroy(&this->empty);
-    sem_destroy(&this->resource);
-    sem_destroy(&this->reader);
-    sem_destroy(&this->writer);
-    sem_init(&this->empty, 0, this->size);
-    sem_init(&this->resource, 0, 0);
-    sem_init(&this->reader, 0, 0);
-    sem_init(&this->writer, 0, 1);
     pthread_rwlock_unlock(&this->lock);
 }
 
 static inline int queue_array_getsize(queue_array *this)
 {
-    int ret;
-    pthread_rwlock_rdlock(&this->lock);
-
-    if(this->init_flag == 1) {
-        ret = this->size;
-    } else {
-        ret = 0;
-    }
-
-    pthread_rwlock_unlock(&this->lock);
-    return ret;
+    return this->init_flag == 1 ? this->size / this->span : 0;
 }
+
 static inline int queue_array_getcurlen(queue_array *this)
 {
-    int ret;
-    pthread_rwlock_rdlock(&this->lock);
-    ret = atomic_read(&this->cur_count);
-    pthread_rwlock_unlock(&this->lock);
-    return ret;
+    uint64_t out = this->out_pos;
+    int64_t len = (int64_t)(this->in_pos - out);
+    len = len > 0 ? (len < this->size ? len : this->size) : 0;
+    return (len + this->span - 1) / this->span;		//变长布局时按最大长度的条数折算
 }
 
 static inline int queue_array_is_empty(queue_array *this)
 {
-    pthread_rwlock_rdlock(&this->lock);
-
-    if(atomic_read(&this->cur_count) == 0) {
-        pthread_rwlock_unlock(&this->lock);
-        return 1;
-    } else {
-        pthread_rwlock_unlock(&this->lock);
-        return 0;
-    }
-
-    pthread_rwlock_unlock(&this->lock);
+    return queue_array_getcurlen(this) == 0;
 }
 
 static inline int queue_array_is_full(queue_array *this)
 {
-    pthread_rwlock_rdlock(&this->lock);
-
-    if(atomic_read(&this->cur_count) == this->size) {
-        pthread_rwlock_unlock(&this->lock);
-        return 1;
-    } else {
-        pthread_rwlock_unlock(&this->lock);
-        return 0;
-    }
-
-    pthread_rwlock_unlock(&this->lock);
+    return queue_array_getcurlen(this) == queue_array_getsize(this);
 }
-
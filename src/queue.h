@@ -5,8 +5,15 @@
  * 1.可以进行重复初始化\n
  * 2.queue_element结构都根据自己的需要进行修改(一般都不需要)\n
  *  	typedef 自定义的结构 queue_element;
- * 3.
- * 4.
+ * 3.入队和出队是无锁的(每个槽位带序号的环形数组)，支持多个生产者和多个消费者\n
+ * 4.消费者队列为空时先自旋等待spin微秒，然后在futex上休眠；生产者只有在有消费者休眠时才执行唤醒的系统调用\n
+ * 5.busy_poll模式下消费者一直自旋不休眠，延迟最低，但会一直占用一个cpu\n
+ * 6.init，resize，reset和destroy不能和入队出队并发执行\n
+ * 7.通过queue_set_node指定NUMA节点后，init和resize使用mmap分配槽位并绑定到该节点\n
+ * 8.多个队列由同一组消费者服务时，通过queue_set_notify让入队通知共享的事件，消费者在该事件上休眠\n
+ * 9.reserve/commit和peek/release直接在槽位中读写，不复制数据；in_queue和out_queue在其上各复制一次\n
+ * 10.queue_set_layout可以选择变长布局:数据区按块划分，一条占用连续的若干块，commit时只保留实际使用的块(最后一个取得槽位的生产者才能退回)，
+ *    序号在单独的数组中，放不下数据区末尾时用填充记录占满末尾\n
  *
  * @author tangfu - abctangfuqiang2008@163.com
  * @version 0.1
@@ -17,8 +24,7 @@
 
 #include "macro_helper.h"
 #include <pthread.h>
-#include <semaphore.h>
-#include "atomic.h"
+#include <stdint.h>
 
 //extern queue_element;
 typedef struct queue_element_t queue_element;
@@ -28,8 +34,21 @@ typedef struct queue_s queue_array;
 #define QUEUE_OP_ERROR 		-1
 #define QUEUE_FULL 			-2
 #define QUEUE_EMPTY 			-3
+#define QUEUE_SPIN_DEFAULT		20		//多核时默认的自旋时间(微秒)，单核时为0
+#define QUEUE_CACHE_LINE		64
 typedef enum QUEUE_ACTION_TYPE_S {QUEUE_UNBLOCK = 0, QUEUE_BLOCK } QUEUE_TYPE;
 
+/**
+ * @brief	事件计数器，等待者读取seq并设置waiters之后再检查一次条件，然后在seq上休眠；
+ *			通知者修改条件之后只有把waiters从1改为0的那一个增加seq并唤醒所有等待者；
+ *			设置了fd时不唤醒线程而是写入eventfd，由外部的事件循环等待
+ */
+typedef struct queue_event_s {
+    volatile int seq;
+    volatile int waiters;
+    volatile int fd;			//eventfd加1，0表示没有
+} queue_event;
+
 struct queue_s {
     int (*init)(queue_array *, int , int);
     void (*reset)(queue_array *);
@@ -38,29 +57,104 @@ struct queue_s {
     int (*get_current_len)(queue_array *);
     int (*in_queue)(queue_array *, void * , QUEUE_TYPE);
     int (*out_queue)(queue_array *, void * , QUEUE_TYPE);
+    int (*out_queue_timed)(queue_array *, void *, int);		//最多等待指定的毫秒数，超时返回QUEUE_EMPTY
+    void *(*reserve)(queue_array *, int, QUEUE_TYPE);		//取得能写入len字节的槽位，队列满时返回NULL，之后必须commit
+    void *(*reserve_timed)(queue_array *, int, int);		//队列满时最多等待指定的毫秒数(0不等待，小于0一直等待)，超时返回NULL
+    void (*commit)(queue_array *, void *, int);				//写完reserve返回的槽位，len是实际使用的字节数
+    void *(*peek)(queue_array *, int *, int);				//取得最早的一条和长度，最多等待指定的毫秒数(0不等待，小于0一直等待)，之后必须release
+    void (*release)(queue_array *, void *);					//处理完peek返回的槽位
+    int (*wait)(queue_array *, int);						//等待队列中有数据但不取出，最多等待指定的毫秒数，有数据返回1
     int (*is_empty)(queue_array *);
     int (*is_full)(queue_array *);
 
-    pthread_rwlock_t lock;
+    pthread_rwlock_t lock;		//只保护init，resize，reset和destroy
 
-    sem_t empty;
-    sem_t resource;
-    sem_t reader;
-    sem_t writer;
+    volatile int size;			//块数，定长布局时每条一块
+    int element_size;			//每条的最大字节数
+    int chunk;					//变长布局的块大小，0表示定长布局
+    int span;					//一条最多占用的块数
+    int stride;					//每块数据的大小
+    void *element;				//序号数组和数据区
+    struct queue_slot_s *slots;
+    char *data;
+    size_t element_len;			//使用mmap分配时的长度，0表示使用malloc
+    int node;					//槽位内存所在的NUMA节点，-1表示不指定
+    volatile int init_flag;
 
-    volatile int size;
-    int element_size;
-    void *element;
+    volatile int spin;			//消费者休眠之前自旋的微秒数
+    volatile int busy_poll;		//消费者从不休眠
+    queue_event readable;		//消费者等待数据
+    queue_event writable;		//阻塞方式入队的生产者等待空间
+    queue_event *volatile notify;	//不为NULL时入队通知这个共享的事件而不是readable
+    volatile int woken;			//queue_wakeup设置，等待中的消费者返回并清0
 
-    volatile int  in_index;
-    volatile int out_index;
-    volatile int init_flag;
-    atomic_t cur_count;
+    volatile int used_max;		//统计值，并发更新时可能偏小，变长布局时按最大长度的条数折算
+    volatile int drop_count;		//由于队列满而丢弃的入队操作
+    volatile int64_t wakeups;	//生产者执行唤醒系统调用的次数
+    volatile int64_t parks;		//消费者休眠的次数
 
-    volatile int used_max;		//只在入队时使用，入队操作全部互斥，因此不用原子操作
-    volatile int drop_count;		//由于队列满而丢弃点入队操作，不用原子操作理由通上
+    char pad0[QUEUE_CACHE_LINE];
+    volatile uint64_t in_pos;	//生产者之间竞争
+    char pad1[QUEUE_CACHE_LINE - 8];
+    volatile uint64_t out_pos;	//消费者之间竞争
+    char pad2[QUEUE_CACHE_LINE - 8];
 };
 
 queue_array *create_queue();
 void queue_destroy(queue_array *);
+/**
+ * @brief	queue_set_wait	设置消费者的等待方式
+ *
+ * @param	this		队列
+ * @param	spin		队列为空时休眠之前自旋的微秒数，0表示直接休眠
+ * @param	busy_poll	不为0时消费者一直自旋不休眠
+ */
+void queue_set_wait(queue_array *this, int spin, int busy_poll);
+/**
+ * @brief	queue_set_layout	选择槽位布局，在init之前调用
+ *
+ * @param	this		队列
+ * @param	chunk		变长布局的块大小(向上取整到8字节)，0表示定长布局；变长布局时init和resize的size是能容纳的最大长度的条数
+ */
+void queue_set_layout(queue_array *this, int chunk);
+/**
+ * @brief	queue_set_node	指定槽位内存所在的NUMA节点，在init或者resize之前调用
+ *
+ * @param	this		队列
+ * @param	node		节点，-1表示不指定
+ */
+void queue_set_node(queue_array *this, int node);
+/**
+ * @brief	queue_set_notify	入队时通知外部的事件，用于一组消费者服务多个队列
+ *
+ * @param	this		队列
+ * @param	event		共享的事件，NULL表示恢复通知队列自己的readable
+ */
+void queue_set_notify(queue_array *this, queue_event *event);
+/**
+ * @brief	queue_wakeup	让正在等待(或者下一次等待)的消费者立即返回，用于消费者线程退出
+ *
+ * @param	this		队列
+ */
+void queue_wakeup(queue_array *this);
+/**
+ * @brief	queue_event_prepare	准备在事件上休眠，返回之后调用者需要再检查一次条件
+ *
+ * @return	传给queue_event_wait的key
+ */
+int queue_event_prepare(queue_event *event);
+/**
+ * @brief	queue_event_wait	在事件上休眠，prepare之后已经有通知时立即返回
+ *
+ * @param	event		事件
+ * @param	key			queue_event_prepare的返回值
+ * @param	ms			最长等待的毫秒数，小于0表示一直等待
+ */
+void queue_event_wait(queue_event *event, int key, int ms);
+/**
+ * @brief	queue_event_notify	条件已经改变，有等待者时唤醒
+ *
+ * @return	执行了唤醒返回1
+ */
+int queue_event_notify(queue_event *event);
 #endif /* __QUEUE_H__  */
@@ -0,0 +1,183 @@
+#include "rcu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+typedef struct rcu_thread_s {
+    volatile uint64_t epoch;		//进入读区间时的全局epoch，0表示不在读区间
+    int depth;
+    volatile int used;
+    struct rcu_thread_s *next;
+} __attribute__((aligned(64))) rcu_thread;
+
+typedef struct rcu_node_s {
+    void *p;
+    void (*release)(void *);
+    uint64_t epoch;				//替换发生时的epoch
+    struct rcu_node_s *next;
+} rcu_node;
+
+static rcu_thread *volatile thread_list = NULL;		//槽位只增加不释放
+static volatile uint64_t global_epoch = 1;
+static rcu_node *retire_list = NULL;
+static pthread_mutex_t retire_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t rcu_key;
+static pthread_once_t rcu_once = PTHREAD_ONCE_INIT;
+static __thread rcu_thread *self = NULL;
+
+static void rcu_thread_exit(void *p)
+{
+    rcu_thread *t = p;
+    t->depth = 0;
+    t->epoch = 0;
+    __sync_synchronize();
+    t->used = 0;
+}
+
+static void rcu_key_create(void)
+{
+    pthread_key_create(&rcu_key, rcu_thread_exit);
+}
+
+/**
+ * @brief	rcu_register	分配本线程的槽位，优先复用已经退出的线程的槽位
+ */
+static rcu_thread *rcu_register(void)
+{
+    rcu_thread *t;
+    pthread_once(&rcu_once, rcu_key_create);
+
+    for(t = thread_list; t != NULL; t = t->next) {
+        if(t->used == 0 && __sync_bool_compare_and_swap(&t->used, 0, 1)) {
+            break;
+        }
+    }
+
+    if(t == NULL) {
+        if(posix_memalign((void **)&t, sizeof(rcu_thread), sizeof(rcu_thread)) != 0) {
+            fprintf(stderr, "rcu register thread failed\n");
+            return NULL;
+        }
+
+        memset(t, 0, sizeof(rcu_thread));
+        t->used = 1;
+
+        do {
+            t->next = thread_list;
+        } while(!__sync_bool_compare_and_swap(&thread_list, t->next, t));
+    }
+
+    pthread_setspecific(rcu_key, t);
+    self = t;
+    return t;
+}
+
+void rcu_read_lock(void)
+{
+    rcu_thread *t = self != NULL ? self : rcu_register();
+
+    if(t != NULL && t->depth++ == 0) {
+        t->epoch = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+        __sync_synchronize();		//槽位的写入必须在读取发布的指针之前可见
+    }
+}
+
+void rcu_read_unlock(void)
+{
+    rcu_thread *t = self;
+
+    if(t != NULL && --t->depth == 0) {
+        __atomic_store_n(&t->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief	rcu_min_epoch	所有读区间中最早的epoch
+ */
+static uint64_t rcu_min_epoch(void)
+{
+    rcu_thread *t;
+    uint64_t e, min = UINT64_MAX;
+    __sync_synchronize();
+
+    for(t = thread_list; t != NULL; t = t->next) {
+        e = t->epoch;
+
+        if(e != 0 && e < min) {
+            min = e;
+        }
+    }
+
+    return min;
+}
+
+void rcu_synchronize(void)
+{
+    uint64_t epoch = __sync_fetch_and_add(&global_epoch, 1);
+
+    while(rcu_min_epoch() <= epoch) {
+        sched_yield();
+    }
+}
+
+void rcu_retire(void *p, void (*release)(void *))
+{
+    rcu_node *node;
+
+    if(p == NULL) {
+        return;
+    }
+
+    if((node = malloc(sizeof(rcu_node))) == NULL) {		//无法延迟时同步等待
+        rcu_synchronize();
+        release(p);
+        return;
+    }
+
+    node->p = p;
+    node->release = release;
+    node->epoch = __sync_fetch_and_add(&global_epoch, 1);	//之后进入读区间的读者只能看到新指针
+    pthread_mutex_lock(&retire_lock);
+    node->next = retire_list;
+    retire_list = node;
+    pthread_mutex_unlock(&retire_lock);
+    rcu_reclaim();
+}
+
+int rcu_reclaim(void)
+{
+    rcu_node **pp, *node, *done = NULL;
+    uint64_t min;
+    int count = 0;
+
+    if(retire_list == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&retire_lock);
+    min = rcu_min_epoch();
+
+    for(pp = &retire_list; (node = *pp) != NULL;) {
+        if(node->epoch < min) {
+            *pp = node->next;
+            node->next = done;
+            done = node;
+        } else {
+            pp = &node->next;
+        }
+    }
+
+    pthread_mutex_unlock(&retire_lock);
+
+    while((node = done) != NULL) {		//释放函数可能很慢(fclose)，不在锁中调用
+        done = node->next;
+        node->release(node->p);
+        free(node);
+        ++count;
+    }
+
+    return count;
+}
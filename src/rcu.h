@@ -0,0 +1,43 @@
+/**
+ * @file rcu.h
+ * @brief 基于epoch的延迟回收，读者不加锁
+ *
+ * 1.读者在rcu_read_lock和rcu_read_unlock之间读取发布的指针，只写本线程的槽位，不和其他线程竞争同一个cache line\n
+ * 2.写者用新对象替换指针后调用rcu_retire，旧对象在所有可能看到它的读者离开读区间后释放\n
+ * 3.每个线程第一次读时注册槽位，线程退出时槽位由pthread的线程私有数据析构函数归还，可以被新线程复用\n
+ * 4.读区间可以嵌套，读区间中不能调用rcu_synchronize\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __RCU_H__
+#define __RCU_H__
+
+/**
+ * @brief	rcu_read_lock	进入读区间
+ */
+void rcu_read_lock(void);
+/**
+ * @brief	rcu_read_unlock	离开读区间
+ */
+void rcu_read_unlock(void);
+/**
+ * @brief	rcu_retire		延迟释放已经被替换的对象
+ *
+ * @param	p				对象
+ * @param	release			释放函数，在没有读者使用对象之后调用(可能在其他线程中)
+ */
+void rcu_retire(void *p, void (*release)(void *));
+/**
+ * @brief	rcu_reclaim		释放已经没有读者的对象
+ *
+ * @return	释放的个数
+ */
+int rcu_reclaim(void);
+/**
+ * @brief	rcu_synchronize	等待调用之前进入读区间的读者全部离开
+ */
+void rcu_synchronize(void);
+
+#endif /* __RCU_H__ */
@@ -0,0 +1,192 @@
+#include "recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct recorder_slot_s {
+    volatile uint32_t seq;		//奇数表示正在写
+    uint32_t pad;
+    uint64_t index;				//写入时的环序号，读者用来判断槽位是否已经被下一圈覆盖
+    char data[];
+} recorder_slot;
+
+typedef struct recorder_ring_s {
+    volatile uint64_t head;		//下一个写入的序号，只有所属线程修改
+    uint64_t collected;			//上次collect读到的序号，只有读者使用
+    volatile int used;			//所属线程退出后清0
+    struct recorder_ring_s *next;
+    char slots[];
+} recorder_ring;
+
+struct recorder_s {
+    int records;
+    int slot_len;
+    pthread_key_t key;			//线程对应的环
+    recorder_ring *volatile rings;	//只增加，随记录器一起释放
+    volatile int ring_num;
+    pthread_mutex_t lock;		//串行化读者
+};
+
+static inline recorder_slot *ring_slot(recorder *rec, recorder_ring *ring, uint64_t index)
+{
+    return (recorder_slot *)(ring->slots + (index % rec->records) * rec->slot_len);
+}
+
+static void ring_release(void *p)
+{
+    __sync_lock_release(&((recorder_ring *)p)->used);
+}
+
+recorder *recorder_create(int records, int element_len)
+{
+    recorder *rec;
+
+    if(records <= 0 || element_len <= 0 || (rec = calloc(1, sizeof(recorder))) == NULL) {
+        return NULL;
+    }
+
+    if(pthread_key_create(&rec->key, ring_release) != 0) {
+        free(rec);
+        return NULL;
+    }
+
+    rec->records = records;
+    rec->slot_len = (sizeof(recorder_slot) + element_len + 7) & ~7;
+    pthread_mutex_init(&rec->lock, NULL);
+    return rec;
+}
+
+void recorder_destroy(void *p)
+{
+    recorder *rec = p;
+    recorder_ring *ring;
+
+    if(rec == NULL) {
+        return;
+    }
+
+    pthread_key_delete(rec->key);		//之后退出的线程不再访问环
+
+    while((ring = rec->rings) != NULL) {
+        rec->rings = ring->next;
+        free(ring);
+    }
+
+    pthread_mutex_destroy(&rec->lock);
+    free(rec);
+}
+
+/**
+ * @brief	recorder_register	为本线程分配环，优先复用已经退出的线程的环
+ */
+static recorder_ring *recorder_register(recorder *rec)
+{
+    recorder_ring *ring;
+
+    for(ring = rec->rings; ring != NULL; ring = ring->next) {
+        if(ring->used == 0 && __sync_bool_compare_and_swap(&ring->used, 0, 1)) {
+            break;
+        }
+    }
+
+    if(ring == NULL) {
+        if((ring = calloc(1, sizeof(recorder_ring) + (size_t)rec->records * rec->slot_len)) == NULL) {
+            return NULL;
+        }
+
+        ring->used = 1;
+
+        do {
+            ring->next = rec->rings;
+        } while(!__sync_bool_compare_and_swap(&rec->rings, ring->next, ring));
+
+        __sync_fetch_and_add(&rec->ring_num, 1);
+    }
+
+    pthread_setspecific(rec->key, ring);
+    return ring;
+}
+
+void *recorder_begin(recorder *rec)
+{
+    recorder_ring *ring = pthread_getspecific(rec->key);
+    recorder_slot *slot;
+
+    if(ring == NULL && (ring = recorder_register(rec)) == NULL) {
+        return NULL;
+    }
+
+    slot = ring_slot(rec, ring, ring->head);
+    slot->seq++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);		//序号变为奇数在写内容之前可见
+    slot->index = ring->head;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+    return slot->data;
+}
+
+void recorder_end(void *p)
+{
+    recorder_slot *slot = (recorder_slot *)((char *)p - offsetof(recorder_slot, data));
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+int recorder_capacity(recorder *rec)
+{
+    return rec->ring_num * rec->records;
+}
+
+int recorder_collect(recorder *rec, void *out, int max)
+{
+    int n = 0, len = rec->slot_len - sizeof(recorder_slot);
+    recorder_ring *ring;
+    recorder_slot *slot;
+    uint64_t i, head, index;
+    uint32_t seq;
+
+    pthread_mutex_lock(&rec->lock);
+
+    for(ring = rec->rings; ring != NULL && n < max; ring = ring->next) {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        i = head > (uint64_t)rec->records ? head - rec->records : 0;
+
+        for(i = i > ring->collected ? i : ring->collected; i < head && n < max; i++) {
+            slot = ring_slot(rec, ring, i);
+
+            if((seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)) & 1) {
+                continue;
+            }
+
+            index = slot->index;
+            memcpy((char *)out + (size_t)n * len, slot->data, len);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if(slot->seq == seq && index == i) {		//复制期间没有被覆盖
+                ++n;
+            }
+        }
+
+        ring->collected = i;		//复制满max条时停在最后复制的一条之后，剩下的留给下一次
+    }
+
+    pthread_mutex_unlock(&rec->lock);
+    return n;
+}
+
+int64_t recorder_total(recorder *rec)
+{
+    recorder_ring *ring;
+    int64_t total = 0;
+
+    for(ring = rec->rings; ring != NULL; ring = ring->next) {
+        total += ring->head;
+    }
+
+    return total;
+}
+
+int recorder_rings(recorder *rec)
+{
+    return rec->ring_num;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file recorder.h
+ * @brief 飞行记录器，在内存中保存最近的记录，需要时再输出
+ *
+ * 1.每个线程一个覆盖写的环，写入只访问本线程的环，不加锁，没有原子的读改写操作\n
+ * 2.每个槽位带序号锁(seqlock)，读者复制槽位后检查序号，丢弃正在被覆盖的槽位\n
+ * 3.线程第一次写入时分配环，线程退出时环被标记为空闲，保留的记录可以被读出，之后由新线程复用\n
+ * 4.记录器只保存定长的记录，不关心记录的内容\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+#include <stdint.h>
+
+typedef struct recorder_s recorder;
+
+/**
+ * @brief	recorder_create	创建记录器
+ *
+ * @param	records			每个线程保存的记录条数
+ * @param	element_len		每条记录的字节数
+ *
+ * @return	失败返回NULL
+ */
+recorder *recorder_create(int records, int element_len);
+/**
+ * @brief	recorder_destroy	释放记录器，调用者保证没有线程正在写入
+ */
+void recorder_destroy(void *rec);
+/**
+ * @brief	recorder_begin	取得本线程环中下一个槽位，覆盖最老的记录
+ *
+ * @return	槽位的记录，失败返回NULL
+ */
+void *recorder_begin(recorder *rec);
+/**
+ * @brief	recorder_end	写完recorder_begin返回的记录
+ */
+void recorder_end(void *p);
+/**
+ * @brief	recorder_capacity	所有环能保存的总条数
+ */
+int recorder_capacity(recorder *rec);
+/**
+ * @brief	recorder_collect	复制上次collect之后写入并且还没有被覆盖的记录
+ *
+ * @param	rec				记录器
+ * @param	out				输出数组
+ * @param	max				最多复制的条数
+ *
+ * @return	复制的条数
+ */
+int recorder_collect(recorder *rec, void *out, int max);
+/**
+ * @brief	recorder_total	写入的总条数
+ */
+int64_t recorder_total(recorder *rec);
+/**
+ * @brief	recorder_rings	分配的环的个数
+ */
+int recorder_rings(recorder *rec);
+
+#endif /* __RECORDER_H__ */
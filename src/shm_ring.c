@@ -0,0 +1,263 @@
+#include "shm_ring.h"
+#include "macro_helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_RING_MAGIC		0x534c4f47		/* "SLOG" */
+#define SHM_RING_VERSION	1
+#define CACHE_LINE			64
+
+struct shm_ring_head_s {
+    volatile uint32_t magic;		//最后写入，收集进程据此判断初始化完成
+    uint32_t version;
+    int32_t pid;
+    int32_t size;
+    int32_t element_size;
+    int32_t stride;
+    volatile int32_t closed;
+    volatile int32_t drop_count;
+    char pad0[CACHE_LINE - 32];
+    volatile uint64_t write_pos;	//生产者之间竞争
+    char pad1[CACHE_LINE - 8];
+    volatile uint64_t read_pos;		//只有收集进程修改
+    char pad2[CACHE_LINE - 8];
+};
+
+struct shm_ring_slot_s {
+    volatile uint64_t seq;		//等于pos+1表示已提交，等于pos+size表示已被读取可以重用
+    char data[0];
+};
+
+struct shm_ring_s {
+    struct shm_ring_head_s *head;
+    char *slots;
+    size_t map_len;
+    int owner;
+    char name[SHM_RING_NAME_LEN];
+};
+
+static inline struct shm_ring_slot_s *ring_slot(shm_ring *this, uint64_t pos)
+{
+    return (struct shm_ring_slot_s *)(this->slots + (pos & (this->head->size - 1)) * this->head->stride);
+}
+
+shm_ring *shm_ring_create(const char *name, int size, int element_size)
+{
+    if(name == NULL || size <= 0 || element_size <= 0) {
+        return NULL;
+    }
+
+    int n = 1, i;
+
+    while(n < size) {
+        n <<= 1;
+    }
+
+    int stride = (sizeof(struct shm_ring_slot_s) + element_size + 7) & ~7;
+    size_t len = sizeof(struct shm_ring_head_s) + (size_t)n * stride;
+    shm_ring *this = malloc_safe(shm_ring);
+
+    if(this == NULL) {
+        return NULL;
+    }
+
+    memset(this, 0, sizeof(shm_ring));
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0660);
+
+    if(fd < 0) {
+        fprintf(stderr, "shm_open %s failed: %s\n", name, strerror(errno));
+        free(this);
+        return NULL;
+    }
+
+    if(ftruncate(fd, len) != 0) {
+        fprintf(stderr, "ftruncate %s failed: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        free(this);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(p == MAP_FAILED) {
+        fprintf(stderr, "mmap %s failed: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        free(this);
+        return NULL;
+    }
+
+    this->head = p;
+    this->slots = (char *)p + sizeof(struct shm_ring_head_s);
+    this->map_len = len;
+    this->owner = 1;
+    snprintf(this->name, SHM_RING_NAME_LEN, "%s", name);
+    this->head->version = SHM_RING_VERSION;
+    this->head->pid = getpid();
+    this->head->size = n;
+    this->head->element_size = element_size;
+    this->head->stride = stride;
+
+    for(i = 0; i < n; i++) {
+        ring_slot(this, i)->seq = i;
+    }
+
+    __sync_synchronize();
+    this->head->magic = SHM_RING_MAGIC;
+    return this;
+}
+
+shm_ring *shm_ring_open(const char *name, int element_size)
+{
+    struct stat st;
+
+    if(name == NULL) {
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_RDWR, 0);
+
+    if(fd < 0) {
+        return NULL;
+    }
+
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct shm_ring_head_s)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(p == MAP_FAILED) {
+        return NULL;
+    }
+
+    struct shm_ring_head_s *head = p;
+    __sync_synchronize();
+
+    if(head->magic != SHM_RING_MAGIC || head->version != SHM_RING_VERSION
+       || head->element_size != element_size
+       || sizeof(struct shm_ring_head_s) + (size_t)head->size * head->stride > (size_t)st.st_size) {
+        munmap(p, st.st_size);
+        return NULL;
+    }
+
+    shm_ring *this = malloc_safe(shm_ring);
+
+    if(this == NULL) {
+        munmap(p, st.st_size);
+        return NULL;
+    }
+
+    memset(this, 0, sizeof(shm_ring));
+    this->head = head;
+    this->slots = (char *)p + sizeof(struct shm_ring_head_s);
+    this->map_len = st.st_size;
+    this->owner = 0;
+    snprintf(this->name, SHM_RING_NAME_LEN, "%s", name);
+    return this;
+}
+
+void shm_ring_close(shm_ring *this, int remove)
+{
+    if(this == NULL) {
+        return;
+    }
+
+    if(this->owner) {
+        __sync_synchronize();
+        this->head->closed = 1;
+    }
+
+    munmap(this->head, this->map_len);
+
+    if(remove) {
+        shm_unlink(this->name);
+    }
+
+    free_safe(this);
+}
+
+int shm_ring_push(shm_ring *this, const void *data)
+{
+    struct shm_ring_head_s *head = this->head;
+    struct shm_ring_slot_s *slot;
+    uint64_t pos = head->write_pos;
+
+    while(1) {
+        slot = ring_slot(this, pos);
+        int64_t dif = (int64_t)(slot->seq - pos);
+
+        if(dif == 0) {
+            if(__sync_bool_compare_and_swap(&head->write_pos, pos, pos + 1)) {
+                break;
+            }
+
+            pos = head->write_pos;
+        } else if(dif < 0) {
+            __sync_fetch_and_add(&head->drop_count, 1);
+            return -1;
+        } else {
+            pos = head->write_pos;
+        }
+    }
+
+    memcpy(slot->data, data, head->element_size);
+    __sync_synchronize();
+    slot->seq = pos + 1;
+    return 0;
+}
+
+void *shm_ring_peek(shm_ring *this)
+{
+    uint64_t pos = this->head->read_pos;
+    struct shm_ring_slot_s *slot = ring_slot(this, pos);
+
+    if(slot->seq != pos + 1) {
+        return NULL;
+    }
+
+    __sync_synchronize();
+    return slot->data;
+}
+
+void shm_ring_pop(shm_ring *this)
+{
+    uint64_t pos = this->head->read_pos;
+    struct shm_ring_slot_s *slot = ring_slot(this, pos);
+    __sync_synchronize();
+    slot->seq = pos + this->head->size;
+    this->head->read_pos = pos + 1;
+}
+
+int shm_ring_is_alive(shm_ring *this)
+{
+    if(this->head->closed) {
+        return 0;
+    }
+
+    if(kill(this->head->pid, 0) != 0 && errno == ESRCH) {
+        return 0;
+    }
+
+    return 1;
+}
+
+int shm_ring_drop_count(shm_ring *this)
+{
+    return this->head->drop_count;
+}
+
+const char *shm_ring_name(shm_ring *this)
+{
+    return this->name;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file shm_ring.h
+ * @brief 进程间共享内存环形队列
+ *
+ * 1.每个生产者进程创建一个独立的环(/dev/shm/simplelog-<name>.<pid>)，进程内多线程无锁写入\n
+ * 2.环由唯一的收集进程(simplelog-collectd)读取，收集进程负责在生产者退出并且环读空后删除共享内存\n
+ * 3.环满时直接丢弃并计数，生产者不会因为收集进程阻塞\n
+ * 4.槽位使用序号标记写入完成，收集进程只读取已经提交的槽位\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SHM_RING_PREFIX		"simplelog-"
+#define SHM_RING_NAME_LEN	256
+
+typedef struct shm_ring_s shm_ring;
+
+/**
+ * @brief	shm_ring_create		生产者创建共享内存环
+ *
+ * @param	name				共享内存名字(shm_open使用的名字,以/开头)
+ * @param	size				槽位数，向上取整为2的幂
+ * @param	element_size		每个槽位的数据大小
+ *
+ * @return	成功返回环对象，失败返回NULL
+ */
+shm_ring *shm_ring_create(const char *name, int size, int element_size);
+/**
+ * @brief	shm_ring_open		收集进程打开已经存在的共享内存环
+ *
+ * @param	name				共享内存名字
+ * @param	element_size		期望的槽位数据大小，不一致时打开失败
+ *
+ * @return	成功返回环对象，失败返回NULL
+ */
+shm_ring *shm_ring_open(const char *name, int element_size);
+/**
+ * @brief	shm_ring_close		解除映射，生产者关闭时同时标记环已关闭
+ *
+ * @param	this				环对象
+ * @param	remove				是否删除共享内存
+ */
+void shm_ring_close(shm_ring *this, int remove);
+/**
+ * @brief	shm_ring_push		写入一个元素(多线程安全)
+ *
+ * @return	成功返回0，环满返回-1
+ */
+int shm_ring_push(shm_ring *this, const void *data);
+/**
+ * @brief	shm_ring_peek		取得队首元素但不出队(只允许一个读者)
+ *
+ * @return	队首元素指针，环空返回NULL
+ */
+void *shm_ring_peek(shm_ring *this);
+/**
+ * @brief	shm_ring_pop		释放shm_ring_peek取得的队首元素
+ */
+void shm_ring_pop(shm_ring *this);
+/**
+ * @brief	shm_ring_is_alive	生产者是否仍然存活并且没有关闭环
+ */
+int shm_ring_is_alive(shm_ring *this);
+/**
+ * @brief	shm_ring_drop_count	由于环满丢弃的元素数
+ */
+int shm_ring_drop_count(shm_ring *this);
+/**
+ * @brief	shm_ring_name		共享内存名字
+ */
+const char *shm_ring_name(shm_ring *this);
+
+#endif /* __SHM_RING_H__ */
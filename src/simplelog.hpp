@@ -0,0 +1,491 @@
+/**
+ * @file simplelog.hpp
+ * @brief 日志库的C++接口(只有头文件)
+ *
+ * 1.simplelog::logger使用RAII管理log_create/log_destroy\n
+ * 2.参数按静态类型序列化到日志记录中(log_write_args)，调用点不经过va_list和vsnprintf，格式化由调度线程完成\n
+ * 3.C++20下格式串在编译期检查，参数个数或者类型与格式串不匹配时编译失败\n
+ * 4.C++14/17下使用SIMPLELOG_INFO等宏得到同样的编译期检查，直接调用成员函数时不检查\n
+ * 5.格式串必须是字符串常量，长度修饰符(l,ll,h等)可以省略，按参数的实际类型输出\n
+ *
+ *	simplelog::logger log;
+ *	log.set_file("test.log", "debug.log");
+ *	log.dispatch();
+ *	log.info("user %s login, uid=%d", name, uid);
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __SIMPLELOG_HPP__
+#define __SIMPLELOG_HPP__
+
+#if __cplusplus < 201402L
+#error "simplelog.hpp requires C++14 or later"
+#endif
+
+#include "log.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#if __cplusplus >= 202002L
+#define SIMPLELOG_CONSTEVAL consteval
+#else
+#define SIMPLELOG_CONSTEVAL constexpr
+#endif
+
+namespace simplelog
+{
+namespace detail
+{
+
+enum arg_kind { kind_sint, kind_uint, kind_char, kind_bool, kind_double, kind_str, kind_ptr };
+enum format_error { format_ok = 0, format_bad_conversion, format_too_few_args, format_too_many_args, format_type_mismatch };
+
+/**
+ * 参数类型到日志字段的映射，没有特化的类型不能作为日志参数
+ */
+template<class T, class Enable = void> struct arg_traits;
+
+template<class T> struct arg_traits < T, typename std::enable_if < (std::is_integral<T>::value &&std::is_signed<T>::value
+&& !std::is_same<T, char>::value) || std::is_enum<T>::value >::type > {
+    static constexpr arg_kind kind = kind_sint;
+    static log_field make(const T &v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_INT;
+        f.value.i = static_cast<int64_t>(v);
+        return f;
+    }
+};
+
+template<class T> struct arg_traits < T, typename std::enable_if < std::is_integral<T>::value &&std::is_unsigned<T>::value
+&& !std::is_same<T, bool>::value && !std::is_same<T, char>::value >::type > {
+    static constexpr arg_kind kind = kind_uint;
+    static log_field make(const T &v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_UINT;
+        f.value.u = static_cast<uint64_t>(v);
+        return f;
+    }
+};
+
+template<> struct arg_traits<char> {
+    static constexpr arg_kind kind = kind_char;
+    static log_field make(char v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_INT;
+        f.value.i = v;
+        return f;
+    }
+};
+
+template<> struct arg_traits<bool> {
+    static constexpr arg_kind kind = kind_bool;
+    static log_field make(bool v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_INT;
+        f.value.i = v ? 1 : 0;
+        return f;
+    }
+};
+
+template<class T> struct arg_traits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static constexpr arg_kind kind = kind_double;
+    static log_field make(const T &v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_DOUBLE;
+        f.value.d = static_cast<double>(v);
+        return f;
+    }
+};
+
+template<class T> struct arg_traits < T, typename std::enable_if < std::is_same<T, const char *>::value || std::is_same<T, char *>::value >::type > {
+    static constexpr arg_kind kind = kind_str;
+    static log_field make(const char *v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_STR;
+        f.value.s = v != nullptr ? v : "(null)";
+        return f;
+    }
+};
+
+template<> struct arg_traits<std::string> {
+    static constexpr arg_kind kind = kind_str;
+    static log_field make(const std::string &v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_STR;
+        f.value.s = v.c_str();
+        return f;
+    }
+};
+
+template<class T> struct arg_traits < T, typename std::enable_if < (std::is_pointer<T>::value
+&& !std::is_same<T, const char *>::value && !std::is_same<T, char *>::value) || std::is_null_pointer<T>::value >::type > {
+    static constexpr arg_kind kind = kind_ptr;
+    static log_field make(const T &v)
+    {
+        log_field f = log_field();
+        f.type = LOG_FIELD_UINT;
+        f.value.u = reinterpret_cast<uintptr_t>(static_cast<const volatile void *>(v));
+        return f;
+    }
+};
+
+template<class T> using arg_of = arg_traits<typename std::decay<T>::type>;
+
+constexpr bool accepts(char conv, arg_kind kind)
+{
+    switch(conv) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            return kind == kind_sint || kind == kind_uint || kind == kind_char || kind == kind_bool;
+        case 'c':
+            return kind == kind_char || kind == kind_sint || kind == kind_uint;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            return kind == kind_double;
+        case 's':
+            return kind == kind_str;
+        case 'p':
+            return kind == kind_ptr;		//字符串按值复制，没有地址，需要输出地址时转换为void *
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief	check_format	检查格式串和参数类型是否匹配，语法和kv_format一致('*'宽度不支持)
+ */
+constexpr int check_format(const char *f, const arg_kind *kinds, std::size_t num)
+{
+    std::size_t index = 0;
+
+    while(*f != '\0') {
+        if(*f++ != '%') {
+            continue;
+        }
+
+        if(*f == '%') {
+            ++f;
+            continue;
+        }
+
+        while(*f == '-' || *f == '+' || *f == ' ' || *f == '#' || *f == '0') {
+            ++f;
+        }
+
+        while((*f >= '0' && *f <= '9') || *f == '.') {
+            ++f;
+        }
+
+        while(*f == 'h' || *f == 'l' || *f == 'L' || *f == 'q' || *f == 'j' || *f == 'z' || *f == 't') {
+            ++f;
+        }
+
+        char conv = *f;
+
+        if(conv == '\0' || conv == '*') {
+            return format_bad_conversion;
+        }
+
+        ++f;
+
+        if(index >= num) {
+            return format_too_few_args;
+        }
+
+        if(!accepts(conv, kinds[index])) {
+            return conv == 'd' || conv == 'i' || conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o' || conv == 'c'
+                   || conv == 'e' || conv == 'E' || conv == 'f' || conv == 'F' || conv == 'g' || conv == 'G'
+                   || conv == 'a' || conv == 'A' || conv == 's' || conv == 'p' ? format_type_mismatch : format_bad_conversion;
+        }
+
+        ++index;
+    }
+
+    return index == num ? format_ok : format_too_many_args;
+}
+
+/**
+ * 编译期检查失败时调用这些非constexpr函数，编译错误信息中会出现函数名
+ */
+inline void format_string_has_bad_conversion() {}
+inline void format_string_needs_more_arguments() {}
+inline void format_string_has_too_many_arguments() {}
+inline void format_argument_type_mismatch() {}
+
+constexpr void report(int error)
+{
+    if(error == format_bad_conversion) {
+        format_string_has_bad_conversion();
+    } else if(error == format_too_few_args) {
+        format_string_needs_more_arguments();
+    } else if(error == format_too_many_args) {
+        format_string_has_too_many_arguments();
+    } else if(error == format_type_mismatch) {
+        format_argument_type_mismatch();
+    }
+}
+
+template<class... Args> struct kind_list {};
+
+template<class... Args> kind_list<typename std::decay<Args>::type...> kind_list_of(const Args &...);
+
+template<class... Args>
+constexpr int check_list(const char *fmt, kind_list<Args...>)
+{
+    const arg_kind kinds[] = {arg_traits<Args>::kind..., kind_sint};
+    return check_format(fmt, kinds, sizeof...(Args));
+}
+
+template<int Error> struct static_check {
+    static_assert(Error != format_bad_conversion, "simplelog: unsupported conversion in format string");
+    static_assert(Error != format_too_few_args, "simplelog: format string needs more arguments");
+    static_assert(Error != format_too_many_args, "simplelog: too many arguments for format string");
+    static_assert(Error != format_type_mismatch, "simplelog: argument type does not match conversion");
+};
+
+template<class T> struct identity {
+    typedef T type;
+};
+
+} /* namespace detail */
+
+/**
+ * @brief	format	带参数类型信息的格式串，C++20下在构造时(编译期)检查
+ */
+template<class... Args>
+class format
+{
+public:
+    template<std::size_t N>
+    SIMPLELOG_CONSTEVAL format(const char (&str)[N]) : str_(str)
+    {
+        const detail::arg_kind kinds[] = {detail::arg_traits<Args>::kind..., detail::kind_sint};
+        detail::report(detail::check_format(str, kinds, sizeof...(Args)));
+    }
+
+    const char *c_str() const
+    {
+        return str_;
+    }
+
+private:
+    const char *str_;
+};
+
+template<class... Args> using format_for = format<typename std::decay<typename detail::identity<Args>::type>::type...>;
+
+/**
+ * @brief	logger	log_t的RAII封装，不可复制，可以移动
+ */
+class logger
+{
+public:
+    logger() : log_(log_create())
+    {
+        if(log_ != nullptr && log_init(log_) == LOG_FALSE) {
+            log_destroy(log_);
+            log_ = nullptr;
+        }
+    }
+
+    /**
+     * @brief	接管已经创建并初始化的日志对象
+     */
+    explicit logger(log_t *log) : log_(log) {}
+
+    logger(logger &&other) noexcept : log_(other.log_)
+    {
+        other.log_ = nullptr;
+    }
+
+    logger &operator=(logger &&other) noexcept
+    {
+        if(this != &other) {
+            reset();
+            log_ = other.log_;
+            other.log_ = nullptr;
+        }
+
+        return *this;
+    }
+
+    logger(const logger &) = delete;
+    logger &operator=(const logger &) = delete;
+
+    ~logger()
+    {
+        reset();
+    }
+
+    log_t *get() const
+    {
+        return log_;
+    }
+
+    explicit operator bool() const
+    {
+        return log_ != nullptr;
+    }
+
+    void reset()
+    {
+        if(log_ != nullptr) {
+            log_destroy(log_);
+            log_ = nullptr;
+        }
+    }
+
+    bool set_file(const char *log_file, const char *debug_file = nullptr)
+    {
+        return log_set_file(log_, const_cast<char *>(log_file), const_cast<char *>(debug_file)) == LOG_TRUE;
+    }
+
+    bool set_socket(const char *ip, const char *port = LOG_SOCKET_PORT_DEFAULT, sock_type type = TCP)
+    {
+        return log_set_socket(log_, const_cast<char *>(ip), const_cast<char *>(port), type) == LOG_TRUE;
+    }
+
+    bool set_format(log_mode mode, log_format fmt)
+    {
+        return log_set_format(log_, mode, fmt) == LOG_TRUE;
+    }
+
+    bool set_pattern(log_mode mode, const char *pattern)
+    {
+        return log_set_pattern(log_, mode, pattern) == LOG_TRUE;
+    }
+
+    bool set_escape(log_mode mode, log_escape escape)
+    {
+        return log_set_escape(log_, mode, escape) == LOG_TRUE;
+    }
+
+    bool dispatch(dispatch_type type = DISPATCH_UNBLOCK)
+    {
+        return log_dispatch(log_, type) == LOG_TRUE;
+    }
+
+    int poll_fd()
+    {
+        return log_poll_fd(log_);
+    }
+
+    int poll(int budget = 0)
+    {
+        return log_poll(log_, budget);
+    }
+
+    void enable()
+    {
+        log_enable(log_);
+    }
+
+    void disable()
+    {
+        log_disable(log_);
+    }
+
+    void stop()
+    {
+        log_stop(log_);
+    }
+
+    void print_status(FILE *stream) const
+    {
+        log_print_status(log_, stream);
+    }
+
+    template<class... Args>
+    bool write(log_mode mode, log_level level, const char *category, format_for<Args...> fmt, const Args &... args)
+    {
+        const log_field fields[] = {detail::arg_of<Args>::make(args)..., log_field()};
+        return log_write_args(log_, mode, level, const_cast<char *>(category), fmt.c_str(), fields, sizeof...(Args)) == LOG_TRUE;
+    }
+
+    /**
+     * @brief	write	带调用点的写入，日志级别取自调用点，一般通过SIMPLELOG_*宏调用
+     */
+    template<class... Args>
+    bool write(log_site *site, log_mode mode, const char *category, format_for<Args...> fmt, const Args &... args)
+    {
+        const log_field fields[] = {detail::arg_of<Args>::make(args)..., log_field()};
+        return log_write_args_site(log_, site, mode, const_cast<char *>(category), fmt.c_str(), fields, sizeof...(Args)) == LOG_TRUE;
+    }
+
+    template<class... Args>
+    bool fatal(format_for<Args...> fmt, const Args &... args)
+    {
+        return write(TO_CONSOLE_AND_FILE, FATAL, nullptr, fmt, args...);
+    }
+
+    template<class... Args>
+    bool error(format_for<Args...> fmt, const Args &... args)
+    {
+        return write(TO_CONSOLE_AND_FILE, ERROR, nullptr, fmt, args...);
+    }
+
+    template<class... Args>
+    bool info(format_for<Args...> fmt, const Args &... args)
+    {
+        return write(TO_CONSOLE_AND_FILE, INFO, nullptr, fmt, args...);
+    }
+
+    /**
+     * @brief	debug	没有定义ENABLE_DEBUG时不输出(参数仍然会被求值)
+     */
+    template<class... Args>
+    bool debug(format_for<Args...> fmt, const Args &... args)
+    {
+#ifdef ENABLE_DEBUG
+        return write(TO_CONSOLE_AND_FILE, DEBUG, nullptr, fmt, args...);
+#else
+        return true;
+#endif
+    }
+
+private:
+    log_t *log_;
+};
+
+} /* namespace simplelog */
+
+/**
+ *	@brief	C++14/17下带编译期格式检查的写入宏，C++20下的检查与直接调用成员函数相同
+ *
+ *	每个调用点定义一个静态的log_site(LOG_SITE)，调试信息显示调用者的位置，level必须是常量
+ */
+#define SIMPLELOG_WRITE(lg, mode, level, fmt, ...) \
+    ((void)sizeof(::simplelog::detail::static_check<::simplelog::detail::check_list(fmt, decltype(::simplelog::detail::kind_list_of(__VA_ARGS__))())>), \
+     (lg).write(LOG_SITE(level), mode, nullptr, fmt, ##__VA_ARGS__))
+
+#define SIMPLELOG_FATAL(lg, fmt, ...) SIMPLELOG_WRITE(lg, TO_CONSOLE_AND_FILE, FATAL, fmt, ##__VA_ARGS__)
+#define SIMPLELOG_ERROR(lg, fmt, ...) SIMPLELOG_WRITE(lg, TO_CONSOLE_AND_FILE, ERROR, fmt, ##__VA_ARGS__)
+#define SIMPLELOG_INFO(lg, fmt, ...) SIMPLELOG_WRITE(lg, TO_CONSOLE_AND_FILE, INFO, fmt, ##__VA_ARGS__)
+#ifdef ENABLE_DEBUG
+#define SIMPLELOG_DEBUG(lg, fmt, ...) SIMPLELOG_WRITE(lg, TO_CONSOLE_AND_FILE, DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define SIMPLELOG_DEBUG(lg, fmt, ...) ((void)0)
+#endif
+
+#endif /* __SIMPLELOG_HPP__ */
@@ -0,0 +1,976 @@
+#define _GNU_SOURCE
+#include "sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <time.h>
+#include <limits.h>
+
+#define UNIX_PENDING_LEN		262144			//unix socket发送不出去时缓存的字节数
+#define UNIX_RETRY_INTERVAL		1000000000LL	//unix socket断开后重连的间隔(纳秒)
+
+/**
+ * @brief	文件的时间索引，在文件的锁内修改
+ */
+typedef struct sink_index_s {
+    int fd;
+    int records;				//每多少条生成一项，0表示不按条数
+    int bytes;					//每多少字节生成一项，0表示不按字节数
+    log_index_entry cur;		//正在累积的一段
+} sink_index;
+
+static sink_ref *file_sinks = NULL;		//所有日志对象打开的文件，同一个文件只打开一次
+static pthread_mutex_t file_sinks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief	write_all	写完所有iovec，处理部分写入和EINTR
+ *
+ * @return	成功返回0，失败返回-1
+ */
+static int write_all(int fd, struct iovec *iov, int cnt, int sock)
+{
+    struct msghdr msg;
+    ssize_t n;
+
+    while(cnt > 0) {
+        if(sock) {		//socket对端关闭时不产生SIGPIPE
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = cnt;
+            n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        } else {
+            n = writev(fd, iov, cnt);
+        }
+
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        while(cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+
+        if(cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return 0;
+}
+
+static int console_write(void *ctx, const log_line *lines, int num)
+{
+    struct iovec iov[LOG_SINK_BATCH];
+    int n, done;
+
+    for(done = 0; done < num; done += n) {
+        for(n = 0; n < LOG_SINK_BATCH && done + n < num; n++) {
+            iov[n].iov_base = (void *)lines[done + n].data;
+            iov[n].iov_len = lines[done + n].len;
+        }
+
+        if(write_all(((sink_ref *)ctx)->fd, iov, n, 0) != 0) {
+            return -1;
+        }
+    }
+
+    return num;
+}
+
+/**
+ * @brief	index_emit	写出正在累积的一段
+ */
+static void index_emit(sink_index *idx)
+{
+    if(idx->cur.records == 0) {
+        return;
+    }
+
+    idx->cur.magic = LOG_INDEX_MAGIC;
+
+    while(write(idx->fd, &idx->cur, sizeof(log_index_entry)) < 0 && errno == EINTR);
+
+    memset(&idx->cur, 0, sizeof(log_index_entry));
+}
+
+/**
+ * @brief	index_add	把刚写入的日志加入索引
+ *
+ * @param	idx			索引
+ * @param	end			写入之后文件的偏移
+ * @param	lines		写入的日志
+ * @param	cnt			条数
+ */
+static void index_add(sink_index *idx, off_t end, const log_line **lines, int cnt)
+{
+    log_index_entry *e = &idx->cur;
+    uint64_t off = end;
+    int i;
+
+    for(i = 0; i < cnt; i++) {
+        off -= lines[i]->len;
+    }
+
+    for(i = 0; i < cnt; off += lines[i]->len, i++) {
+        if(e->records == 0) {
+            e->offset = off;
+            e->min_us = lines[i]->time_us;
+            e->max_us = lines[i]->time_us;
+        }
+
+        e->min_us = lines[i]->time_us < e->min_us ? lines[i]->time_us : e->min_us;
+        e->max_us = lines[i]->time_us > e->max_us ? lines[i]->time_us : e->max_us;
+        e->levels |= 1U << lines[i]->level;
+        e->length = off + lines[i]->len - e->offset;
+        ++e->records;
+
+        if((idx->records > 0 && (int)e->records >= idx->records) || (idx->bytes > 0 && (int)e->length >= idx->bytes)) {
+            index_emit(idx);
+        }
+    }
+}
+
+static void index_close(sink_index *idx)
+{
+    if(idx != NULL) {
+        index_emit(idx);
+        close(idx->fd);
+        free(idx);
+    }
+}
+
+/**
+ * @brief	file_append	写入一组日志，文件开启了索引时在文件的锁内写入并更新索引
+ */
+static int file_append(sink_ref *file, int fd, struct iovec *iov, const log_line **lines, int cnt)
+{
+    off_t end;
+    int ret;
+
+    if(file == NULL || file->index == NULL) {
+        return write_all(fd, iov, cnt, 0);
+    }
+
+    pthread_mutex_lock(&file->lock);
+
+    if((ret = write_all(fd, iov, cnt, 0)) == 0 && file->index != NULL && (end = lseek(fd, 0, SEEK_CUR)) >= 0) {
+        index_add(file->index, end, lines, cnt);
+    }
+
+    pthread_mutex_unlock(&file->lock);
+    return ret;
+}
+
+/**
+ * @brief	file_write	DEBUG级别写入调试文件，其他写入日志文件，没有设置时写入stderr
+ */
+static int file_write(void *ctx, const log_line *lines, int num)
+{
+    sink_ref *route = ctx;
+    struct iovec iov[2][LOG_SINK_BATCH];
+    const log_line *meta[2][LOG_SINK_BATCH];
+    int fd[2], cnt[2] = {0, 0};
+    int i, k, ret = num;
+
+    fd[0] = route->sub[0] != NULL ? route->sub[0]->fd : STDERR_FILENO;
+    fd[1] = route->sub[1] != NULL ? route->sub[1]->fd : STDERR_FILENO;
+
+    for(i = 0; i < num; i++) {
+        k = (lines[i].level >= DEBUG && fd[1] != fd[0]) ? 1 : 0;	//同一个描述符时保持顺序
+
+        if(cnt[k] == LOG_SINK_BATCH) {
+            if(file_append(route->sub[k], fd[k], iov[k], meta[k], cnt[k]) != 0) {
+                ret = -1;
+            }
+
+            cnt[k] = 0;
+        }
+
+        iov[k][cnt[k]].iov_base = (void *)lines[i].data;
+        iov[k][cnt[k]].iov_len = lines[i].len;
+        meta[k][cnt[k]] = &lines[i];
+        ++cnt[k];
+    }
+
+    for(k = 0; k < 2; k++) {
+        if(cnt[k] > 0 && file_append(route->sub[k], fd[k], iov[k], meta[k], cnt[k]) != 0) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief	socket_write	流式socket一次发送整批，数据报socket每条日志一个数据报
+ */
+static int socket_write(void *ctx, const log_line *lines, int num)
+{
+    sink_ref *s = ctx;
+    struct iovec iov[LOG_SINK_BATCH];
+    struct mmsghdr msgs[LOG_SINK_BATCH];
+    int i, n, done, sent;
+
+    for(done = 0; done < num; done += n) {
+        for(n = 0; n < LOG_SINK_BATCH && done + n < num; n++) {
+            iov[n].iov_base = (void *)lines[done + n].data;
+            iov[n].iov_len = lines[done + n].len;
+        }
+
+        if(s->sock_type != SOCK_DGRAM) {
+            if(write_all(s->fd, iov, n, 1) != 0) {
+                return -1;
+            }
+
+            continue;
+        }
+
+        memset(msgs, 0, n * sizeof(struct mmsghdr));
+
+        for(i = 0; i < n; i++) {
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        for(i = 0; i < n; i += sent) {
+            if((sent = sendmmsg(s->fd, msgs + i, n - i, MSG_NOSIGNAL)) <= 0) {
+                if(sent < 0 && errno == EINTR) {
+                    sent = 0;
+                    continue;
+                }
+
+                return -1;
+            }
+        }
+    }
+
+    return num;
+}
+
+static const log_sink_ops console_ops = {"console", NULL, console_write, NULL, NULL, NULL};
+static const log_sink_ops file_ops = {"file", NULL, file_write, NULL, NULL, NULL};
+static const log_sink_ops socket_ops = {"socket", NULL, socket_write, NULL, NULL, NULL};
+
+sink_ref *sink_new(const log_sink_ops *ops, void *ctx)
+{
+    sink_ref *s = malloc(sizeof(sink_ref));
+
+    if(s == NULL) {
+        return NULL;
+    }
+
+    memset(s, 0, sizeof(sink_ref));
+    s->ref = 1;
+    s->ops = ops;
+    s->ctx = ctx;
+    s->fd = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    return s;
+}
+
+void sink_get(sink_ref *s)
+{
+    if(s != NULL) {
+        __sync_add_and_fetch(&s->ref, 1);
+    }
+}
+
+void sink_put(sink_ref *s)
+{
+    sink_ref **pp;
+
+    if(s == NULL) {
+        return;
+    }
+
+    if(s->ino != 0) {		//在全局表中的文件，查找和释放需要互斥，避免找到正在关闭的文件
+        pthread_mutex_lock(&file_sinks_lock);
+
+        if(__sync_sub_and_fetch(&s->ref, 1) != 0) {
+            pthread_mutex_unlock(&file_sinks_lock);
+            return;
+        }
+
+        for(pp = &file_sinks; *pp != NULL; pp = &(*pp)->next) {
+            if(*pp == s) {
+                *pp = s->next;
+                break;
+            }
+        }
+
+        pthread_mutex_unlock(&file_sinks_lock);
+    } else if(__sync_sub_and_fetch(&s->ref, 1) != 0) {
+        return;
+    }
+
+    if(s->ops != NULL && s->ops->close != NULL) {
+        s->ops->close(s->ctx);
+    }
+
+    sink_put(s->sub[0]);
+    sink_put(s->sub[1]);
+    index_close(s->index);
+    free(s->path);
+
+    if(s->fd >= 0) {
+        close(s->fd);
+    }
+
+    if(s->shm != NULL) {
+        shm_ring_close(s->shm, 0);
+    }
+
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+sink_ref *sink_console(void)
+{
+    static sink_ref console = {1, &console_ops, &console, PTHREAD_MUTEX_INITIALIZER, STDERR_FILENO};
+    sink_get(&console);		//全局的引用永远不释放
+    return &console;
+}
+
+sink_ref *sink_file_open(const char *path)
+{
+    sink_ref *s;
+    struct stat st;
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+
+    if(fd < 0) {
+        return NULL;
+    }
+
+    if(fstat(fd, &st) != 0 || st.st_ino == 0) {
+        if((s = sink_new(NULL, NULL)) == NULL) {
+            close(fd);
+        } else {
+            s->fd = fd;
+        }
+
+        return s;
+    }
+
+    pthread_mutex_lock(&file_sinks_lock);
+
+    for(s = file_sinks; s != NULL; s = s->next) {	//其他日志对象已经打开了同一个文件时共享
+        if(s->dev == st.st_dev && s->ino == st.st_ino) {
+            sink_get(s);
+            pthread_mutex_unlock(&file_sinks_lock);
+            close(fd);
+            return s;
+        }
+    }
+
+    if((s = sink_new(NULL, NULL)) != NULL) {
+        s->fd = fd;
+        s->path = strdup(path);
+        s->dev = st.st_dev;
+        s->ino = st.st_ino;
+        s->next = file_sinks;
+        file_sinks = s;
+    } else {
+        close(fd);
+    }
+
+    pthread_mutex_unlock(&file_sinks_lock);
+    return s;
+}
+
+int sink_file_index(sink_ref *s, int records, int bytes)
+{
+    char name[PATH_MAX];
+    log_index_entry last;
+    struct stat st;
+    sink_index *idx;
+    off_t size;
+
+    if(s == NULL || s->fd < 0 || s->path == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&s->lock);
+
+    if(records <= 0 && bytes <= 0) {
+        index_close(s->index);
+        s->index = NULL;
+        pthread_mutex_unlock(&s->lock);
+        return 0;
+    }
+
+    if(s->index == NULL) {
+        if((idx = calloc(1, sizeof(sink_index))) == NULL || snprintf(name, sizeof(name), "%s.idx", s->path) >= (int)sizeof(name)
+           || (idx->fd = open(name, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+            pthread_mutex_unlock(&s->lock);
+            free(idx);
+            return -1;
+        }
+
+        size = lseek(idx->fd, 0, SEEK_END);
+        size -= size % sizeof(log_index_entry);		//去掉写了一半的项
+
+        if(size > 0 && (pread(idx->fd, &last, sizeof(last), size - sizeof(last)) != sizeof(last) || fstat(s->fd, &st) != 0
+                        || last.magic != LOG_INDEX_MAGIC || (off_t)(last.offset + last.length) > st.st_size)) {
+            size = 0;		//索引和文件不一致
+        }
+
+        if(ftruncate(idx->fd, size) != 0) {
+            fprintf(stderr, "truncate %s failed\n", name);
+        }
+
+        s->index = idx;
+    }
+
+    s->index->records = records;
+    s->index->bytes = bytes;
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+sink_ref *sink_file_route(sink_ref *file, sink_ref *debug)
+{
+    sink_ref *s = sink_new(&file_ops, NULL);
+
+    if(s == NULL) {
+        sink_put(file);
+        sink_put(debug);
+        return NULL;
+    }
+
+    s->ctx = s;
+    s->sub[0] = file;
+    s->sub[1] = debug;
+    return s;
+}
+
+sink_ref *sink_socket(int sock)
+{
+    sink_ref *s = sink_new(&socket_ops, NULL);
+    socklen_t len = sizeof(int);
+
+    if(s == NULL) {
+        close(sock);
+        return NULL;
+    }
+
+    s->ctx = s;
+    s->fd = sock;
+
+    if(getsockopt(sock, SOL_SOCKET, SO_TYPE, &s->sock_type, &len) != 0) {
+        s->sock_type = SOCK_STREAM;
+    }
+
+    return s;
+}
+
+sink_ref *sink_shm(shm_ring *ring)
+{
+    sink_ref *s = sink_new(NULL, NULL);
+
+    if(s == NULL) {
+        return NULL;
+    }
+
+    s->shm = ring;
+    return s;
+}
+
+int sink_write(sink_ref *s, const log_line *lines, int num)
+{
+    int i, ret, err = 0;
+
+    if(s == NULL || s->ops == NULL || num <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    ret = s->ops->write_batch(s->ctx, lines, num);
+
+    if(ret < 0) {
+        err = errno;
+        ++s->errors;
+    } else {
+        s->lines += ret;
+        ++s->batches;
+
+        for(i = 0; i < ret && i < num; i++) {
+            s->bytes += lines[i].len;
+        }
+    }
+
+    pthread_mutex_unlock(&s->lock);
+
+    if(ret < 0) {
+        errno = err;	//保留设备设置的errno(例如EAGAIN)
+    }
+
+    return ret;
+}
+
+int sink_flush(sink_ref *s)
+{
+    int ret = 0, err = 0;
+
+    if(s != NULL && s->ops != NULL && s->ops->flush != NULL) {
+        pthread_mutex_lock(&s->lock);
+
+        if((ret = s->ops->flush(s->ctx)) < 0) {
+            err = errno;
+        }
+
+        pthread_mutex_unlock(&s->lock);
+
+        if(ret < 0) {
+            errno = err;
+        }
+    }
+
+    return ret;
+}
+
+void sink_print(sink_ref *s, int id, FILE *stream)
+{
+    if(s == NULL || s->ops == NULL) {
+        return;
+    }
+
+    fprintf(stream, "\tsink%d=%s lines=%ld bytes=%ld batches=%ld errors=%ld\n", id, s->ops->name != NULL ? s->ops->name : "",
+            s->lines, s->bytes, s->batches, s->errors);
+
+    if(s->ops->stats != NULL) {
+        s->ops->stats(s->ctx, stream);
+    }
+}
+
+///////////////////////////unix socket///////////////////////////
+typedef struct unix_sink_s {
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    int type;
+    int fd;						//-1表示没有连接
+    char *pending;				//发送不出去的帧，帧头是长度和条数，每帧是一批完整的日志
+    int pending_len;
+    int sent;					//第一帧已经发送的字节数，只有流式socket会部分发送
+    int64_t retry_time;
+    int64_t drops;
+    int64_t reconnects;
+} unix_sink;
+
+static inline int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int unix_connect(unix_sink *u)
+{
+    int fd = socket(AF_UNIX, u->type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    if(connect(fd, (struct sockaddr *)&u->addr, u->addr_len) != 0) {	//本机连接立即完成，EAGAIN表示对端的队列满
+        close(fd);
+        return -1;
+    }
+
+    u->fd = fd;
+    return 0;
+}
+
+/**
+ * @brief	unix_reset	连接断开，已经发送了一部分的帧只能丢弃，否则对端收到的记录不完整
+ */
+static void unix_reset(unix_sink *u)
+{
+    uint32_t head[2];
+    int len;
+
+    close(u->fd);
+    u->fd = -1;
+    u->retry_time = mono_ns() + UNIX_RETRY_INTERVAL;
+
+    if(u->sent > 0) {
+        memcpy(head, u->pending, sizeof(head));
+        len = sizeof(head) + head[0];
+        memmove(u->pending, u->pending + len, u->pending_len - len);
+        u->pending_len -= len;
+        u->drops += head[1];
+        u->sent = 0;
+    }
+}
+
+/**
+ * @brief	unix_drain	按顺序发送缓存的帧
+ *
+ * @return	全部发送返回0
+ */
+static int unix_drain(unix_sink *u)
+{
+    uint32_t head[2];
+    int n, off = 0, broken = 0;
+
+    while(off < u->pending_len) {
+        memcpy(head, u->pending + off, sizeof(head));
+        n = send(u->fd, u->pending + off + sizeof(head) + u->sent, head[0] - u->sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            if(errno == EMSGSIZE) {		//和unix_send一样丢弃这一帧，断开重连之后重试也不会成功
+                u->drops += head[1];
+                u->sent = 0;
+                off += sizeof(head) + head[0];
+                continue;
+            }
+
+            broken = errno != EAGAIN && errno != EWOULDBLOCK;
+            break;
+        }
+
+        if((u->sent += n) < (int)head[0]) {
+            break;
+        }
+
+        u->sent = 0;
+        off += sizeof(head) + head[0];
+    }
+
+    memmove(u->pending, u->pending + off, u->pending_len - off);
+    u->pending_len -= off;
+
+    if(broken) {
+        unix_reset(u);
+    }
+
+    return u->pending_len == 0 ? 0 : -1;
+}
+
+/**
+ * @brief	unix_queue	把一批日志作为一帧缓存，sent是已经发送的字节数
+ *
+ * @return	缓存的条数，缓冲区满时丢弃整批并返回-1
+ */
+static int unix_queue(unix_sink *u, const log_line *lines, int num, int total, int sent)
+{
+    uint32_t head[2] = {total, num};
+    int i;
+
+    if((u->pending == NULL && (u->pending = malloc(UNIX_PENDING_LEN)) == NULL)
+       || u->pending_len + (int)sizeof(head) + total > UNIX_PENDING_LEN) {
+        if(sent > 0) {		//记录已经发出了一部分，只能断开
+            close(u->fd);
+            u->fd = -1;
+            u->retry_time = mono_ns() + UNIX_RETRY_INTERVAL;
+        }
+
+        u->drops += num;
+        return -1;
+    }
+
+    memcpy(u->pending + u->pending_len, head, sizeof(head));
+    u->pending_len += sizeof(head);
+
+    for(i = 0; i < num; i++) {
+        memcpy(u->pending + u->pending_len, lines[i].data, lines[i].len);
+        u->pending_len += lines[i].len;
+    }
+
+    if(sent > 0) {		//只有缓冲区为空时才直接发送，所以这是第一帧
+        u->sent = sent;
+    }
+
+    return num;
+}
+
+static void unix_retry(unix_sink *u)
+{
+    int64_t now;
+
+    if(u->fd < 0 && (now = mono_ns()) >= u->retry_time) {
+        if(unix_connect(u) == 0) {
+            ++u->reconnects;
+        } else {
+            u->retry_time = now + UNIX_RETRY_INTERVAL;
+        }
+    }
+
+    if(u->fd >= 0 && u->pending_len > 0) {
+        unix_drain(u);
+    }
+}
+
+/**
+ * @brief	unix_send	非阻塞发送一批日志，SOCK_SEQPACKET时是一个包，发送不出去的部分缓存
+ */
+static int unix_send(unix_sink *u, const log_line *lines, int num)
+{
+    struct iovec iov[LOG_SINK_BATCH];
+    struct msghdr msg;
+    int i, n = 0, total = 0;
+
+    for(i = 0; i < num; i++) {
+        iov[i].iov_base = (void *)lines[i].data;
+        iov[i].iov_len = lines[i].len;
+        total += lines[i].len;
+    }
+
+    if(u->fd >= 0 && u->pending_len == 0) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = num;
+
+        while((n = sendmsg(u->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT)) < 0 && errno == EINTR);
+
+        if(n == total) {
+            return num;
+        }
+
+        if(n < 0) {
+            if(errno == EMSGSIZE) {		//超过了对端的接收缓冲区，重试也不会成功
+                u->drops += num;
+                return -1;
+            }
+
+            if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                unix_reset(u);
+            }
+
+            n = 0;
+        }
+    }
+
+    return unix_queue(u, lines, num, total, n);
+}
+
+static int unix_write(void *ctx, const log_line *lines, int num)
+{
+    unix_sink *u = ctx;
+    int n, done, ret = num;
+
+    unix_retry(u);
+
+    for(done = 0; done < num; done += n) {
+        n = num - done < LOG_SINK_BATCH ? num - done : LOG_SINK_BATCH;
+
+        if(unix_send(u, lines + done, n) < 0) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+static int unix_flush(void *ctx)
+{
+    unix_sink *u = ctx;
+
+    if(u->pending_len > 0) {
+        unix_retry(u);
+    }
+
+    if(u->pending_len > 0) {	//对端读得慢或者正在重连，由调用者稍后再试
+        errno = EAGAIN;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void unix_close(void *ctx)
+{
+    unix_sink *u = ctx;
+
+    if(u->fd >= 0) {
+        close(u->fd);
+    }
+
+    free(u->pending);
+    free(u);
+}
+
+static void unix_stats(void *ctx, FILE *stream)
+{
+    unix_sink *u = ctx;
+    fprintf(stream, "\t\tunix=%s%s connected=%d pending_bytes=%d drop_num=%ld reconnect_num=%ld\n",
+            u->addr.sun_path[0] == '\0' ? "@" : "", u->addr.sun_path + (u->addr.sun_path[0] == '\0'),
+            u->fd >= 0, u->pending_len, u->drops, u->reconnects);
+}
+
+static const log_sink_ops unix_ops = {"unix", NULL, unix_write, unix_flush, unix_close, unix_stats};
+
+sink_ref *sink_unix(const char *path, int type)
+{
+    unix_sink *u;
+    sink_ref *s;
+    int len;
+
+    if(path == NULL || (len = strlen(path)) == 0 || len >= (int)sizeof(u->addr.sun_path)
+       || (type != SOCK_STREAM && type != SOCK_SEQPACKET)) {
+        return NULL;
+    }
+
+    if((u = calloc(1, sizeof(unix_sink))) == NULL) {
+        return NULL;
+    }
+
+    u->addr.sun_family = AF_UNIX;
+    memcpy(u->addr.sun_path, path, len);
+    u->addr_len = offsetof(struct sockaddr_un, sun_path) + len + 1;
+
+    if(path[0] == '@') {		//抽象命名空间不包括结尾的\0
+        u->addr.sun_path[0] = '\0';
+        u->addr_len = offsetof(struct sockaddr_un, sun_path) + len;
+    }
+
+    u->type = type;
+    u->fd = -1;
+
+    if(unix_connect(u) != 0) {
+        fprintf(stderr, "connect %s failed\n", path);
+        free(u);
+        return NULL;
+    }
+
+    if((s = sink_new(&unix_ops, u)) == NULL) {
+        unix_close(u);
+    }
+
+    return s;
+}
+
+///////////////////////////ring sink///////////////////////////
+struct log_ring_sink_s {
+    pthread_mutex_t lock;		//write_batch已经串行，锁只用于和读者互斥
+    char *buf;
+    int size;
+    int64_t head;				//写入的总字节数
+    int64_t lines;
+};
+
+static int ring_write(void *ctx, const log_line *lines, int num)
+{
+    log_ring_sink *ring = ctx;
+    const char *data;
+    int i, len, pos, n;
+
+    pthread_mutex_lock(&ring->lock);
+
+    for(i = 0; i < num; i++) {
+        data = lines[i].data;
+        len = lines[i].len;
+
+        if(len > ring->size) {		//只保留最后size字节
+            ring->head += len - ring->size;
+            data += len - ring->size;
+            len = ring->size;
+        }
+
+        pos = ring->head % ring->size;
+        n = len < ring->size - pos ? len : ring->size - pos;
+        memcpy(ring->buf + pos, data, n);
+        memcpy(ring->buf, data + n, len - n);
+        ring->head += len;
+    }
+
+    ring->lines += num;
+    pthread_mutex_unlock(&ring->lock);
+    return num;
+}
+
+static void ring_stats(void *ctx, FILE *stream)
+{
+    log_ring_sink *ring = ctx;
+    fprintf(stream, "\t\tring_size=%d ring_bytes=%ld\n", ring->size, ring->head);
+}
+
+const log_sink_ops log_ring_sink_ops = {"ring", NULL, ring_write, NULL, NULL, ring_stats};
+
+log_ring_sink *log_ring_sink_create(int size)
+{
+    log_ring_sink *ring;
+
+    if(size <= 0 || (ring = calloc(1, sizeof(log_ring_sink))) == NULL) {
+        return NULL;
+    }
+
+    if((ring->buf = malloc(size)) == NULL) {
+        free(ring);
+        return NULL;
+    }
+
+    ring->size = size;
+    pthread_mutex_init(&ring->lock, NULL);
+    return ring;
+}
+
+void log_ring_sink_destroy(log_ring_sink *ring)
+{
+    if(ring == NULL) {
+        return;
+    }
+
+    pthread_mutex_destroy(&ring->lock);
+    free(ring->buf);
+    free(ring);
+}
+
+int log_ring_sink_read(log_ring_sink *ring, char *buf, int len)
+{
+    int64_t start;
+    int n, pos, first, partial;
+    char *nl;
+
+    if(ring == NULL || buf == NULL || len <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    n = ring->head < ring->size ? ring->head : ring->size;
+
+    if(n > len - 1) {
+        n = len - 1;
+    }
+
+    start = ring->head - n;
+    partial = start > 0 && (n == ring->size || ring->buf[(start - 1) % ring->size] != '\n');	//开头的行不完整
+    pos = start % ring->size;
+    first = n < ring->size - pos ? n : ring->size - pos;
+    memcpy(buf, ring->buf + pos, first);
+    memcpy(buf + first, ring->buf, n - first);
+    pthread_mutex_unlock(&ring->lock);
+    buf[n] = '\0';
+
+    if(partial) {
+        nl = memchr(buf, '\n', n);
+        first = nl != NULL ? nl - buf + 1 : n;
+        memmove(buf, buf + first, n - first + 1);
+        n -= first;
+    }
+
+    return n;
+}
+
+int64_t log_ring_sink_lines(log_ring_sink *ring)
+{
+    return ring != NULL ? ring->lines : 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file sink.h
+ * @brief 输出设备
+ *
+ * 1.所有设备都是带引用计数的sink_ref，配置快照引用设备，最后一个引用释放时关闭\n
+ * 2.内置的终端、文件和socket设备实现log_sink_ops，按批使用writev/sendmmsg写入\n
+ * 3.文件按照设备号和inode在进程内共享，多个日志对象打开同一个文件时只有一个描述符\n
+ * 4.文件路由包含日志文件和调试文件两个子设备，DEBUG级别写入调试文件，没有设置时写入stderr\n
+ * 5.sink_write对同一个设备串行调用write_batch，并统计条数、字节数和错误数\n
+ * 6.unix socket设备非阻塞发送，发送不出去的批按帧缓存，调度线程空闲之前(flush)重试，断开后定时重连；重试后仍有缓存时flush返回EAGAIN\n
+ * 7.文件可以生成时间索引(文件名.idx)，开启后写入在文件的锁内进行，用写入之后的偏移计算每条日志的位置\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __SINK_H__
+#define __SINK_H__
+
+#include "log.h"
+#include "shm_ring.h"
+#include <sys/types.h>
+
+typedef struct sink_ref_s {
+    volatile int ref;
+    const log_sink_ops *ops;	//NULL表示只是引用计数的容器(文件路由的子设备，共享内存)
+    void *ctx;					//内置设备为sink_ref本身
+    pthread_mutex_t lock;		//串行化write_batch
+    int fd;						//文件描述符，-1表示没有
+    int sock_type;				//socket的类型，0表示不是socket
+    shm_ring *shm;
+    struct sink_ref_s *sub[2];	//文件路由的日志文件和调试文件
+    dev_t dev;					//文件在全局表中按照设备号和inode共享
+    ino_t ino;
+    struct sink_ref_s *next;
+    char *path;					//sink_file_open打开的路径
+    struct sink_index_s *index;	//文件的时间索引，NULL表示没有
+    volatile int64_t lines;
+    volatile int64_t bytes;
+    volatile int64_t batches;
+    volatile int64_t errors;
+} sink_ref;
+
+/**
+ * @brief	sink_new	创建设备，引用计数为1
+ */
+sink_ref *sink_new(const log_sink_ops *ops, void *ctx);
+void sink_get(sink_ref *s);
+/**
+ * @brief	sink_put	释放引用，最后一个引用释放时调用close并关闭描述符
+ */
+void sink_put(sink_ref *s);
+/**
+ * @brief	sink_console	终端设备(stderr)，全局唯一，不会被关闭
+ */
+sink_ref *sink_console(void);
+/**
+ * @brief	sink_file_open	以追加方式打开文件，已经被打开的文件返回共享的设备
+ */
+sink_ref *sink_file_open(const char *path);
+/**
+ * @brief	sink_file_index	设置文件的时间索引，文件被多个日志对象共享时使用最后一次的设置
+ *
+ * 打开时如果索引描述的范围超出了文件的大小(文件被截断或者替换)，清空旧的索引
+ *
+ * @param	s			sink_file_open返回的文件，索引文件为路径加上.idx
+ * @param	records		每多少条日志生成一项
+ * @param	bytes		或者每多少字节生成一项，都为0时关闭索引(写出最后一项)
+ *
+ * @return	成功返回0
+ */
+int sink_file_index(sink_ref *s, int records, int bytes);
+/**
+ * @brief	sink_file_route	创建文件路由，接管file和debug的引用，都可以为NULL
+ */
+sink_ref *sink_file_route(sink_ref *file, sink_ref *debug);
+/**
+ * @brief	sink_socket	创建socket设备，接管描述符
+ */
+sink_ref *sink_socket(int sock);
+/**
+ * @brief	sink_unix	连接本机的unix socket
+ *
+ * @param	path		socket路径，以@开头表示抽象命名空间
+ * @param	type		SOCK_STREAM或者SOCK_SEQPACKET
+ */
+sink_ref *sink_unix(const char *path, int type);
+/**
+ * @brief	sink_shm	创建共享内存环的引用计数容器，成功时接管环，失败时环仍由调用者关闭
+ */
+sink_ref *sink_shm(shm_ring *ring);
+/**
+ * @brief	sink_write	写入一批日志
+ *
+ * @return	写入的条数，失败返回-1
+ */
+int sink_write(sink_ref *s, const log_line *lines, int num);
+/**
+ * @brief	sink_flush	让设备写出或者重试缓存的数据
+ *
+ * @return	成功返回0，非阻塞设备还有发送不出去的数据时返回-1并且errno为EAGAIN
+ */
+int sink_flush(sink_ref *s);
+/**
+ * @brief	sink_print	输出设备的统计
+ */
+void sink_print(sink_ref *s, int id, FILE *stream);
+
+#endif /* __SINK_H__ */
@@ -0,0 +1,210 @@
+#include "stamp.h"
+#include <pthread.h>
+#if STAMP_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+#define STAMP_SAMPLES		5		//每次校准读取的次数，取原始值间隔最小的一次
+#define STAMP_RETRY			64		//转换时等待映射更新的最多次数，信号处理函数可能打断了校准
+#define STAMP_DRIFT			1e-3	//新测量的频率偏差超过这个比例时认为墙上时间被跳变，保留原来的频率
+
+typedef struct stamp_map_s {
+    volatile uint32_t seq;		//奇数表示正在更新
+    volatile int ready;
+    int64_t raw;				//锚点
+    int64_t wall;
+    double rate;				//每单位原始值的纳秒数
+    int64_t last_raw;			//上次校准的采样，只有校准的线程使用
+    int64_t last_wall;
+} stamp_map;
+
+static stamp_map maps[STAMP_NUM];
+static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile int calibrating = 0;
+static volatile int64_t next_calibrate = 0;
+
+/**
+ * @brief	stamp_sample	读取一对相邻的(原始值，墙上时间)，原始值取墙上时间前后两次读数的中点
+ */
+static void stamp_sample(int source, int64_t *raw, int64_t *wall)
+{
+    int64_t r1, r2, w, best = -1;
+    int i;
+
+    for(i = 0; i < STAMP_SAMPLES; i++) {
+        r1 = stamp_read(source);
+        w = stamp_read(STAMP_REALTIME);
+        r2 = stamp_read(source);
+
+        if(best < 0 || r2 - r1 < best) {
+            best = r2 - r1;
+            *raw = r1 + (r2 - r1) / 2;
+            *wall = w;
+        }
+    }
+}
+
+static void stamp_publish(stamp_map *m, int64_t raw, int64_t wall, double rate)
+{
+    __atomic_store_n(&m->seq, m->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    m->raw = raw;
+    m->wall = wall;
+    m->rate = rate;
+    __atomic_store_n(&m->seq, m->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief	tsc_invariant	cpu是否支持不变的TSC(频率不随调频和休眠变化)
+ */
+static int tsc_invariant(void)
+{
+#if STAMP_HAVE_TSC
+    unsigned int a, b, c, d;
+    return __get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1U << 8));
+#else
+    return 0;
+#endif
+}
+
+int stamp_init(int source)
+{
+    stamp_map *m;
+    struct timespec ts;
+    int64_t raw, wall;
+    double rate = 1.0;
+    int ret = 0;
+
+    if(source < STAMP_MONOTONIC_RAW || source >= STAMP_NUM) {
+        return source == STAMP_REALTIME || source == STAMP_COARSE ? 0 : -1;
+    }
+
+    m = &maps[source];
+
+    if(m->ready) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&init_lock);
+
+    if(m->ready) {
+        goto out;
+    }
+
+    if(source == STAMP_MONOTONIC_RAW && clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0) {
+        ret = -1;
+        goto out;
+    }
+
+    stamp_sample(source, &raw, &wall);
+
+    if(source == STAMP_TSC) {
+        if(!tsc_invariant()) {
+            ret = -1;
+            goto out;
+        }
+
+        ts.tv_sec = 0;
+        ts.tv_nsec = STAMP_INIT_MS * 1000000L;
+        nanosleep(&ts, NULL);
+        m->last_raw = raw;
+        m->last_wall = wall;
+        stamp_sample(source, &raw, &wall);
+
+        if(raw <= m->last_raw || wall <= m->last_wall) {
+            ret = -1;
+            goto out;
+        }
+
+        rate = (double)(wall - m->last_wall) / (raw - m->last_raw);
+    }
+
+    m->last_raw = raw;
+    m->last_wall = wall;
+    stamp_publish(m, raw, wall, rate);
+    __atomic_store_n(&m->ready, 1, __ATOMIC_RELEASE);
+out:
+    pthread_mutex_unlock(&init_lock);
+    return ret;
+}
+
+int64_t stamp_wall(int source, int64_t raw)
+{
+    stamp_map *m;
+    int64_t r, w;
+    double rate;
+    uint32_t seq;
+    int i;
+
+    if(source < STAMP_MONOTONIC_RAW || source >= STAMP_NUM) {
+        return raw;
+    }
+
+    m = &maps[source];
+
+    if(!__atomic_load_n(&m->ready, __ATOMIC_ACQUIRE)) {
+        return stamp_read(STAMP_REALTIME);
+    }
+
+    for(i = 0; ; i++) {
+        seq = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+        r = m->raw;
+        w = m->wall;
+        rate = m->rate;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if(((seq & 1) == 0 && m->seq == seq) || i >= STAMP_RETRY) {
+            break;
+        }
+    }
+
+    return w + (int64_t)((raw - r) * rate);
+}
+
+void stamp_calibrate(int64_t now)
+{
+    stamp_map *m;
+    int64_t raw, wall;
+    double rate;
+    int i;
+
+    if(now < next_calibrate || __sync_lock_test_and_set(&calibrating, 1)) {
+        return;
+    }
+
+    next_calibrate = now + STAMP_INTERVAL * 1000000LL;
+
+    for(i = STAMP_MONOTONIC_RAW; i < STAMP_NUM; i++) {
+        m = &maps[i];
+
+        if(!__atomic_load_n(&m->ready, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        stamp_sample(i, &raw, &wall);
+        rate = m->rate;
+
+        if(raw > m->last_raw && wall > m->last_wall) {
+            rate = (double)(wall - m->last_wall) / (raw - m->last_raw);
+
+            if(rate > m->rate * (1 + STAMP_DRIFT) || rate < m->rate * (1 - STAMP_DRIFT)) {		//墙上时间被修改，只移动锚点
+                rate = m->rate;
+            }
+        }
+
+        m->last_raw = raw;
+        m->last_wall = wall;
+        stamp_publish(m, raw, wall, rate);
+    }
+
+    __sync_lock_release(&calibrating);
+}
+
+double stamp_rate(int source)
+{
+    if(source < STAMP_MONOTONIC_RAW) {
+        return 1.0;
+    }
+
+    return source < STAMP_NUM && maps[source].ready ? maps[source].rate : 0;
+}
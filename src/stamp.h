@@ -0,0 +1,79 @@
+/**
+ * @file stamp.h
+ * @brief 日志时间戳的时钟源，写日志的线程只读取原始值，由调度线程转换为墙上时间
+ *
+ * 1.时钟源:REALTIME，REALTIME_COARSE(读出的已经是墙上时间)，MONOTONIC_RAW和TSC(需要转换)\n
+ * 2.需要转换的时钟维护一个(原始值，墙上时间，每单位纳秒数)的映射，由调度线程定期重新校准，跟随NTP的调整\n
+ * 3.映射使用序号锁发布，转换不加锁，也可以在信号处理函数中使用\n
+ * 4.TSC只在x86上并且cpu支持不变的TSC(invariant TSC)时可用，第一次使用时阻塞STAMP_INIT_MS毫秒测量频率\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __STAMP_H__
+#define __STAMP_H__
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define STAMP_HAVE_TSC		1
+#else
+#define STAMP_HAVE_TSC		0
+#endif
+
+#define STAMP_INIT_MS		10		//第一次使用TSC时测量频率的时间
+#define STAMP_INTERVAL		1000	//重新校准的间隔(毫秒)
+
+enum stamp_source_s {STAMP_REALTIME = 0, STAMP_COARSE, STAMP_MONOTONIC_RAW, STAMP_TSC, STAMP_NUM};	//和log_clock一致
+
+/**
+ * @brief	stamp_read	读取时钟的原始值，REALTIME和COARSE为1970年以来的纳秒数
+ */
+static inline int64_t stamp_read(int source)
+{
+    struct timespec ts;
+
+    switch(source) {
+#if STAMP_HAVE_TSC
+        case STAMP_TSC:
+            return (int64_t)__rdtsc();
+#endif
+        case STAMP_COARSE:
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            break;
+        case STAMP_MONOTONIC_RAW:
+            clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+            break;
+        default:
+            clock_gettime(CLOCK_REALTIME, &ts);
+            break;
+    }
+
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief	stamp_init	准备时钟源，需要转换的时钟进行第一次校准，已经准备好时直接返回
+ *
+ * @return	时钟不可用返回-1
+ */
+int stamp_init(int source);
+/**
+ * @brief	stamp_wall	把原始值转换为1970年以来的纳秒数，异步信号安全
+ */
+int64_t stamp_wall(int source, int64_t raw);
+/**
+ * @brief	stamp_calibrate	距离上次校准超过STAMP_INTERVAL时重新校准所有已经准备好的时钟，由调度线程调用
+ *
+ * @param	now			CLOCK_MONOTONIC的纳秒数
+ */
+void stamp_calibrate(int64_t now);
+/**
+ * @brief	stamp_rate	每单位原始值的纳秒数，没有准备好时返回0
+ */
+double stamp_rate(int source);
+
+#endif /* __STAMP_H__ */
@@ -0,0 +1,168 @@
+#include "topo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define TOPO_MPOL_PREFERRED	1
+#define TOPO_NODE_DIR		"/sys/devices/system/node"
+
+static pthread_once_t topo_once = PTHREAD_ONCE_INIT;
+static int node_num = 1;
+static int node_ids[TOPO_MAX_NODE];
+static cpu_set_t node_cpus[TOPO_MAX_NODE];		//按照node_ids的顺序
+static short cpu_node[CPU_SETSIZE];
+static __thread int cached_node = -1;
+static __thread unsigned int cached_calls = 0;
+
+/**
+ * @brief	parse_cpulist	解析"0-3,8-11"形式的cpu列表
+ */
+static void parse_cpulist(const char *s, cpu_set_t *set)
+{
+    char *end;
+    long a, b;
+
+    while(*s != '\0' && *s != '\n') {
+        a = strtol(s, &end, 10);
+
+        if(end == s) {
+            break;
+        }
+
+        b = a;
+        s = end;
+
+        if(*s == '-') {
+            b = strtol(s + 1, &end, 10);
+            s = end;
+        }
+
+        for(; a <= b && a < CPU_SETSIZE; a++) {
+            CPU_SET(a, set);
+        }
+
+        if(*s == ',') {
+            ++s;
+        }
+    }
+}
+
+static int node_cmp(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static void topo_load(void)
+{
+    struct dirent *ent;
+    char path[sizeof(TOPO_NODE_DIR) + sizeof(ent->d_name) + 16], buf[4096];
+    DIR *dir;
+    FILE *fp;
+    int i, n = 0, cpu;
+
+    memset(cpu_node, 0, sizeof(cpu_node));
+    node_ids[0] = 0;
+    CPU_ZERO(&node_cpus[0]);
+
+    if((dir = opendir(TOPO_NODE_DIR)) == NULL) {
+        return;
+    }
+
+    while((ent = readdir(dir)) != NULL && n < TOPO_MAX_NODE) {
+        if(strncmp(ent->d_name, "node", 4) != 0 || ent->d_name[4] < '0' || ent->d_name[4] > '9') {
+            continue;
+        }
+
+        node_ids[n++] = atoi(ent->d_name + 4);
+    }
+
+    closedir(dir);
+
+    if(n == 0) {
+        return;
+    }
+
+    qsort(node_ids, n, sizeof(int), node_cmp);
+
+    for(i = 0; i < n; i++) {
+        CPU_ZERO(&node_cpus[i]);
+        snprintf(path, sizeof(path), TOPO_NODE_DIR "/node%d/cpulist", node_ids[i]);
+
+        if((fp = fopen(path, "r")) == NULL) {
+            continue;
+        }
+
+        if(fgets(buf, sizeof(buf), fp) != NULL) {
+            parse_cpulist(buf, &node_cpus[i]);
+        }
+
+        fclose(fp);
+
+        for(cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if(CPU_ISSET(cpu, &node_cpus[i])) {
+                cpu_node[cpu] = node_ids[i];
+            }
+        }
+    }
+
+    node_num = n;
+}
+
+int topo_node_num(int *ids)
+{
+    pthread_once(&topo_once, topo_load);
+
+    if(ids != NULL) {
+        memcpy(ids, node_ids, node_num * sizeof(int));
+    }
+
+    return node_num;
+}
+
+int topo_cpu_node(int cpu)
+{
+    pthread_once(&topo_once, topo_load);
+    return cpu >= 0 && cpu < CPU_SETSIZE ? cpu_node[cpu] : 0;
+}
+
+int topo_node_cpus(int node, cpu_set_t *set)
+{
+    int i;
+    pthread_once(&topo_once, topo_load);
+    CPU_ZERO(set);
+
+    for(i = 0; i < node_num; i++) {
+        if(node_ids[i] == node) {
+            CPU_OR(set, set, &node_cpus[i]);
+            break;
+        }
+    }
+
+    return CPU_COUNT(set);
+}
+
+int topo_current_node(void)
+{
+    if(cached_node < 0 || (++cached_calls & 255) == 0) {	//线程可能被迁移，定期刷新
+        cached_node = topo_cpu_node(sched_getcpu());
+    }
+
+    return cached_node;
+}
+
+int topo_bind(void *addr, size_t len, int node)
+{
+    unsigned long mask[TOPO_MAX_NODE / (8 * sizeof(unsigned long))];
+
+    if(node < 0 || node >= TOPO_MAX_NODE) {
+        return -1;
+    }
+
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, addr, len, TOPO_MPOL_PREFERRED, mask, TOPO_MAX_NODE + 1, 0) == 0 ? 0 : -1;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file topo.h
+ * @brief cpu和NUMA节点的拓扑信息
+ *
+ * 1.从/sys/devices/system/node读取每个节点的cpu列表，没有NUMA信息时认为只有一个节点0\n
+ * 2.内存绑定直接使用mbind系统调用，不依赖libnuma\n
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __TOPO_H__
+#define __TOPO_H__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <stddef.h>
+
+#define TOPO_MAX_NODE	64
+
+/**
+ * @brief	topo_node_num	节点个数
+ *
+ * @param	ids			不为NULL时返回节点编号(最多TOPO_MAX_NODE个)
+ *
+ * @return	节点个数，至少为1
+ */
+int topo_node_num(int *ids);
+/**
+ * @brief	topo_cpu_node	cpu所在的节点，未知时返回0
+ */
+int topo_cpu_node(int cpu);
+/**
+ * @brief	topo_node_cpus	节点的cpu集合
+ *
+ * @return	cpu个数
+ */
+int topo_node_cpus(int node, cpu_set_t *set);
+/**
+ * @brief	topo_current_node	当前线程所在的节点，每个线程缓存结果，每256次调用重新读取一次
+ */
+int topo_current_node(void);
+/**
+ * @brief	topo_bind	设置内存优先从节点分配(MPOL_PREFERRED)，需要在第一次访问之前调用
+ *
+ * @param	addr		页对齐的地址
+ * @param	len			长度
+ * @param	node		节点
+ *
+ * @return	成功返回0
+ */
+int topo_bind(void *addr, size_t len, int node);
+
+#endif /* __TOPO_H__ */
@@ -0,0 +1,121 @@
+/**
+ * @file test.h
+ * @brief 测试程序共用的检查宏和内存环形设备的辅助函数
+ *
+ * 每个测试程序是一个ctest用例，检查失败时输出位置并继续，main返回失败的个数
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_RING_SIZE		(1 << 20)
+#define TEST_WAIT_MS		5000		//等待调度线程输出的最长时间
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while(0)
+
+#define CHECK_STR(got, expect) do { \
+        const char *__got = (got), *__expect = (expect); \
+        if(__got == NULL || strcmp(__got, __expect) != 0) { \
+            fprintf(stderr, "%s:%d: expect \"%s\"\n\tgot \"%s\"\n", __FILE__, __LINE__, __expect, __got != NULL ? __got : "(null)"); \
+            failures++; \
+        } \
+    } while(0)
+
+/**
+ * @brief	ring_setup	创建日志对象并注册内存环形设备，调度线程还没有启动
+ *
+ * @return	设备的编号，失败返回-1
+ */
+static inline int ring_setup(log_t **lg, log_ring_sink **ring, log_format format)
+{
+    int sink;
+
+    *lg = log_create();
+    *ring = log_ring_sink_create(TEST_RING_SIZE);
+
+    if(*lg == NULL || *ring == NULL || log_init(*lg) != LOG_TRUE
+            || (sink = log_add_sink(*lg, &log_ring_sink_ops, *ring, format, LOG_ESCAPE_RAW)) < 0) {
+        fprintf(stderr, "setup failed\n");
+        return -1;
+    }
+
+    return sink;
+}
+
+/**
+ * @brief	ring_teardown	先销毁日志对象再释放设备
+ */
+static inline void ring_teardown(log_t *lg, log_ring_sink *ring)
+{
+    log_destroy(lg);
+    log_ring_sink_destroy(ring);
+}
+
+/**
+ * @brief	ring_wait	等待设备收到lines行
+ *
+ * @return	超时返回0
+ */
+static inline int ring_wait(log_ring_sink *ring, int64_t lines)
+{
+    int ms;
+
+    for(ms = 0; log_ring_sink_lines(ring) < lines; ms++) {
+        if(ms == TEST_WAIT_MS) {
+            return 0;
+        }
+
+        usleep(1000);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief	ring_line	取得设备中的第index行(从0开始)，skip_time不为0时去掉文本格式开头的时间
+ *
+ * @return	没有这一行返回NULL
+ */
+static inline const char *ring_line(log_ring_sink *ring, int index, int skip_time, char *line, int len)
+{
+    static char buf[TEST_RING_SIZE];
+    char *p = buf, *nl;
+
+    log_ring_sink_read(ring, buf, sizeof(buf));
+
+    for(; index > 0 && (p = strchr(p, '\n')) != NULL; index--) {
+        ++p;
+    }
+
+    if(p == NULL || *p == '\0') {
+        return NULL;
+    }
+
+    if(skip_time && *p == '[' && (nl = strchr(p, ']')) != NULL) {
+        p = nl + 1;
+    }
+
+    if((nl = strchr(p, '\n')) != NULL && nl - p < len) {
+        len = nl - p + 1;
+    }
+
+    snprintf(line, len, "%s", p);
+    return line;
+}
+
+#endif /* __TEST_H__ */
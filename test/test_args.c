@@ -0,0 +1,41 @@
+/**
+ * @file test_args.c
+ * @brief log_write_args:按类型保存的参数由调度线程格式化，缺少或者类型不匹配的转换原样输出
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+
+int main(void)
+{
+    char category[CATEGORY_LEN] = "fmt", line[512];
+    log_field args[] = {LOG_KV_INT(NULL, -42), LOG_KV_STR(NULL, "abc"), LOG_KV_UINT(NULL, 255), LOG_KV_DOUBLE(NULL, 3.14159), LOG_KV_BOOL(NULL, 1)};
+    log_field strs[] = {LOG_KV_STR(NULL, "a"), LOG_KV_STR(NULL, "b"), LOG_KV_STR(NULL, "c"), LOG_KV_STR(NULL, "d"), LOG_KV_STR(NULL, "e"), LOG_KV_UINT(NULL, 255)};
+    log_ring_sink *ring;
+    int sink;
+    log_t *lg;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0) {
+        return 1;
+    }
+
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+    log_write(lg, LOG_ROUTE(sink), INFO, category, "n=%5d s=%-5s| x=%#x f=%.2f b=%d%%", -42, "abc", 255, 3.14159, 1);
+    log_write_args(lg, LOG_ROUTE(sink), INFO, category, "n=%5d s=%-5s| x=%#x f=%.2f b=%d%%", args, 5);
+    log_write_args(lg, LOG_ROUTE(sink), ERROR, category, "missing %d %s", args, 1);		//缺少的参数原样输出
+    log_write_args(lg, LOG_ROUTE(sink), ERROR, category, "str %d|%x|%p|%f|%s ptr %p", strs, 6);	//类型不匹配的转换原样输出
+    CHECK(ring_wait(ring, 4));
+    CHECK_STR(ring_line(ring, 0, 1, line, sizeof(line)), "[INFO ][fmt] - n=  -42 s=abc  | x=0xff f=3.14 b=1%");
+    CHECK_STR(ring_line(ring, 1, 1, line, sizeof(line)), "[INFO ][fmt] - n=  -42 s=abc  | x=0xff f=3.14 b=1%");
+    CHECK_STR(ring_line(ring, 2, 1, line, sizeof(line)), "[ERROR][fmt] - missing -42 %s");
+    CHECK_STR(ring_line(ring, 3, 1, line, sizeof(line)), "[ERROR][fmt] - str %d|%x|%p|%f|e ptr 0xff");
+    ring_teardown(lg, ring);
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
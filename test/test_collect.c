@@ -0,0 +1,127 @@
+/**
+ * @file test_collect.c
+ * @brief 多进程模式:子进程写入共享内存环，收集进程按时间戳合并后输出到内存环形设备
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+#include "shm_ring.h"
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#define PRODUCERS	2
+#define RECORDS		500			//小于LOG_SHM_BUFFER_NUM，收集之前不会丢弃
+#define SINK_ID		3			//收集进程注册的第一个自定义设备
+
+static char name[32];
+
+static void produce(int id)
+{
+    char category[CATEGORY_LEN] = "child";
+    log_field fields[] = {LOG_KV_INT("id", id)};
+    log_t *lg = log_create();
+    int i;
+
+    if(lg == NULL || log_init(lg) != LOG_TRUE || log_set_shm(lg, name) != LOG_TRUE) {
+        _exit(1);
+    }
+
+    for(i = 0; i < RECORDS; i++) {
+        log_write(lg, LOG_ROUTE(SINK_ID), i % 2 ? ERROR : INFO, category, "%d %d", id, i);
+    }
+
+    log_write_kv(lg, LOG_ROUTE(SINK_ID), FATAL, category, "bye", fields, 1);
+    log_destroy(lg);
+    _exit(0);
+}
+
+int main(void)
+{
+    static char buf[TEST_RING_SIZE];
+    pid_t pids[PRODUCERS];
+    int next[PRODUCERS] = {0}, bye[PRODUCERS] = {0};
+    char path[64], *line, *save = NULL, level[8];
+    int i, id, seq, status, bad = 0, total = 0, ms, n;
+    log_ring_sink *ring;
+    log_t *lg;
+
+    snprintf(name, sizeof(name), "test%d", (int)getpid());
+    lg = log_create();
+    CHECK(lg != NULL && log_init(lg) == LOG_TRUE);
+    CHECK(log_set_shm(lg, "") == LOG_FALSE);		//名字不能为空或者包含'/'
+    CHECK(log_set_shm(lg, "a/b") == LOG_FALSE);
+    log_destroy(lg);
+
+    for(i = 0; i < PRODUCERS; i++) {
+        if((pids[i] = fork()) == 0) {
+            produce(i);
+        }
+    }
+
+    for(i = 0; i < PRODUCERS; i++) {
+        CHECK(waitpid(pids[i], &status, 0) == pids[i] && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    lg = log_create();
+    ring = log_ring_sink_create(TEST_RING_SIZE);
+
+    if(lg == NULL || ring == NULL || log_init(lg) != LOG_TRUE
+            || log_add_sink(lg, &log_ring_sink_ops, ring, LOG_FORMAT_TEXT, LOG_ESCAPE_RAW) != SINK_ID
+            || log_set_pattern(lg, LOG_ROUTE(SINK_ID), "%p %m%X") != LOG_TRUE) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+
+    for(ms = 0; ms < TEST_WAIT_MS; ms += 10) {		//生产者都已经退出，环读空之后共享内存被删除
+        if((n = log_collect(lg, name)) < 0) {
+            break;
+        }
+
+        total += n;
+
+        for(i = 0; i < PRODUCERS; i++) {
+            snprintf(path, sizeof(path), "/dev/shm/" SHM_RING_PREFIX "%s.%d", name, (int)pids[i]);
+
+            if(access(path, F_OK) == 0) {
+                break;
+            }
+        }
+
+        if(i == PRODUCERS && total == PRODUCERS * (RECORDS + 1)) {
+            break;
+        }
+
+        usleep(10000);
+    }
+
+    CHECK(total == PRODUCERS * (RECORDS + 1));
+    CHECK(ms < TEST_WAIT_MS);
+    CHECK(log_ring_sink_lines(ring) == PRODUCERS * (RECORDS + 1));
+    log_ring_sink_read(ring, buf, sizeof(buf));
+
+    for(line = strtok_r(buf, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save)) {
+        if(sscanf(line, "FATAL bye id=%d", &id) == 1 && id >= 0 && id < PRODUCERS && next[id] == RECORDS) {
+            bye[id]++;
+        } else if(sscanf(line, "%7s %d %d", level, &id, &seq) != 3 || id < 0 || id >= PRODUCERS || seq != next[id]++
+                  || strcmp(level, seq % 2 ? "ERROR" : "INFO") != 0) {
+            bad++;
+        }
+    }
+
+    CHECK(bad == 0);
+
+    for(i = 0; i < PRODUCERS; i++) {
+        CHECK(next[i] == RECORDS && bye[i] == 1);
+    }
+
+    log_destroy(lg);
+    log_ring_sink_destroy(ring);
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
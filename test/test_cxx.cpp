@@ -0,0 +1,43 @@
+/**
+ * @file test_cxx.cpp
+ * @brief C++接口:按静态类型序列化的参数由调度线程格式化，SIMPLELOG_*宏在-Wextra -Werror下编译
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "simplelog.hpp"
+#include "test.h"
+
+int main()
+{
+    simplelog::logger lg;
+    log_ring_sink *ring = log_ring_sink_create(TEST_RING_SIZE);
+    const char *name = "bob";
+    char line[512];
+    unsigned long long big = 1ULL << 40;
+    int sink;
+
+    if(!lg || ring == nullptr || (sink = log_add_sink(lg.get(), &log_ring_sink_ops, ring, LOG_FORMAT_TEXT, LOG_ESCAPE_RAW)) < 0
+            || !lg.set_pattern(LOG_ROUTE(sink), "%p %m")) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+
+    lg.dispatch();
+    SIMPLELOG_WRITE(lg, LOG_ROUTE(sink), INFO, "user %s uid=%d", name, 42);
+    SIMPLELOG_WRITE(lg, LOG_ROUTE(sink), ERROR, "x=%#x u=%u f=%.3f c=%c", 255u, big, 2.5, 'z');	//长度修饰符按参数类型补上
+    lg.write(LOG_ROUTE(sink), INFO, nullptr, "plain %d%%", -1);
+    CHECK(ring_wait(ring, 3));
+    CHECK_STR(ring_line(ring, 0, 0, line, sizeof(line)), "INFO user bob uid=42");
+    CHECK_STR(ring_line(ring, 1, 0, line, sizeof(line)), "ERROR x=0xff u=1099511627776 f=2.500 c=z");
+    CHECK_STR(ring_line(ring, 2, 0, line, sizeof(line)), "INFO plain -1%");
+    lg.reset();
+    log_ring_sink_destroy(ring);
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
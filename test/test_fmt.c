@@ -0,0 +1,86 @@
+/**
+ * @file test_fmt.c
+ * @brief 内部格式化函数:支持的转换与snprintf的结果相同，空间不足时截断，写日志时在调用线程格式化
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+#include "fmt.h"
+
+/**
+ * @brief	CHECK_FMT	fmt_format和snprintf的输出相同
+ */
+#define CHECK_FMT(fmt, arg...) do { \
+        char __want[256], __out[256]; \
+        fmt_buf __b; \
+        snprintf(__want, sizeof(__want), fmt, ##arg); \
+        fmt_init(&__b, __out, sizeof(__out)); \
+        fmt_format(&__b, fmt, ##arg); \
+        fmt_end(&__b); \
+        CHECK_STR(__out, __want); \
+    } while(0)
+
+static void test_convert(void)
+{
+    CHECK_FMT("%d %i %u %5d|%-5d|%05d|%+d|% d", -42, 7, 42u, -42, 42, -42, 42, 42);
+    CHECK_FMT("%x %X %#x %#o %o %8.3x", 255u, 255u, 255u, 8u, 0u, 31u);
+    CHECK_FMT("%hhd %hd %ld %lld %zu %llu", 300, 70000, -1L, -9223372036854775807LL - 1, (size_t)12345, 18446744073709551615ULL);
+    CHECK_FMT("%c|%-3c|%s|%.2s|%6s|%-6s|%*d|%.*s", 'a', 'b', "abc", "abc", "abc", "abc", 4, 9, 1, "xyz");
+    CHECK_FMT("%p %p", (void *)0x1234, (void *)NULL);
+    CHECK_FMT("%f %.0f %.2f %10.3f %-10.1f| %+.1f %F", 3.14159, 2.5, -0.005, 1e10, 0.25, 1.05, 100.0);
+    CHECK_FMT("%.19f %f", 0.1, 123456789012345678.0);
+    CHECK_FMT("%g %e %Lf", 0.0001, 12345.678, (long double)1.5);		//不支持的转换交给vsnprintf
+    CHECK_FMT("100%% done");
+}
+
+static void test_truncate(void)
+{
+    char buf[8];
+    fmt_buf b;
+
+    fmt_init(&b, buf, sizeof(buf));
+    fmt_format(&b, "%s-%d", "abcdef", 12345);
+    CHECK(fmt_end(&b) == 7);
+    CHECK_STR(buf, "abcdef-");
+    fmt_init(&b, buf, sizeof(buf));
+    fmt_format(&b, "%g %s", 1.5, "abcdefgh");
+    CHECK(fmt_end(&b) == 7);
+    CHECK_STR(buf, "1.5 abc");
+}
+
+/**
+ * @brief	test_write	log_write在调用线程格式化到日志记录中
+ */
+static void test_write(void)
+{
+    char category[CATEGORY_LEN] = "fmt", line[512];
+    log_ring_sink *ring;
+    int sink;
+    log_t *lg;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0) {
+        failures++;
+        return;
+    }
+
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+    log_write(lg, LOG_ROUTE(sink), INFO, category, "n=%5d s=%-5s| x=%#x f=%.2f b=%d%%", -42, "abc", 255, 3.14159, 1);
+    CHECK(ring_wait(ring, 1));
+    CHECK_STR(ring_line(ring, 0, 1, line, sizeof(line)), "[INFO ][fmt] - n=  -42 s=abc  | x=0xff f=3.14 b=1%");
+    ring_teardown(lg, ring);
+}
+
+int main(void)
+{
+    test_convert();
+    test_truncate();
+    test_write();
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file test_kv.c
+ * @brief 结构化字段在文本、logfmt和JSON格式下的编码
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+
+int main(void)
+{
+    static const log_format formats[] = {LOG_FORMAT_TEXT, LOG_FORMAT_LOGFMT, LOG_FORMAT_JSON};
+    char category[CATEGORY_LEN] = "kv", line[512];
+    log_field fields[] = {LOG_KV_INT("n", -7), LOG_KV_STR("s", "a \"b\""), LOG_KV_DOUBLE("d", 0.5), LOG_KV_BOOL("ok", 1), LOG_KV_UINT("u", 9)};
+    log_ring_sink *ring;
+    unsigned int i;
+    int sink;
+    log_t *lg;
+
+    for(i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if((sink = ring_setup(&lg, &ring, formats[i])) < 0) {
+            return 1;
+        }
+
+        log_dispatch(lg, DISPATCH_UNBLOCK);
+        log_write_kv(lg, LOG_ROUTE(sink), ERROR, category, "done", fields, 5);
+        CHECK(ring_wait(ring, 1));
+
+        if(formats[i] == LOG_FORMAT_TEXT) {
+            CHECK_STR(ring_line(ring, 0, 1, line, sizeof(line)), "[ERROR][kv] - done n=-7 s=\"a \\\"b\\\"\" d=0.5 ok=true u=9");
+        } else if(formats[i] == LOG_FORMAT_LOGFMT) {
+            CHECK(ring_line(ring, 0, 0, line, sizeof(line)) != NULL
+                  && strstr(line, " level=ERROR category=kv msg=done n=-7 s=\"a \\\"b\\\"\" d=0.5 ok=true u=9") != NULL);
+        } else {
+            CHECK(ring_line(ring, 0, 0, line, sizeof(line)) != NULL
+                  && strstr(line, "\"level\":\"ERROR\",\"category\":\"kv\",\"msg\":\"done\",\"n\":-7,\"s\":\"a \\\"b\\\"\",\"d\":0.5,\"ok\":true,\"u\":9}") != NULL);
+        }
+
+        ring_teardown(lg, ring);
+    }
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
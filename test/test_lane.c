@@ -0,0 +1,148 @@
+/**
+ * @file test_lane.c
+ * @brief 优先级通道:阻塞策略下多线程写入不丢失并保持顺序，丢弃和淘汰策略各自生效，通道只能在调度之前增加
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define WRITERS		4
+#define RECORDS		5000
+#define LANE_SIZE	64
+
+static log_t *lg;
+static int sink;
+
+static void *writer(void *p)
+{
+    char category[CATEGORY_LEN];
+    long id = (long)p;
+    int i;
+
+    snprintf(category, sizeof(category), "w%ld", id);
+
+    for(i = 0; i < RECORDS; i++) {
+        log_write(lg, LOG_ROUTE(sink), INFO, category, "%ld %d", id, i);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief	test_block	多个线程写入阻塞策略的通道，每条都输出，同一个线程的日志保持顺序
+ */
+static void test_block(void)
+{
+    static char buf[TEST_RING_SIZE];
+    pthread_t threads[WRITERS];
+    int next[WRITERS] = {0};
+    char *line, *save = NULL;
+    log_ring_sink *ring;
+    long i, id;
+    int seq, bad = 0;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0) {
+        failures++;
+        return;
+    }
+
+    CHECK(log_set_lane(lg, INFO, 1024, LOG_OVERFLOW_BLOCK) == LOG_TRUE);
+    CHECK(log_set_pattern(lg, LOG_ROUTE(sink), "%m") == LOG_TRUE);
+    CHECK(log_dispatch(lg, DISPATCH_UNBLOCK) == LOG_TRUE);
+
+    for(i = 0; i < WRITERS; i++) {
+        pthread_create(&threads[i], NULL, writer, (void *)i);
+    }
+
+    for(i = 0; i < WRITERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK(ring_wait(ring, WRITERS * RECORDS));
+    CHECK(log_ring_sink_lines(ring) == WRITERS * RECORDS);
+    log_ring_sink_read(ring, buf, sizeof(buf));
+
+    for(line = strtok_r(buf, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save)) {
+        if(sscanf(line, "%ld %d", &id, &seq) != 2 || id < 0 || id >= WRITERS || seq != next[id]++) {
+            bad++;
+        }
+    }
+
+    CHECK(bad == 0);
+
+    for(i = 0; i < WRITERS; i++) {
+        CHECK(next[i] == RECORDS);
+    }
+
+    CHECK(log_set_lane(lg, ERROR, 64, LOG_OVERFLOW_DROP) == LOG_FALSE);		//调度线程运行时不能增加通道
+    CHECK(log_set_lane(lg, INFO, 0, LOG_OVERFLOW_DROP) == LOG_TRUE);		//只修改策略
+    ring_teardown(lg, ring);
+}
+
+/**
+ * @brief	test_policy	写满两个通道之后再输出:ERROR丢弃新日志，INFO淘汰最早的日志，先输出ERROR
+ *
+ * 内联调度在log_poll之前不取日志。变长布局下短日志只占用部分块，通道实际容纳的条数多于capacity，
+ * 所以只检查保留的是连续的开头(ERROR)和结尾(INFO)
+ */
+static void test_policy(void)
+{
+    static char buf[TEST_RING_SIZE];
+    char category[CATEGORY_LEN] = "lane", level[8], *line, *save = NULL;
+    int i, seq, errors = 0, infos = 0, first = -1, bad = 0;
+    log_ring_sink *ring;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0) {
+        failures++;
+        return;
+    }
+
+    CHECK(log_set_lane(lg, ERROR, LANE_SIZE, LOG_OVERFLOW_DROP) == LOG_TRUE);
+    CHECK(log_set_lane(lg, INFO, LANE_SIZE, LOG_OVERFLOW_EVICT) == LOG_TRUE);
+    CHECK(log_set_lane(lg, ERROR, LANE_SIZE, LOG_OVERFLOW_DROP) == LOG_FALSE);		//每个级别只能设置一次
+    CHECK(log_set_pattern(lg, LOG_ROUTE(sink), "%p %m") == LOG_TRUE);
+    CHECK(log_dispatch(lg, DISPATCH_INLINE) == LOG_TRUE);
+
+    for(i = 0; i < RECORDS; i++) {
+        log_write(lg, LOG_ROUTE(sink), INFO, category, "%d", i);
+        log_write(lg, LOG_ROUTE(sink), ERROR, category, "%d", i);
+    }
+
+    while(log_poll(lg, 0) > 0);
+
+    log_ring_sink_read(ring, buf, sizeof(buf));
+
+    for(line = strtok_r(buf, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save)) {
+        if(sscanf(line, "%7s %d", level, &seq) != 2) {
+            bad++;
+        } else if(strcmp(level, "ERROR") == 0) {
+            bad += infos > 0 || seq != errors++;
+        } else if(strcmp(level, "INFO") == 0) {
+            first = first < 0 ? seq : first;
+            bad += seq != first + infos++;
+        } else {
+            bad++;
+        }
+    }
+
+    CHECK(bad == 0);
+    CHECK(errors >= LANE_SIZE && errors < RECORDS);
+    CHECK(infos >= LANE_SIZE && first + infos == RECORDS);
+    ring_teardown(lg, ring);
+}
+
+int main(void)
+{
+    test_block();
+    test_policy();
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file test_layout.c
+ * @brief 格式模板:转换、宽度、字段、调用点信息和时间格式，错误的模板不替换原来的
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+
+/**
+ * @brief	test_convert	转换、宽度和字段
+ */
+static void test_convert(void)
+{
+    char category[CATEGORY_LEN] = "category", line[512];
+    log_field fields[] = {LOG_KV_INT("id", 12), LOG_KV_STR("user", "bob")};
+    log_ring_sink *ring;
+    int sink;
+    log_t *lg;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0) {
+        failures++;
+        return;
+    }
+
+    CHECK(log_set_pattern(lg, LOG_ROUTE(sink), "%-5p|%5p|%.3c|%m|%X{user}|%X{none}|%X|100%%%n") == LOG_TRUE);
+    CHECK(log_set_pattern(lg, LOG_ROUTE(sink), "%q") == LOG_FALSE);		//错误的模板不替换原来的
+    CHECK(log_set_pattern(lg, LOG_ROUTE(sink), "%d{EPOCH}") == LOG_FALSE);
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+    log_write_kv(lg, LOG_ROUTE(sink), INFO, category, "login", fields, 2);
+    log_write(lg, LOG_ROUTE(sink), ERROR, category, "plain");
+    CHECK(ring_wait(ring, 2));
+    CHECK_STR(ring_line(ring, 0, 0, line, sizeof(line)), "INFO | INFO|cat|login|bob|| id=12 user=bob|100%");
+    CHECK_STR(ring_line(ring, 1, 0, line, sizeof(line)), "ERROR|ERROR|cat|plain||||100%");
+    ring_teardown(lg, ring);
+}
+
+/**
+ * @brief	test_site	调用点的函数和行号，ISO8601时间，没有调用点信息的日志不输出位置
+ */
+static void test_site(void)
+{
+    char line[512], expect[512], func[64];
+    int year, month, day, hour, min, sec, ms, at;
+    log_ring_sink *ring;
+    int sink;
+    log_t *lg;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0) {
+        failures++;
+        return;
+    }
+
+    CHECK(log_set_pattern(lg, LOG_ROUTE(sink), "%d{ISO8601} %M:%L %m") == LOG_TRUE);
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+    at = __LINE__ + 1;
+    LOG_SITE_WRITE(lg, LOG_ROUTE(sink), INFO, "here");
+    log_write(lg, LOG_ROUTE(sink), INFO, NULL, "nowhere");
+    CHECK(ring_wait(ring, 2));
+    CHECK(ring_line(ring, 0, 0, line, sizeof(line)) != NULL
+          && sscanf(line, "%4d-%2d-%2dT%2d:%2d:%2d.%3dZ %63[^:]", &year, &month, &day, &hour, &min, &sec, &ms, func) == 8);
+    snprintf(expect, sizeof(expect), "%s:%d here", __FUNCTION__, at);
+    CHECK(strstr(line, expect) != NULL);
+    CHECK(ring_line(ring, 1, 0, line, sizeof(line)) != NULL && strstr(line, "Z : nowhere") != NULL);
+    ring_teardown(lg, ring);
+}
+
+int main(void)
+{
+    test_convert();
+    test_site();
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file test_query.c
+ * @brief 写入带时间索引的日志文件，再用simplelog-query按级别、分类、子串和时间查询
+ *
+ * 用法: test_query simplelog-query的路径 [秒的小数位数...]，没有指定位数时使用默认的时钟和格式
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+#include <stdlib.h>
+
+#define RECORDS		3000
+
+static const char *query_tool;
+static char file[64];
+
+/**
+ * @brief	query	执行查询，统计输出的行数，prefix不为NULL时检查每一行在时间之后的部分
+ *
+ * @return	失败返回-1
+ */
+static int query(const char *args, const char *prefix)
+{
+    char cmd[512], line[1024], *p;
+    int lines = 0;
+    FILE *fp;
+
+    snprintf(cmd, sizeof(cmd), "%s %s %s", query_tool, args, file);
+
+    if((fp = popen(cmd, "r")) == NULL) {
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        p = strchr(line, ']');
+
+        if(prefix != NULL && (p == NULL || strncmp(p + 1, prefix, strlen(prefix)) != 0)) {
+            fprintf(stderr, "%s: unexpected line %s", args, line);
+            lines = -1;
+            break;
+        }
+
+        ++lines;
+    }
+
+    return pclose(fp) == 0 ? lines : -1;
+}
+
+/**
+ * @brief	file_lines	日志文件的行数
+ */
+static int file_lines(void)
+{
+    char line[1024];
+    int lines = 0;
+    FILE *fp;
+
+    if((fp = fopen(file, "r")) == NULL) {
+        return 0;
+    }
+
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        ++lines;
+    }
+
+    fclose(fp);
+    return lines;
+}
+
+/**
+ * @brief	write_file	每条日志的时间递增，级别和分类轮流变化，digits是秒的小数位数，小于0时不设置时钟
+ */
+static int write_file(int digits)
+{
+    char category[CATEGORY_LEN];
+    log_t *lg = log_create();
+    char idx[80];
+    int i, ms;
+
+    unlink(file);
+    snprintf(idx, sizeof(idx), "%s.idx", file);
+    unlink(idx);
+
+    if(lg == NULL || log_init(lg) != LOG_TRUE || log_set_file(lg, file, NULL) != LOG_TRUE
+            || log_set_index(lg, 100, 4) != LOG_TRUE || (digits >= 0 && log_set_clock(lg, LOG_CLOCK_REALTIME, digits) != LOG_TRUE)
+            || log_set_lane(lg, ERROR, 1024, LOG_OVERFLOW_BLOCK) != LOG_TRUE || log_set_lane(lg, INFO, 1024, LOG_OVERFLOW_BLOCK) != LOG_TRUE) {
+        fprintf(stderr, "setup failed\n");
+        log_destroy(lg);
+        return -1;
+    }
+
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+
+    for(i = 0; i < RECORDS; i++) {
+        snprintf(category, sizeof(category), "%s", i % 3 == 0 ? "db" : "net");
+        log_write(lg, TO_FILE, i % 2 ? ERROR : INFO, category, "request %d %s", i, i % 100 == 7 ? "timeout" : "ok");
+    }
+
+    for(ms = 0; ms < TEST_WAIT_MS && file_lines() < RECORDS; ms += 10) {	//销毁时丢弃队列中还没有输出的日志
+        usleep(10000);
+    }
+
+    log_destroy(lg);
+    return 0;
+}
+
+static void test_filters(int digits)
+{
+    if(write_file(digits) != 0) {
+        failures++;
+        return;
+    }
+
+    CHECK(query("", NULL) == RECORDS);
+    CHECK(query("-l error", "[ERROR]") == RECORDS / 2);
+    CHECK(query("-l info -c db", "[INFO ][db]") == RECORDS / 6);
+    CHECK(query("-l error -c net", "[ERROR][net]") == RECORDS / 2 - RECORDS / 6);
+    CHECK(query("-s timeout", NULL) == RECORDS / 100);
+    CHECK(query("-l fatal", NULL) == 0);
+    CHECK(query("-f @0 -t @1", NULL) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s simplelog-query [digits...]\n", argv[0]);
+        return 1;
+    }
+
+    query_tool = argv[1];
+    snprintf(file, sizeof(file), "/tmp/test_query.%d.log", (int)getpid());
+
+    if(argc == 2) {
+        test_filters(-1);
+    }
+
+    for(i = 2; i < argc; i++) {
+        test_filters(atoi(argv[i]));
+    }
+
+    unlink(file);
+    strcat(file, ".idx");
+    unlink(file);
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
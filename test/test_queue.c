@@ -0,0 +1,97 @@
+/**
+ * @file test_queue.c
+ * @brief 多个生产者同时reserve/commit，消费者peek/release:每条都取到，同一个生产者的数据保持顺序，定长和变长布局都检查
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+#include "queue.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define WRITERS		4
+#define RECORDS		20000
+#define QUEUE_SIZE	256			//远小于总条数，生产者会在队列满时等待
+#define ELEMENT_LEN	64
+
+static queue_array *q;
+
+static void *producer(void *p)
+{
+    long id = (long)p;
+    char *slot;
+    int i;
+
+    for(i = 0; i < RECORDS; i++) {
+        if((slot = q->reserve(q, ELEMENT_LEN, QUEUE_BLOCK)) == NULL) {
+            break;
+        }
+
+        q->commit(q, slot, snprintf(slot, ELEMENT_LEN, "%ld %d %*s", id, i, i % 40, "") + 1);	//长度变化，变长布局退回多余的块
+    }
+
+    return NULL;
+}
+
+static void test_layout(int chunk)
+{
+    pthread_t threads[WRITERS];
+    int next[WRITERS] = {0};
+    int i, len, seq, total, bad = 0;
+    long id;
+    char *slot;
+
+    if((q = create_queue()) != NULL) {
+        queue_set_layout(q, chunk);
+    }
+
+    if(q == NULL || q->init(q, QUEUE_SIZE, ELEMENT_LEN) != QUEUE_OP_SUCCESS) {
+        fprintf(stderr, "setup failed\n");
+        failures++;
+        return;
+    }
+
+    for(i = 0; i < WRITERS; i++) {
+        pthread_create(&threads[i], NULL, producer, (void *)(long)i);
+    }
+
+    for(total = 0; total < WRITERS * RECORDS; total++) {
+        if((slot = q->peek(q, &len, TEST_WAIT_MS)) == NULL) {
+            break;
+        }
+
+        if(len != (int)strlen(slot) + 1 || sscanf(slot, "%ld %d", &id, &seq) != 2 || id < 0 || id >= WRITERS || seq != next[id]++) {
+            bad++;
+        }
+
+        q->release(q, slot);
+    }
+
+    for(i = 0; i < WRITERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK(total == WRITERS * RECORDS);
+    CHECK(bad == 0);
+    CHECK(q->is_empty(q));
+
+    for(i = 0; i < WRITERS; i++) {
+        CHECK(next[i] == RECORDS);
+    }
+
+    queue_destroy(q);
+}
+
+int main(void)
+{
+    test_layout(0);
+    test_layout(16);
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file test_ring.c
+ * @brief 自定义设备:按输出模式的位路由到多个设备，移除之后不再收到日志，内存环形设备只保留最近的完整行
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "test.h"
+
+#define SMALL_RING	64
+
+int main(void)
+{
+    char category[CATEGORY_LEN] = "ring", buf[SMALL_RING * 2], line[64];
+    log_ring_sink *ring, *small;
+    int sink, other, i;
+    log_t *lg;
+
+    if((sink = ring_setup(&lg, &ring, LOG_FORMAT_TEXT)) < 0 || (small = log_ring_sink_create(SMALL_RING)) == NULL
+            || (other = log_add_sink(lg, &log_ring_sink_ops, small, LOG_FORMAT_TEXT, LOG_ESCAPE_RAW)) < 0
+            || log_set_pattern(lg, LOG_ROUTE(sink), "%m") != LOG_TRUE || log_set_pattern(lg, LOG_ROUTE(other), "%m") != LOG_TRUE) {
+        return 1;
+    }
+
+    CHECK(other == sink + 1);
+    log_dispatch(lg, DISPATCH_UNBLOCK);
+    log_write(lg, LOG_ROUTE(sink), INFO, category, "first only");
+    log_write(lg, LOG_ROUTE(sink) | LOG_ROUTE(other), INFO, category, "both");
+
+    for(i = 0; i < 20; i++) {
+        log_write(lg, LOG_ROUTE(other), INFO, category, "second %d", i);		//超过环的大小
+    }
+
+    CHECK(ring_wait(ring, 2));
+    CHECK(ring_wait(small, 21));
+    CHECK(log_ring_sink_lines(ring) == 2);
+    CHECK_STR(ring_line(ring, 0, 0, line, sizeof(line)), "first only");
+    CHECK_STR(ring_line(ring, 1, 0, line, sizeof(line)), "both");
+    CHECK(log_ring_sink_read(small, buf, sizeof(buf)) <= SMALL_RING);
+    CHECK(strncmp(buf, "second ", 7) == 0);		//开头不完整的行被去掉
+    CHECK(strlen(buf) >= 10 && strcmp(buf + strlen(buf) - 10, "second 19\n") == 0);
+
+    CHECK(log_remove_sink(lg, other) == LOG_TRUE);
+    log_write(lg, LOG_ROUTE(sink) | LOG_ROUTE(other), INFO, category, "after remove");
+    CHECK(ring_wait(ring, 3));
+    CHECK(log_ring_sink_lines(small) == 21);
+    CHECK_STR(ring_line(ring, 2, 0, line, sizeof(line)), "after remove");
+    ring_teardown(lg, ring);
+    log_ring_sink_destroy(small);
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+    }
+
+    return failures > 0;
+}
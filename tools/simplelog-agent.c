@@ -0,0 +1,284 @@
+/**
+ * @file simplelog-agent.c
+ * @brief 本机日志代理的简单实现，用于测试log_set_unix
+ *
+ * 1.监听unix socket(流式或者SOCK_SEQPACKET)，接收多个日志进程的连接\n
+ * 2.文本格式的日志原样输出，LOG_FORMAT_BINARY的记录解码为文本后输出到stdout\n
+ * 3.收到指定条数或者SIGINT、SIGTERM后退出，退出时在stderr输出统计\n
+ *
+ * 用法: simplelog-agent -l path [-P] [-c count] [-q]
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#define _GNU_SOURCE
+#include "log.h"
+#include "fmt.h"
+#include "kv.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/un.h>
+
+#define AGENT_CLIENT_MAX	64
+#define AGENT_BUF_LEN		65536		//不小于一个SOCK_SEQPACKET包(一批日志)
+
+typedef struct agent_client_s {
+    int fd;
+    int len;						//流式socket中还没有解析完的字节数
+    char buf[AGENT_BUF_LEN];
+} agent_client;
+
+static volatile sig_atomic_t stop_flag = 0;
+static const char *level_str[] = {"FATAL", "ERROR", "INFO", "DEBUG"};
+static long records = 0, bytes = 0, bad = 0;
+static int quiet = 0;
+
+static void catch_stop(int sig)
+{
+    stop_flag = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s -l path [-P] [-c count] [-q]\n", prog);
+}
+
+/**
+ * @brief	print_record	把二进制记录解码为文本格式输出
+ */
+static void print_record(const log_record *head, const char *data)
+{
+    char out[RENDER_BUF_LEN * 2];
+    struct tm tm;
+    time_t sec = head->time_us / 1000000;
+    fmt_buf b;
+    int len;
+
+    if(quiet) {
+        return;
+    }
+
+    gmtime_r(&sec, &tm);
+    fmt_init(&b, out, sizeof(out));
+    fmt_format(&b, "[%04d/%02d/%02d %02d:%02d:%02d.%03d][%-5s][", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+               tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(head->time_us % 1000000 / 1000),
+               head->level <= DEBUG ? level_str[head->level] : "UNKNOWN");
+    fmt_putn(&b, data, head->category_len);
+    fmt_putn(&b, "] - ", 4);
+    fmt_putn(&b, data + head->category_len, head->msg_len);
+    kv_render(&b, data + head->category_len + head->msg_len, head->kv_len, LOG_FORMAT_TEXT);
+    fmt_putc(&b, '\n');
+    len = fmt_end(&b);
+    fwrite(out, 1, len, stdout);
+}
+
+/**
+ * @brief	record_prefix	不足一个记录头的数据是否可能是二进制记录的开头
+ *
+ * 记录小于64K，长度中高位的两个字节为0，而文本行中没有0；之后是魔数，还没有收到的部分按可能处理
+ */
+static int record_prefix(const char *p, int n)
+{
+    uint32_t len = 0xffff;
+    uint16_t magic = LOG_RECORD_MAGIC;
+    const char *high = (const char *)&len;
+    int i, off = offsetof(log_record, magic);
+
+    for(i = 0; i < n && i < (int)sizeof(len); i++) {
+        if(high[i] == 0 && p[i] != 0) {
+            return 0;
+        }
+    }
+
+    return n < off + (int)sizeof(magic) || memcmp(p + off, &magic, sizeof(magic)) == 0;
+}
+
+/**
+ * @brief	parse	解析缓冲区中完整的记录(二进制记录或者以换行结尾的文本行)
+ *
+ * @return	解析掉的字节数
+ */
+static int parse(const char *buf, int len)
+{
+    log_record head;
+    const char *nl;
+    int off = 0;
+
+    while(off < len) {
+        if(len - off >= (int)sizeof(log_record)) {
+            memcpy(&head, buf + off, sizeof(log_record));
+
+            if(head.magic == LOG_RECORD_MAGIC && head.len >= sizeof(log_record)
+               && head.len == sizeof(log_record) + head.category_len + head.msg_len + head.kv_len) {
+                if(len - off < (int)head.len) {
+                    break;
+                }
+
+                print_record(&head, buf + off + sizeof(log_record));
+                off += head.len;
+                ++records;
+                continue;
+            }
+        } else if(record_prefix(buf + off, len - off)) {		//记录头还没有收全，等待更多数据，不按文本行处理
+            break;
+        }
+
+        if((nl = memchr(buf + off, '\n', len - off)) == NULL) {
+            break;
+        }
+
+        if(!quiet) {
+            fwrite(buf + off, 1, nl - buf - off + 1, stdout);
+        }
+
+        off = nl - buf + 1;
+        ++records;
+    }
+
+    return off;
+}
+
+/**
+ * @brief	client_read	读取一个连接的数据
+ *
+ * @return	连接关闭返回-1
+ */
+static int client_read(agent_client *c, int seqpacket)
+{
+    int n, used;
+
+    if((n = read(c->fd, c->buf + c->len, AGENT_BUF_LEN - c->len)) <= 0) {
+        return n < 0 && errno == EINTR ? 0 : -1;
+    }
+
+    bytes += n;
+    c->len += n;
+    used = parse(c->buf, c->len);
+
+    if(seqpacket) {		//一个包是一批完整的记录，剩下的是坏数据
+        bad += c->len - used;
+        c->len = 0;
+        return 0;
+    }
+
+    if(used == 0 && c->len == AGENT_BUF_LEN) {		//没有换行的超长数据
+        bad += c->len;
+        c->len = 0;
+    }
+
+    memmove(c->buf, c->buf + used, c->len - used);
+    c->len -= used;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr;
+    struct pollfd fds[AGENT_CLIENT_MAX + 1];
+    agent_client *clients[AGENT_CLIENT_MAX];
+    char *path = NULL;
+    long count = 0;
+    int opt, i, n, fd, num = 0, type = SOCK_STREAM;
+    socklen_t len;
+
+    while((opt = getopt(argc, argv, "l:Pc:qh")) != -1) {
+        switch(opt) {
+            case 'l':
+                path = optarg;
+                break;
+            case 'P':
+                type = SOCK_SEQPACKET;
+                break;
+            case 'c':
+                count = atol(optarg);
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(path == NULL || strlen(path) == 0 || strlen(path) >= sizeof(addr.sun_path)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path));
+    len = offsetof(struct sockaddr_un, sun_path) + strlen(path) + 1;
+
+    if(path[0] == '@') {
+        addr.sun_path[0] = '\0';
+        --len;
+    } else {
+        unlink(path);
+    }
+
+    if((fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0)) < 0 || bind(fd, (struct sockaddr *)&addr, len) != 0 || listen(fd, 16) != 0) {
+        perror("listen");
+        return 1;
+    }
+
+    signal(SIGINT, catch_stop);
+    signal(SIGTERM, catch_stop);
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+
+    while(!stop_flag && (count == 0 || records < count)) {
+        if(poll(fds, num + 1, 1000) <= 0) {
+            continue;
+        }
+
+        for(i = num; i > 0; i--) {		//从后往前，关闭的连接用最后一个代替
+            if(fds[i].revents == 0 || client_read(clients[i - 1], type == SOCK_SEQPACKET) == 0) {
+                continue;
+            }
+
+            close(clients[i - 1]->fd);
+            free(clients[i - 1]);
+            clients[i - 1] = clients[num - 1];
+            fds[i] = fds[num];
+            --num;
+        }
+
+        if((fds[0].revents & POLLIN) && (n = accept4(fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+            if(num == AGENT_CLIENT_MAX || (clients[num] = malloc(sizeof(agent_client))) == NULL) {
+                close(n);
+                continue;
+            }
+
+            clients[num]->fd = n;
+            clients[num]->len = 0;
+            fds[num + 1].fd = n;
+            fds[num + 1].events = POLLIN;
+            ++num;
+        }
+
+        fflush(stdout);
+    }
+
+    for(i = 0; i < num; i++) {
+        close(clients[i]->fd);
+        free(clients[i]);
+    }
+
+    close(fd);
+
+    if(path[0] != '@') {
+        unlink(path);
+    }
+
+    fprintf(stderr, "records=%ld bytes=%ld bad_bytes=%ld\n", records, bytes, bad);
+    return 0;
+}
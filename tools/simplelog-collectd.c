@@ -0,0 +1,102 @@
+/**
+ * @file simplelog-collectd.c
+ * @brief 多进程日志收集进程
+ *
+ * 1.生产者进程调用log_set_shm(log, name)后，日志写入各自的共享内存环\n
+ * 2.本进程扫描同名的共享内存环，按时间戳合并后统一写入文件和套接字\n
+ * 3.收到SIGINT或SIGTERM后输出剩余日志再退出\n
+ *
+ * 用法: simplelog-collectd -n name [-f log_file] [-d debug_file] [-s ip] [-p port] [-u]
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static void catch_stop(int sig)
+{
+    stop_flag = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s -n name [-f log_file] [-d debug_file] [-s ip] [-p port] [-u]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    char *name = NULL, *log_file = NULL, *debug_file = NULL, *ip = NULL;
+    char *port = LOG_SOCKET_PORT_DEFAULT;
+    sock_type type = TCP;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:f:d:s:p:uh")) != -1) {
+        switch(opt) {
+            case 'n':
+                name = optarg;
+                break;
+            case 'f':
+                log_file = optarg;
+                break;
+            case 'd':
+                debug_file = optarg;
+                break;
+            case 's':
+                ip = optarg;
+                break;
+            case 'p':
+                port = optarg;
+                break;
+            case 'u':
+                type = UDP;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(name == NULL) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    log_t *log = log_create();
+
+    if(log == NULL || log_init(log) == LOG_FALSE) {
+        fprintf(stderr, "log init failed\n");
+        return 1;
+    }
+
+    if(log_file != NULL && log_set_file(log, log_file, debug_file) == LOG_FALSE) {
+        fprintf(stderr, "open %s failed\n", log_file);
+        return 1;
+    }
+
+    if(ip != NULL && log_set_socket(log, ip, port, type) == LOG_FALSE) {
+        fprintf(stderr, "connect %s:%s failed\n", ip, port);
+        return 1;
+    }
+
+    signal(SIGINT, catch_stop);
+    signal(SIGTERM, catch_stop);
+
+    while(!stop_flag) {
+        if(log_collect(log, name) == 0) {
+            usleep(1000);
+        }
+    }
+
+    while(log_collect(log, name) > 0);
+
+    log_destroy(log);
+    return 0;
+}
@@ -0,0 +1,638 @@
+/**
+ * @file simplelog-query.c
+ * @brief 按时间范围查询日志文件
+ *
+ * 1.用mmap打开日志文件和时间索引(文件名.idx)，在索引中二分查找时间范围，只扫描相关的几段日志\n
+ * 2.跳过不包含所需级别的段，最后一项索引之后的部分和没有索引的文件按行二分查找\n
+ * 3.分类和子串过滤先在整段数据中查找(SSE2比较首尾字符)，命中后再检查所在行的时间和级别\n
+ * 4.支持文本、json和logfmt格式的日志，时间和日志中一样是UTC\n
+ *
+ * 用法: simplelog-query [-f from] [-t to] [-l levels] [-c category] [-s text] [-v] file
+ *
+ * @author tangfu - abctangfuqiang2008@163.com
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#define _GNU_SOURCE
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define QUERY_TIME_MIN		INT64_MIN
+#define QUERY_TIME_MAX		INT64_MAX
+
+enum query_format_s {QUERY_TEXT = 0, QUERY_JSON, QUERY_LOGFMT};
+
+typedef struct query_s {
+    const char *data;			//日志文件
+    size_t size;
+    int format;
+    int time_off;				//每行中时间的位置
+    int64_t from;				//[from, to)
+    int64_t to;
+    unsigned int levels;		//需要的级别(1 << level)
+    const char *category;
+    int category_len;
+    const char *needle;			//先在整段数据中查找的串:子串，没有时是分类
+    int needle_len;
+    const char *text;			//子串
+    int text_len;
+    long matched;				//统计
+    long scanned;
+    long entries;
+    long entries_used;
+} query;
+
+static const char *level_names[] = {"FATAL", "ERROR", "INFO", "DEBUG"};
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-f from] [-t to] [-l fatal,error,info,debug] [-c category] [-s text] [-v] file\n"
+            "  from/to: \"YYYY-MM-DD HH:MM:SS[.ffffff]\", \"HH:MM[:SS]\"(date of the first record) or @seconds, UTC, to is exclusive\n", prog);
+}
+
+/**
+ * @brief	days_from_civil	1970-01-01以来的天数
+ */
+static int64_t days_from_civil(int64_t y, int m, int d)
+{
+    int64_t era, yoe, doy, doe;
+    y -= m <= 2;
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief	parse_digits	解析固定位数的数字
+ *
+ * @return	失败返回-1
+ */
+static int parse_digits(const char *p, int n)
+{
+    int v = 0;
+
+    while(n-- > 0) {
+        if(*p < '0' || *p > '9') {
+            return -1;
+        }
+
+        v = v * 10 + (*p++ - '0');
+    }
+
+    return v;
+}
+
+/**
+ * @brief	parse_clock	解析"HH:MM[:SS[.fff]]"，小数部分可以是0到9位(log_set_clock的精度)，精确到微秒
+ *
+ * @return	当天的微秒数，失败返回-1
+ */
+static int64_t parse_clock(const char *p, const char *end)
+{
+    int h, m, s = 0, us = 0, i;
+
+    if(end - p < 5 || (h = parse_digits(p, 2)) < 0 || p[2] != ':' || (m = parse_digits(p + 3, 2)) < 0) {
+        return -1;
+    }
+
+    if(end - p >= 8 && p[5] == ':' && (s = parse_digits(p + 6, 2)) < 0) {
+        return -1;
+    }
+
+    if(end - p >= 9 && p[8] == '.') {
+        for(i = 0, p += 9; i < 6; i++) {		//不足6位的按0补齐，超过的部分忽略
+            us = us * 10 + (p < end && *p >= '0' && *p <= '9' ? *p++ - '0' : 0);
+        }
+    }
+
+    return ((h * 60LL + m) * 60 + s) * 1000000LL + us;
+}
+
+/**
+ * @brief	parse_stamp	解析"YYYY?MM?DD?HH:MM:SS[.fff]"，分隔符可以是/ - T或者空格
+ *
+ * @return	1970年以来的微秒数，失败返回-1
+ */
+static int64_t parse_stamp(const char *p, const char *end)
+{
+    int y, mon, d;
+    int64_t clock;
+
+    if(end - p < 16 || (y = parse_digits(p, 4)) < 0 || (mon = parse_digits(p + 5, 2)) < 1 || (d = parse_digits(p + 8, 2)) < 1
+       || (clock = parse_clock(p + 11, end)) < 0) {
+        return -1;
+    }
+
+    return days_from_civil(y, mon, d) * 86400000000LL + clock;
+}
+
+/**
+ * @brief	line_time	一行日志的时间
+ *
+ * @return	失败返回-1
+ */
+static int64_t line_time(const query *q, const char *line, const char *end)
+{
+    return end - line > q->time_off ? parse_stamp(line + q->time_off, end) : -1;
+}
+
+/**
+ * @brief	next_line	p之后(包括p)的第一个行首
+ */
+static const char *next_line(const query *q, const char *p)
+{
+    const char *nl = memchr(p, '\n', q->data + q->size - p);
+    return nl != NULL ? nl + 1 : q->data + q->size;
+}
+
+/**
+ * @brief	find	在[s, s + n)中查找needle，SSE2一次比较16个位置的首尾字符，候选位置再比较中间部分
+ */
+static const char *find(const char *s, size_t n, const char *needle, size_t k)
+{
+    size_t i = 0;
+
+    if(k == 0) {
+        return s;
+    }
+
+    if(k > n) {
+        return NULL;
+    }
+
+    if(k == 1) {
+        return memchr(s, needle[0], n);
+    }
+
+#ifdef __SSE2__
+    __m128i first = _mm_set1_epi8(needle[0]), last = _mm_set1_epi8(needle[k - 1]);
+    unsigned int mask;
+
+    for(; i + k - 1 + 16 <= n; i += 16) {
+        mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i *)(s + i))),
+                                               _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i *)(s + i + k - 1)))));
+
+        while(mask != 0) {
+            int bit = __builtin_ctz(mask);
+
+            if(memcmp(s + i + bit + 1, needle + 1, k - 2) == 0) {
+                return s + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+#endif
+    return memmem(s + i, n - i, needle, k);
+}
+
+/**
+ * @brief	field	按格式取出一行中的字段值
+ *
+ * @param	key		json中的"key":"，logfmt中的 key=，文本格式不使用
+ *
+ * @return	值的开始，没有时返回NULL，len为值的长度
+ */
+static const char *field(const query *q, const char *line, const char *end, const char *key, int *len)
+{
+    const char *p, *v;
+    int klen = strlen(key);
+
+    if((p = find(line, end - line, key, klen)) == NULL) {
+        return NULL;
+    }
+
+    v = p + klen;
+
+    for(p = v; p < end && *p != (q->format == QUERY_JSON ? '"' : ' ') && *p != '\n'; p++);
+
+    *len = p - v;
+    return v;
+}
+
+/**
+ * @brief	text_level	文本格式一行中级别的位置，时间的长度随秒的小数位数变化，向后找到时间之后的"]["
+ *
+ * @return	没有时返回NULL
+ */
+static const char *text_level(const char *line, const char *end)
+{
+    const char *p = memchr(line, ']', end - line);
+
+    return p != NULL && end - p >= 2 && p[1] == '[' ? p + 2 : NULL;
+}
+
+/**
+ * @brief	line_level	一行日志的级别
+ *
+ * @return	失败返回-1
+ */
+static int line_level(const query *q, const char *line, const char *end)
+{
+    const char *v = NULL;
+    int i, len = 0;
+
+    if(q->format == QUERY_TEXT) {
+        v = text_level(line, end);		//"[2026/10/18 14:02:00.000][INFO ]"
+        len = v != NULL && end - v >= 5 ? 5 : 0;
+    } else {
+        v = field(q, line, end, q->format == QUERY_JSON ? "\"level\":\"" : " level=", &len);
+    }
+
+    for(i = 0; v != NULL && len > 0 && i < 4; i++) {
+        if(strncmp(v, level_names[i], strlen(level_names[i])) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief	line_category	检查一行日志的分类
+ */
+static int line_category(const query *q, const char *line, const char *end)
+{
+    const char *v;
+    int len;
+
+    if(q->format == QUERY_TEXT) {
+        if((v = text_level(line, end)) == NULL || end - v < 7 + q->category_len + 4) {
+            return 0;
+        }
+
+        v += 7;		//"INFO ]["
+        return memcmp(v, q->category, q->category_len) == 0 && memcmp(v + q->category_len, "] - ", 4) == 0;
+    }
+
+    v = field(q, line, end, q->format == QUERY_JSON ? "\"category\":\"" : " category=", &len);
+    return v != NULL && len == q->category_len && memcmp(v, q->category, len) == 0;
+}
+
+/**
+ * @brief	line_match	检查一行是否满足所有条件
+ *
+ * @return	1表示输出，0表示不输出，-1表示时间已经超出范围
+ */
+static int line_match(query *q, const char *line, const char *end)
+{
+    int64_t t = line_time(q, line, end);
+    int level;
+
+    if(t >= 0 && t >= q->to) {
+        return -1;
+    }
+
+    if(t < 0 || t < q->from) {
+        return 0;
+    }
+
+    if(q->levels != 0xf && ((level = line_level(q, line, end)) < 0 || !(q->levels & (1U << level)))) {
+        return 0;
+    }
+
+    if(q->category != NULL && !line_category(q, line, end)) {
+        return 0;
+    }
+
+    return q->text == NULL || find(line, end - line, q->text, q->text_len) != NULL;
+}
+
+/**
+ * @brief	scan	输出[p, end)中满足条件的行，p是行首
+ *
+ * @return	遇到超出时间范围的行返回-1
+ */
+static int scan(query *q, const char *p, const char *end)
+{
+    const char *hit, *line, *next;
+    int ret;
+
+    q->scanned += end - p;
+
+    while(p < end) {
+        if(q->needle != NULL) {		//先查找子串或者分类，命中之后再找到所在的行
+            if((hit = find(p, end - p, q->needle, q->needle_len)) == NULL) {
+                return 0;
+            }
+
+            for(line = hit; line > p && line[-1] != '\n'; line--);
+        } else {
+            line = p;
+        }
+
+        next = next_line(q, line);
+
+        if((ret = line_match(q, line, next)) < 0) {
+            return -1;
+        }
+
+        if(ret > 0) {
+            fwrite(line, 1, next - line, stdout);
+            ++q->matched;
+        }
+
+        p = next;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief	seek_time	在[lo, hi)中按行二分查找第一条时间不早于t的日志
+ */
+static const char *seek_time(const query *q, const char *lo, const char *hi, int64_t t)
+{
+    const char *mid, *line;
+    int64_t v;
+
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        line = mid == q->data || mid[-1] == '\n' ? mid : next_line(q, mid);
+
+        if(line >= hi) {
+            hi = mid;
+            continue;
+        }
+
+        if((v = line_time(q, line, next_line(q, line))) >= 0 && v < t) {
+            lo = next_line(q, line);
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo == q->data || lo[-1] == '\n' ? lo : next_line(q, lo);
+}
+
+/**
+ * @brief	query_index	使用索引查找，返回索引覆盖的范围之后的偏移，之后的部分由调用者扫描
+ *
+ * @return	已经超出时间范围返回-1
+ */
+static int64_t query_index(query *q, const log_index_entry *idx, int n)
+{
+    int lo = 0, hi = n, i;
+    uint64_t end, next;
+
+    while(lo < hi) {		//第一项max_us不早于from的索引
+        i = lo + (hi - lo) / 2;
+
+        if(idx[i].max_us < q->from) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+
+    while(lo > 0 && idx[lo - 1].max_us >= q->from) {		//多个调度线程时相邻的段时间可能交错
+        --lo;
+    }
+
+    end = idx[n - 1].offset + idx[n - 1].length;
+
+    for(i = lo; i < n; i++) {
+        if(idx[i].min_us >= q->to) {
+            return -1;
+        }
+
+        if(!(idx[i].levels & q->levels)) {
+            continue;
+        }
+
+        next = i + 1 < n ? idx[i + 1].offset : end;		//两项之间其他进程写入的部分也属于前一段
+        ++q->entries_used;
+
+        if(scan(q, q->data + idx[i].offset, q->data + next) < 0) {
+            return -1;
+        }
+    }
+
+    return end;
+}
+
+/**
+ * @brief	open_index	映射索引文件，只使用和日志文件一致的部分
+ *
+ * @return	索引项的个数
+ */
+static int open_index(const char *path, size_t log_size, const log_index_entry **out, size_t *map_len)
+{
+    char name[4096];
+    const log_index_entry *idx;
+    struct stat st;
+    int fd, n, i;
+
+    snprintf(name, sizeof(name), "%s.idx", path);
+
+    if((fd = open(name, O_RDONLY | O_CLOEXEC)) < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(log_index_entry)) {
+        if(fd >= 0) {
+            close(fd);
+        }
+
+        return 0;
+    }
+
+    idx = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(idx == MAP_FAILED) {
+        return 0;
+    }
+
+    n = st.st_size / sizeof(log_index_entry);
+
+    for(i = 0; i < n; i++) {
+        if(idx[i].magic != LOG_INDEX_MAGIC || idx[i].offset + idx[i].length > log_size || (i > 0 && idx[i].offset < idx[i - 1].offset)) {
+            break;
+        }
+    }
+
+    *out = idx;
+    *map_len = st.st_size;
+    return i;
+}
+
+/**
+ * @brief	parse_arg_time	解析命令行中的时间，只有时分秒时使用第一条日志的日期
+ *
+ * @return	失败返回-1
+ */
+static int64_t parse_arg_time(const query *q, const char *s)
+{
+    const char *end = s + strlen(s);
+    int64_t first, clock;
+
+    if(*s == '@') {
+        return atoll(s + 1) * 1000000LL;
+    }
+
+    if(end - s == 10) {		//只有日期
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%s 00:00", s);
+        return parse_stamp(buf, buf + strlen(buf));
+    }
+
+    if(end - s >= 16) {
+        return parse_stamp(s, end);
+    }
+
+    if((clock = parse_clock(s, end)) < 0 || (first = line_time(q, q->data, next_line(q, q->data))) < 0) {
+        return -1;
+    }
+
+    return first - first % 86400000000LL + clock;
+}
+
+static unsigned int parse_levels(char *s)
+{
+    unsigned int mask = 0;
+    char *tok, *save;
+    int i;
+
+    for(tok = strtok_r(s, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        for(i = 0; i < 4 && strcasecmp(tok, level_names[i]) != 0; i++);
+
+        if(i == 4) {
+            return 0;
+        }
+
+        mask |= 1U << i;
+    }
+
+    return mask;
+}
+
+int main(int argc, char *argv[])
+{
+    static char out[1 << 20];
+    const char *from = NULL, *to = NULL, *start;
+    char *needle = NULL;
+    const log_index_entry *idx = NULL;
+    size_t idx_len = 0;
+    struct stat st;
+    query q;
+    int opt, fd, n, verbose = 0;
+    int64_t end = 0;
+
+    memset(&q, 0, sizeof(q));
+    q.levels = 0xf;
+
+    while((opt = getopt(argc, argv, "f:t:l:c:s:vh")) != -1) {
+        switch(opt) {
+            case 'f':
+                from = optarg;
+                break;
+            case 't':
+                to = optarg;
+                break;
+            case 'l':
+
+                if((q.levels = parse_levels(optarg)) == 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+
+                break;
+            case 'c':
+                q.category = optarg;
+                q.category_len = strlen(optarg);
+                break;
+            case 's':
+                q.text = optarg;
+                q.text_len = strlen(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if((fd = open(argv[optind], O_RDONLY | O_CLOEXEC)) < 0 || fstat(fd, &st) != 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if(st.st_size == 0) {
+        return 0;
+    }
+
+    q.size = st.st_size;
+    q.data = mmap(NULL, q.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(q.data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    q.format = q.data[0] == '{' ? QUERY_JSON : q.data[0] == 't' ? QUERY_LOGFMT : QUERY_TEXT;
+    q.time_off = q.format == QUERY_JSON ? 9 : q.format == QUERY_LOGFMT ? 5 : 1;		//{"time":"  time=  [
+    q.from = QUERY_TIME_MIN;
+    q.to = QUERY_TIME_MAX;
+
+    if((from != NULL && (q.from = parse_arg_time(&q, from)) < 0) || (to != NULL && (q.to = parse_arg_time(&q, to)) < 0)) {
+        fprintf(stderr, "bad time\n");
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(q.text != NULL) {
+        q.needle = q.text;
+        q.needle_len = q.text_len;
+    } else if(q.category != NULL && q.format == QUERY_TEXT) {		//文本格式中分类带括号查找，减少误命中
+        if((needle = malloc(q.category_len + 6)) != NULL) {
+            sprintf(needle, "][%s] - ", q.category);
+            q.needle = needle;
+            q.needle_len = q.category_len + 5;
+        }
+    }
+
+    setvbuf(stdout, out, _IOFBF, sizeof(out));
+    q.entries = n = open_index(argv[optind], q.size, &idx, &idx_len);
+
+    if(n > 0) {
+        end = query_index(&q, idx, n);
+    }
+
+    if(end >= 0) {		//索引之后的部分按行二分查找
+        start = q.from != QUERY_TIME_MIN ? seek_time(&q, q.data + end, q.data + q.size, q.from) : q.data + end;
+        scan(&q, start, q.data + q.size);
+    }
+
+    fflush(stdout);
+
+    if(verbose) {
+        fprintf(stderr, "matched=%ld scanned_bytes=%ld file_bytes=%zu index_entries=%ld used_entries=%ld\n",
+                q.matched, q.scanned, q.size, q.entries, q.entries_used);
+    }
+
+    if(idx != NULL) {
+        munmap((void *)idx, idx_len);
+    }
+
+    munmap((void *)q.data, q.size);
+    free(needle);
+    return 0;
+}